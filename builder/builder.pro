@@ -14,13 +14,14 @@ TEMPLATE = app
 CONFIG += qt warn_on thread
 QT     += xml sql xmlpatterns
 isEqual(QT_MAJOR_VERSION, 5) {
-  QT += widgets
+  QT += widgets concurrent
 }
 
 DESTDIR = ../bin
 
 QMAKE_LIBDIR += $${UPDATER_LIBDIR} $${OPENRPT_LIBDIR} $${XTUPLE_LIBDIR}
 LIBS += -lxtuplecommon -lupdatercommon -lopenrptcommon -lrenderer -lMetaSQL -lqzint
+LIBS += -lz -lzstd
 win32-msvc* {
   PRE_TARGETDEPS += $${UPDATER_LIBDIR}/updatercommon.lib               \
                     $${OPENRPT_LIBDIR}/MetaSQL.$${OPENRPTLIBEXT}       \
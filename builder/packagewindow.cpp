@@ -11,8 +11,10 @@
 #include "packagewindow.h"
 
 #include <QApplication>
+#include <QDir>
 #include <QDomDocument>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QLineEdit>
 #include <QList>
 #include <QMessageBox>
@@ -20,6 +22,7 @@
 #include <QVariant>
 
 #include <loadreport.h>
+#include <pkgarchivewriter.h>
 #include <prerequisite.h>
 #include <script.h>
 
@@ -153,6 +156,32 @@ void PackageWindow::fileSaveAs()
   fileSave();
 }
 
+void PackageWindow::fileBuild()
+{
+  QString dirname = QFileDialog::getExistingDirectory(this, tr("Package Directory"),
+                                                      QFileInfo(_filename).path());
+  if(dirname.isEmpty())
+    return;
+
+  QString filename = QFileDialog::getSaveFileName(this, tr("Build Package"),
+                                                  dirname + ".tar.gz",
+                                                  tr("Package Files (*.gz *.tar *.zst);;All Files (*.*)"));
+  if(filename.isEmpty())
+    return;
+
+  QString errMsg;
+  PkgArchiveWriter writer(filename, PkgArchiveWriter::formatFor(filename));
+  writer.setIndexed(true);
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  bool ok = writer.open(errMsg) &&
+            writer.addDirectory(dirname, QDir(dirname).dirName(), errMsg) &&
+            writer.close(errMsg);
+  QApplication::restoreOverrideCursor();
+  if(! ok)
+    QMessageBox::warning(this, tr("Error Building Package"),
+                         tr("Could not build the package %1.\n%2").arg(filename, errMsg));
+}
+
 void PackageWindow::fileExit()
 {
   qApp->closeAllWindows();
@@ -29,6 +29,7 @@ public slots:
     virtual void fileOpen();
     virtual void fileSave();
     virtual void fileSaveAs();
+    virtual void fileBuild();
     virtual void fileExit();
     virtual void helpIndex();
     virtual void helpContents();
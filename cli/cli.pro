@@ -0,0 +1,50 @@
+#
+# This file is part of the xTuple ERP: PostBooks Edition, a free and
+# open source Enterprise Resource Planning software suite,
+# Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+# It is licensed to you under the Common Public Attribution License
+# version 1.0, the full text of which (including xTuple-specific Exhibits)
+# is available at www.xtuple.com/CPAL.  By using this software, you agree
+# to be bound by its terms.
+#
+
+include( ../global.pri )
+
+TEMPLATE = app
+CONFIG += qt warn_on console c++11
+CONFIG -= app_bundle
+QT     += script xml sql xmlpatterns
+# the shared libraries need widgets to link but updater-cli never creates
+# one, so it runs without a display or platform plugin
+isEqual(QT_MAJOR_VERSION, 5) {
+  QT += widgets concurrent
+}
+
+DEPENDPATH  += ../$${XTUPLE_BLD}/common
+
+TARGET = updater-cli
+OBJECTS_DIR = tmp
+MOC_DIR     = tmp
+
+QMAKE_LIBDIR += $${UPDATER_LIBDIR} $${OPENRPT_LIBDIR} $${XTUPLE_LIBDIR}
+LIBS += -lxtuplecommon -lupdatercommon -lopenrptcommon -lrenderer -lMetaSQL -lqzint
+LIBS += -lz -lzstd
+win32-msvc* {
+  PRE_TARGETDEPS += $${UPDATER_LIBDIR}/updatercommon.lib               \
+                    $${XTUPLE_LIBDIR}/xtuplecommon.$${XTLIBEXT}        \
+                    $${OPENRPT_LIBDIR}/MetaSQL.$${OPENRPTLIBEXT}       \
+                    $${OPENRPT_LIBDIR}/openrptcommon.$${OPENRPTLIBEXT} \
+                    $${OPENRPT_LIBDIR}/renderer.$${OPENRPTLIBEXT}      \
+                    $${OPENRPT_LIBDIR}/qzint.$${OPENRPTLIBEXT}
+} else {
+  PRE_TARGETDEPS += $${UPDATER_LIBDIR}/libupdatercommon.a                 \
+                    $${XTUPLE_LIBDIR}/libxtuplecommon.$${XTLIBEXT}        \
+                    $${OPENRPT_LIBDIR}/libMetaSQL.$${OPENRPTLIBEXT}       \
+                    $${OPENRPT_LIBDIR}/libopenrptcommon.$${OPENRPTLIBEXT} \
+                    $${OPENRPT_LIBDIR}/librenderer.$${OPENRPTLIBEXT}      \
+                    $${OPENRPT_LIBDIR}/libqzint.$${OPENRPTLIBEXT}
+}
+
+DESTDIR = ../bin
+
+SOURCES += main.cpp
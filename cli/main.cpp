@@ -0,0 +1,298 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+/* updater-cli applies a package without the updater window, for servers
+   and scripts. It takes the arguments of updater -autorun, with
+   -rollback in place of the -debug checkbox, and returns the same exit
+   codes, but connects to the database itself instead of through the
+   login dialog so it needs no display.
+
+   Several -file arguments are applied in an order that satisfies their
+   dependencies by an UpdateSession, as one transaction with
+   -singletransaction. With
+   -databases the packages are applied to each of a list of databases
+   instead, -jobs of them at a time and at most -hostjobs on any one
+   server, by copies of updater-cli run by an UpdateFanout; -results
+   writes how each one went as JSON.
+ */
+
+#include <QCoreApplication>
+#include <QMessageBox>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+
+#include <cmdlinemessagehandler.h>
+#include <dbtools.h>
+
+#include "updateengine.h"
+#include "updatefanout.h"
+#include "updatesession.h"
+#include "updaterdata.h"
+
+QString _databaseURL = "";
+
+int main(int argc, char* argv[])
+{
+  QString dbName;
+  QString hostName;
+  QString passwd;
+  QString databases;
+  QStringList pkgfiles;
+  QString port;
+  QString username;
+  QString resultsFile;
+  QString timingsFile;
+  QString traceFile;
+  int     hostJobs          = 0;
+  int     jobs              = 4;
+  bool    acceptDefaults    = false;
+  bool    rollback          = false;
+  bool    journal           = false;
+  bool    rewrite           = false;
+  bool    schedule          = false;
+  bool    serverApply       = false;
+  bool    singleTransaction = false;
+  bool    useCache          = false;
+
+  QCoreApplication app(argc, argv);
+  app.addLibraryPath(".");
+
+  for (int intCounter = 1; intCounter < argc; intCounter++)
+  {
+    QString argument(argv[intCounter]);
+
+    if (argument.startsWith("-help", Qt::CaseInsensitive))
+    {
+      qWarning("%s [ -databaseURL=PSQL7://hostname:port/databasename ]"
+               " [ -h hostname ]"
+               " [ -p port ]"
+               " [ -d databasename ]"
+               " [ -U username | -username=username ]"
+               " [ -passwd=databasePassword ]"
+               " [ -rollback ]"
+               " [ -cache ]"
+               " [ -serverapply ]"
+               " [ -journal ]"
+               " [ -rewrite ]"
+               " [ -schedule ]"
+               " [ -singletransaction ]"
+               " [ -timings=timings.json ]"
+               " [ -trace=trace.json ]"
+               " [ -D ]"
+               " [ -databases=host:port/db,... | -databases=listFile"
+               " [ -jobs=4 ] [ -hostjobs=n ] [ -results=results.json ] ]"
+               " -file=updaterFile.gz | -f updaterFile.gz ...",
+               argv[0]);
+      return 0;
+    }
+    else if (argument.startsWith("-databaseURL=", Qt::CaseInsensitive))
+    {
+      QString protocol;
+      _databaseURL = argument.right(argument.length() - 13);
+      parseDatabaseURL(_databaseURL, protocol, hostName, dbName, port);
+    }
+    else if (argument == "-h" && intCounter + 1 < argc)
+      hostName = argv[++intCounter];
+    else if (argument == "-p" && intCounter + 1 < argc)
+      port = argv[++intCounter];
+    else if (argument == "-d" && intCounter + 1 < argc)
+      dbName = argv[++intCounter];
+    else if (argument == "-U" && intCounter + 1 < argc)
+      username = argv[++intCounter];
+    else if (argument.startsWith("-username=", Qt::CaseInsensitive))
+      username = argument.right(argument.length() - 10);
+    else if (argument.startsWith("-passwd=", Qt::CaseInsensitive))
+      passwd = argument.right(argument.length() - 8);
+    else if (argument.toLower() == "-rollback")
+      rollback = true;    // what updater -debug offers as a checkbox
+    else if (argument.toLower() == "-cache")
+      useCache = true;
+    else if (argument.toLower() == "-serverapply")
+      serverApply = true;
+    else if (argument.toLower() == "-journal")
+      journal = true;
+    else if (argument.toLower() == "-rewrite")
+      rewrite = true;
+    else if (argument.toLower() == "-schedule")
+      schedule = true;
+    else if (argument.toLower() == "-singletransaction")
+      singleTransaction = true;
+    else if (argument.startsWith("-timings=", Qt::CaseInsensitive))
+      timingsFile = argument.right(argument.size() - argument.indexOf("=") - 1);
+    else if (argument.startsWith("-trace=", Qt::CaseInsensitive))
+      traceFile = argument.right(argument.size() - argument.indexOf("=") - 1);
+    else if (argument == "-f" && intCounter + 1 < argc)
+      pkgfiles.append(argv[++intCounter]);
+    else if (argument.startsWith("-file=", Qt::CaseInsensitive))
+      pkgfiles.append(argument.right(argument.size() - argument.indexOf("=") - 1));
+    else if (argument.startsWith("-databases=", Qt::CaseInsensitive))
+      databases = argument.right(argument.size() - argument.indexOf("=") - 1);
+    else if (argument.startsWith("-jobs=", Qt::CaseInsensitive))
+      jobs = argument.right(argument.size() - argument.indexOf("=") - 1).toInt();
+    else if (argument.startsWith("-hostjobs=", Qt::CaseInsensitive))
+      hostJobs = argument.right(argument.size() - argument.indexOf("=") - 1).toInt();
+    else if (argument.startsWith("-results=", Qt::CaseInsensitive))
+      resultsFile = argument.right(argument.size() - argument.indexOf("=") - 1);
+    else if (argument == "-D")
+      acceptDefaults = true;
+    else if (argument.toLower() == "-autorun")
+      ;         // accepted so updater -autorun command lines work unchanged
+  }
+
+  CmdLineMessageHandler *handler = new CmdLineMessageHandler(&app);
+  handler->setAcceptDefaults(acceptDefaults);
+
+  if (pkgfiles.isEmpty())
+  {
+    handler->message(QtFatalMsg,
+                     QObject::tr("No package file was given. "
+                                 "Run %1 -help for usage.").arg(argv[0]));
+    return 2;
+  }
+
+  if (! databases.isEmpty())
+  {
+    QString     errMsg;
+    QStringList urls = UpdateFanout::databaseList(databases, errMsg);
+    if (urls.isEmpty())
+    {
+      handler->message(QtFatalMsg, errMsg);
+      return 2;
+    }
+
+    // each worker also gets its database, the packages, -cache and -D
+    QStringList args;
+    if (! username.isEmpty())
+      args << "-username=" + username;
+    if (rollback)
+      args << "-rollback";
+    if (serverApply)
+      args << "-serverapply";
+    if (rewrite)
+      args << "-rewrite";
+    if (schedule)
+      args << "-schedule";
+    if (journal)
+      args << "-journal";
+    if (singleTransaction)
+      args << "-singletransaction";
+
+    UpdateFanout fanout(handler);
+    fanout.setArguments(args);
+    fanout.setJobs(jobs);
+    fanout.setHostJobs(hostJobs);
+    fanout.setPassword(passwd);
+    if (! fanout.prepare(pkgfiles, errMsg))
+    {
+      handler->message(QtFatalMsg, errMsg);
+      return 5;
+    }
+
+    bool successful = fanout.run(urls);
+    foreach (UpdateFanout::Result result, fanout.results())
+    {
+      if (result.exitCode != 0 && ! result.output.isEmpty())
+        qWarning("==== %s\n%s", qPrintable(result.databaseURL),
+                 qPrintable(result.output));
+    }
+    qWarning("%s", qPrintable(fanout.matrix()));
+    if (! resultsFile.isEmpty() && ! fanout.save(resultsFile, errMsg))
+      handler->message(QtWarningMsg, errMsg);
+
+    return successful ? 0 : 5;
+  }
+
+  QSqlDatabase db = QSqlDatabase::addDatabase("QPSQL");
+  db.setHostName(hostName);
+  db.setDatabaseName(dbName);
+  if (! port.isEmpty())
+    db.setPort(port.toInt());
+  db.setUserName(username);
+  db.setPassword(passwd);
+  if (! db.open())
+  {
+    handler->message(QtFatalMsg,
+                     QObject::tr("Unable to connect to the database "
+                                 "with the given information: %1")
+                     .arg(db.lastError().text()));
+    return 1;
+  }
+  if (username.isEmpty())
+  {
+    QSqlQuery who("SELECT CURRENT_USER;");
+    if (who.first())
+      username = who.value(0).toString();
+  }
+  if (_databaseURL.isEmpty())
+    buildDatabaseURL(_databaseURL, "psql", hostName, dbName, port);
+
+  Updater::loggedIn = true;
+
+  QSqlQuery set("SET standard_conforming_strings TO true;");
+  if (set.lastError().type() != QSqlError::NoError)
+    handler->message(QtWarningMsg,
+                     QObject::tr("Unable to set standard_conforming_strings. "
+                                 "Updates may fail with unexpected errors."));
+
+  QSqlQuery su;
+  su.prepare("SELECT rolsuper FROM pg_roles WHERE (rolname=:user);");
+  su.bindValue(":user", username);
+  su.exec();
+  if (su.first())
+  {
+    if (! su.value(0).toBool() &&
+        handler->question(QObject::tr("You are not logged in as a "
+                                      "database super user. The update "
+                                      "may fail. Are you sure you want "
+                                      "to continue?"),
+                          QMessageBox::Yes | QMessageBox::No,
+                          QMessageBox::No) == QMessageBox::No)
+      return 3;
+  }
+  else if (su.lastError().type() != QSqlError::NoError &&
+           handler->question(QObject::tr("<p>The application received a database "
+                                         "error while trying to check the user "
+                                         "status of %1. Would you like to try to "
+                                         "update anyway?</p><pre>%2</pre>")
+                          .arg(username, su.lastError().databaseText()),
+                          QMessageBox::Yes | QMessageBox::No,
+                          QMessageBox::No) == QMessageBox::No)
+    return 4;
+
+  UpdateEngine engine(handler);
+  engine.setAlwaysRollback(rollback);
+  if (useCache)
+    engine.setUseCache(true);
+  if (serverApply)
+    engine.setServerApply(true);
+  if (rewrite)
+    engine.setRewrite(true);
+  if (schedule)
+    engine.setSchedule(true);
+  if (journal)
+    engine.setJournal(true);
+  if (! timingsFile.isEmpty())
+    engine.setTimingsFile(timingsFile);
+  if (! traceFile.isEmpty())
+    engine.setTraceFile(traceFile);
+
+  UpdateSession session(&engine);
+  session.setSingleTransaction(singleTransaction);
+  QString errMsg;
+  if (! session.prepare(pkgfiles, errMsg))
+  {
+    handler->message(QtFatalMsg, errMsg);
+    return 5;
+  }
+
+  return session.run() ? 0 : 5;
+}
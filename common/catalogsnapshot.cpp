@@ -0,0 +1,112 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "catalogsnapshot.h"
+
+#include <QObject>
+#include <QSqlError>
+#include <QVariant>     // used by XSqlQuery::value()
+
+#include "xsqlquery.h"
+
+#define DEBUG false
+#define TR(a) QObject::tr(a)
+
+CatalogSnapshot::CatalogSnapshot()
+{
+}
+
+CatalogSnapshot::~CatalogSnapshot()
+{
+}
+
+QString CatalogSnapshot::key(const QString &kind, const QString &schema,
+                             const QString &name)
+{
+  return kind + "\n" + schema + "\n" + name.toLower();
+}
+
+void CatalogSnapshot::add(const QString &name)
+{
+  QString lower = name.toLower();
+  if (! _names.contains(lower))
+    _names.append(lower);
+}
+
+void CatalogSnapshot::clear()
+{
+  _found.clear();
+  _names.clear();
+}
+
+bool CatalogSnapshot::contains(const QString &kind, const QString &schema,
+                               const QString &name) const
+{
+  return _found.contains(key(kind, schema, name));
+}
+
+bool CatalogSnapshot::contains(const QStringList &kinds,
+                               const QStringList &schemas,
+                               const QString &name) const
+{
+  foreach (QString kind, kinds)
+    foreach (QString schema, schemas)
+      if (contains(kind, schema, name))
+        return true;
+  return false;
+}
+
+// replaces whatever an earlier refresh() found
+bool CatalogSnapshot::refresh(QString &errMsg)
+{
+  _found.clear();
+  if (_names.isEmpty())
+    return true;
+
+  QString names = _names.join("\n");
+
+  XSqlQuery qry;
+  qry.prepare("SELECT c.relkind::TEXT AS kind, n.nspname AS schema,"
+              "       c.relname AS name"
+              "  FROM pg_class c"
+              "  JOIN pg_namespace n ON c.relnamespace=n.oid"
+              " WHERE c.relname::TEXT = ANY (string_to_array(:names, E'\\n'))"
+              " UNION ALL "
+              "SELECT 't', n.nspname, t.tgname"
+              "  FROM pg_trigger t"
+              "  JOIN pg_class c ON t.tgrelid=c.oid"
+              "  JOIN pg_namespace n ON c.relnamespace=n.oid"
+              " WHERE t.tgname::TEXT = ANY (string_to_array(:names, E'\\n'))"
+              " UNION ALL "
+              "SELECT 'f', n.nspname, p.proname"
+              "  FROM pg_proc p"
+              "  JOIN pg_namespace n ON p.pronamespace=n.oid"
+              " WHERE p.proname::TEXT = ANY (string_to_array(:names, E'\\n'));");
+  qry.bindValue(":names", names);
+  qry.exec();
+  while (qry.next())
+    _found.insert(key(qry.value("kind").toString(),
+                      qry.value("schema").toString(),
+                      qry.value("name").toString()));
+
+  if (qry.lastError().type() != QSqlError::NoError)
+  {
+    errMsg = TR("Could not read the database catalog:<br><pre>%1<br>%2</pre>")
+              .arg(qry.lastError().databaseText())
+              .arg(qry.lastError().driverText());
+    return false;
+  }
+
+  if (DEBUG)
+    qDebug("CatalogSnapshot::refresh() found %d objects for %d names",
+           _found.size(), _names.size());
+
+  return true;
+}
@@ -0,0 +1,52 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __CATALOGSNAPSHOT_H__
+#define __CATALOGSNAPSHOT_H__
+
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+/* CatalogSnapshot records which tables, views, triggers and functions with
+   given names exist, fetched from pg_class, pg_trigger and pg_proc with a
+   single query for all of the names at once.
+
+   Add the names of interest, refresh(), then ask contains(). Kinds are
+   pg_class.relkind values ("r" for tables, "v" and "m" for views), "t" for
+   triggers and "f" for functions. Names compare case-insensitively, like
+   the LOWER(name) lookups CreateDBObj used to run one object at a time.
+ */
+class CatalogSnapshot
+{
+  public:
+    CatalogSnapshot();
+    virtual ~CatalogSnapshot();
+
+    virtual void add(const QString &name);
+    virtual void clear();
+    virtual bool contains(const QString &kind, const QString &schema,
+                          const QString &name) const;
+    virtual bool contains(const QStringList &kinds, const QStringList &schemas,
+                          const QString &name) const;
+    virtual bool refresh(QString &errMsg);
+
+    int         found() const { return _found.size(); }
+    QStringList names() const { return _names; }
+
+  protected:
+    QSet<QString> _found;   // kind, schema and name of each object
+    QStringList   _names;
+
+    static QString key(const QString &kind, const QString &schema,
+                       const QString &name);
+};
+
+#endif
@@ -14,7 +14,7 @@ TEMPLATE = lib
 CONFIG += qt warn_on thread staticlib
 QT += xml sql xmlpatterns
 isEqual(QT_MAJOR_VERSION, 5) {
-  QT += widgets
+  QT += widgets concurrent
 }
 
 
@@ -26,15 +26,25 @@ UI_SOURCES_DIR = tmp
 
 HEADERS = updaterdata.h                 \
           package.h \
+          catalogsnapshot.h \
           createdbobj.h \
           createfunction.h \
           createtable.h \
           createtrigger.h \
           createview.h \
+          dbobjscheduler.h \
           finalscript.h \
           initscript.h \
           script.h \
+          serverapply.h \
+          statementcache.h \
+          updatejournal.h \
+          updatetimings.h \
+          updateengine.h \
+          updatefanout.h \
+          updatesession.h \
           loadable.h \
+          loadablebatch.h \
           loadappscript.h \
           loadappui.h \
           loadcmd.h \
@@ -43,21 +53,36 @@ HEADERS = updaterdata.h                 \
           loadpriv.h \
           loadqm.h \
           loadreport.h \
+          pgpipeline.h \
+          pkgarchive.h \
+          pkgarchivewriter.h \
+          pkgcache.h \
+          pkgprefetcher.h \
           pkgschema.h \
           prerequisite.h \
           xversion.h
 
 SOURCES = updaterdata.cpp              \
           package.cpp \
+          catalogsnapshot.cpp \
           createdbobj.cpp \
           createfunction.cpp \
           createtable.cpp \
           createtrigger.cpp \
           createview.cpp \
+          dbobjscheduler.cpp \
           finalscript.cpp \
           initscript.cpp \
           script.cpp \
+          serverapply.cpp \
+          statementcache.cpp \
+          updatejournal.cpp \
+          updatetimings.cpp \
+          updateengine.cpp \
+          updatefanout.cpp \
+          updatesession.cpp \
           loadable.cpp \
+          loadablebatch.cpp \
           loadappscript.cpp \
           loadappui.cpp \
           loadcmd.cpp \
@@ -66,6 +91,11 @@ SOURCES = updaterdata.cpp              \
           loadpriv.cpp \
 	  loadqm.cpp \
           loadreport.cpp \
+          pgpipeline.cpp \
+          pkgarchive.cpp \
+          pkgarchivewriter.cpp \
+          pkgcache.cpp \
+          pkgprefetcher.cpp \
           pkgschema.cpp \
           prerequisite.cpp \
           xversion.cpp
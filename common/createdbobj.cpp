@@ -16,29 +16,32 @@
 #include <QSqlError>
 #include <QVariant>
 
-#include "metasql.h"
+#include "catalogsnapshot.h"
+#include "statementcache.h"
 #include "xsqlquery.h"
 
 #define DEBUG false
 
 CreateDBObj::CreateDBObj()
+  : _snapshot(0)
 {
 }
 
 CreateDBObj::CreateDBObj(const QString &nodename, const QString &filename,
                          const QString &name,     const QString &comment,
                          const QString &schema,   OnError onError)
+  : _snapshot(0)
 {
   _comment  = comment;
   _filename = filename;
   _name     = name;
   _nodename = nodename;
-  _oidMql   = 0;
   _schema   = schema;
   _onError  = onError;
 }
 
 CreateDBObj::CreateDBObj(const QDomElement & elem, QStringList &msg, QList<bool> &fatal)
+  : _snapshot(0)
 {
   _nodename = elem.nodeName();
 
@@ -97,22 +100,14 @@ int CreateDBObj::writeToDB(QByteArray &pdata, const QString pkgname, ParameterLi
     qDebug("CreateDBObj::writeToDB(%s, %s, &errMsg)",
            pdata.data(), qPrintable(pkgname));
 
-  QString destschema;
-  if (! _schema.isEmpty())
-    destschema = _schema;
-  else if (pkgname.isEmpty())
-    destschema = "public";
-  else if (! pkgname.isEmpty())
-    destschema = pkgname;
-
   params.append("name", _name);
-  params.append("schema", destschema);
+  params.append("schema", destSchema(pkgname));
 
   int returnVal = Script::writeToDB(pdata, pkgname, params, errMsg);
-  if (returnVal < 0)
+  if (returnVal < 0 || _snapshot)       // with a snapshot the caller verifies
     return returnVal;
 
-  XSqlQuery oidq = _oidMql->toQuery(params);
+  XSqlQuery oidq = StatementCache::exec(_oidMql, params);
   if (oidq.first())
     ; // passed error check
   else if (oidq.lastError().type() != QSqlError::NoError)
@@ -132,3 +127,34 @@ int CreateDBObj::writeToDB(QByteArray &pdata, const QString pkgname, ParameterLi
 
   return returnVal;
 }
+
+QString CreateDBObj::destSchema(const QString pkgname) const
+{
+  if (! _schema.isEmpty())
+    return _schema;
+  else if (pkgname.isEmpty())
+    return "public";
+
+  return pkgname;
+}
+
+QStringList CreateDBObj::catalogSchemas(const QString pkgname) const
+{
+  return QStringList() << destSchema(pkgname);
+}
+
+/* Check that writeToDB() created the object, using a snapshot of the catalog
+   taken after the script ran instead of querying for this one object.
+   Returns the same values and messages as the check in writeToDB().
+ */
+int CreateDBObj::verify(const CatalogSnapshot &snapshot, const QString pkgname,
+                        QString &errMsg) const
+{
+  if (snapshot.contains(catalogKinds(), catalogSchemas(pkgname), _name))
+    return 0;
+
+  errMsg = TR("Could not find %1 in the database. The "
+              "script %2 does not match the package.xml description.")
+          .arg(_name).arg(_filename);
+  return -8;
+}
@@ -12,12 +12,13 @@
 #define __CREATEDBOBJ_H__
 
 #include <QString>
+#include <QStringList>
 
 #include "script.h"
 
+class CatalogSnapshot;
 class QDomDocument;
 class QDomElement;
-class MetaSQLQuery;
 
 #define TR(a) QObject::tr(a)
 
@@ -40,14 +41,22 @@ class CreateDBObj : public Script
                                               !_name.isEmpty() &&
                                               !_filename.isEmpty(); }
 
+    virtual CatalogSnapshot *snapshot() const { return _snapshot; }
+    virtual void setSnapshot(CatalogSnapshot *snapshot) { _snapshot = snapshot; }
+    virtual QStringList catalogKinds() const { return QStringList(); }
+    virtual QStringList catalogSchemas(const QString pkgname) const;
+    virtual int verify(const CatalogSnapshot &snapshot, const QString pkgname, QString &errMsg) const;
+
   protected:
-    QString       _filename;
-    QString       _nodename;
-    MetaSQLQuery *_oidMql;
-    QString       _pkgitemtype;
-    QString       _schema;
+    QString          _filename;
+    QString          _nodename;
+    QString          _oidMql;
+    QString          _pkgitemtype;
+    QString          _schema;
+    CatalogSnapshot *_snapshot;
 
     CreateDBObj();
+    virtual QString destSchema(const QString pkgname) const;
     virtual int writeToDB(QByteArray &pdata, const QString pkgname, ParameterList &params, QString &errMsg);
 };
 
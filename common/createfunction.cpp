@@ -15,6 +15,7 @@
 #include <QSqlError>
 #include <QVariant>     // used by XSqlQuery::bindValue()
 
+#include "catalogsnapshot.h"
 #include "xsqlquery.h"
 
 #define DEBUG false
@@ -47,13 +48,11 @@ int CreateFunction::writeToDB(QByteArray &pdata, const QString pkgname,
     qDebug("CreateFunction::writeToDb(%s, %s, &errMsg)",
            pdata.data(), qPrintable(pkgname));
 
-  QString destschema;
-  if (! _schema.isEmpty())
-    destschema = _schema;
-  else if (pkgname.isEmpty())
-    destschema = "public";
-  else if (! pkgname.isEmpty())
-    destschema = pkgname;
+  // with a snapshot the caller checks the catalog after the stage
+  if (_snapshot)
+    return Script::writeToDB(pdata, pkgname, params, errMsg);
+
+  QString destschema = destSchema(pkgname);
 
   XSqlQuery oidq;
   QMap<QString,int> oldoids;
@@ -119,3 +118,15 @@ int CreateFunction::writeToDB(QByteArray &pdata, const QString pkgname,
 
   return 0;
 }
+
+int CreateFunction::verify(const CatalogSnapshot &snapshot,
+                           const QString pkgname, QString &errMsg) const
+{
+  if (snapshot.contains(catalogKinds(), catalogSchemas(pkgname), _name))
+    return 0;
+
+  errMsg = TR("Could not find function %1 in the database for package %2. "
+              "The script %3 does not match the package.xml description.")
+            .arg(_name).arg(pkgname).arg(_filename);
+  return -6;
+}
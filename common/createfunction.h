@@ -23,6 +23,8 @@ class CreateFunction : public CreateDBObj
     CreateFunction(const QDomElement &, QStringList &, QList<bool> &);
 
     virtual int writeToDB(QByteArray &, const QString pkgname, ParameterList &params, QString &errMsg);
+    virtual QStringList catalogKinds() const { return QStringList() << "f"; }
+    virtual int verify(const CatalogSnapshot &snapshot, const QString pkgname, QString &errMsg) const;
 
   protected:
 };
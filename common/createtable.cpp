@@ -15,7 +15,6 @@
 #include <QSqlError>
 #include <QVariant>     // used by XSqlQuery::bindValue()
 
-#include "metasql.h"
 #include "xsqlquery.h"
 
 #define DEBUG false
@@ -50,18 +49,15 @@ int CreateTable::writeToDB(QByteArray &pdata, const QString pkgname,
     qDebug("CreateTable::writeToDb(%s, %s, &errMsg)",
            pdata.data(), qPrintable(pkgname));
 
-  _oidMql = new MetaSQLQuery("SELECT pg_class.oid AS oid "
-                             "FROM pg_class, pg_namespace "
-                             "WHERE ((relname=LOWER(<? value('name') ?>))"
-                             "  AND  (relkind=<? value('relkind') ?>)"
-                             "  AND  (relnamespace=pg_namespace.oid)"
-                             "  AND  (nspname=<? value('schema') ?>));");
+  _oidMql = "SELECT pg_class.oid AS oid "
+            "FROM pg_class, pg_namespace "
+            "WHERE ((relname=LOWER(<? value('name') ?>))"
+            "  AND  (relkind=<? value('relkind') ?>)"
+            "  AND  (relnamespace=pg_namespace.oid)"
+            "  AND  (nspname=<? value('schema') ?>));";
   params.append("relkind", _relkind);
 
   int returnVal = CreateDBObj::writeToDB(pdata, pkgname, params, errMsg);
 
-  delete _oidMql;
-  _oidMql = 0;
-
   return returnVal;
 }
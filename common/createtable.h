@@ -23,6 +23,7 @@ class CreateTable : public CreateDBObj
     CreateTable(const QDomElement &, QStringList &, QList<bool> &);
 
     virtual int writeToDB(QByteArray &pdata, const QString pkgname, ParameterList &params, QString &errMsg);
+    virtual QStringList catalogKinds() const { return QStringList() << _relkind; }
 
   protected:
     QString _relkind;
@@ -15,7 +15,6 @@
 #include <QSqlError>
 #include <QVariant>     // used by XSqlQuery::bindValue()
 
-#include "metasql.h"
 #include "xsqlquery.h"
 
 #define DEBUG false
@@ -48,16 +47,19 @@ int CreateTrigger::writeToDB(QByteArray &pdata, const QString pkgname,
     qDebug("CreateTrigger::writeToDb(%s, %s, &errMsg)",
            pdata.data(), qPrintable(pkgname));
 
-  _oidMql = new MetaSQLQuery("SELECT pg_trigger.oid AS oid "
-                             "FROM pg_trigger, pg_class, pg_namespace "
-                             "WHERE tgname=LOWER(<? value('name') ?>) "
-                             "  AND tgrelid=pg_class.oid"
-                             "  AND relnamespace=pg_namespace.oid"
-                             "  AND nspname IN ('public', <? value('schema') ?>);");
+  _oidMql = "SELECT pg_trigger.oid AS oid "
+            "FROM pg_trigger, pg_class, pg_namespace "
+            "WHERE tgname=LOWER(<? value('name') ?>) "
+            "  AND tgrelid=pg_class.oid"
+            "  AND relnamespace=pg_namespace.oid"
+            "  AND nspname IN ('public', <? value('schema') ?>);";
   int returnVal = CreateDBObj::writeToDB(pdata, pkgname, params, errMsg);
 
-  delete _oidMql;
-  _oidMql = 0;
-
   return returnVal;
 }
+
+// triggers are found in public as well as the destination schema
+QStringList CreateTrigger::catalogSchemas(const QString pkgname) const
+{
+  return QStringList() << "public" << destSchema(pkgname);
+}
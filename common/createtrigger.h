@@ -23,6 +23,8 @@ class CreateTrigger : public CreateDBObj
     CreateTrigger(const QDomElement &, QStringList &, QList<bool> &);
 
     virtual int writeToDB(QByteArray &pdata, const QString pkgname, ParameterList &params, QString &errMsg);
+    virtual QStringList catalogKinds() const { return QStringList() << "t"; }
+    virtual QStringList catalogSchemas(const QString pkgname) const;
 
   protected:
 };
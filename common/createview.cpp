@@ -15,7 +15,6 @@
 #include <QSqlError>
 #include <QVariant>     // used by XSqlQuery::bindValue()
 
-#include "metasql.h"
 #include "xsqlquery.h"
 
 #define DEBUG false
@@ -48,17 +47,14 @@ int CreateView::writeToDB(QByteArray &pdata, const QString pkgname,
     qDebug("CreateView::writeToDb(%s, %s, &errMsg)",
            pdata.data(), qPrintable(pkgname));
 
-  _oidMql = new MetaSQLQuery("SELECT pg_class.oid AS oid "
-                             "FROM pg_class, pg_namespace "
-                             "WHERE ((relname=LOWER(<? value('name') ?>))"
-                             "  AND  (relkind IN ('v', 'm'))"
-                             "  AND  (relnamespace=pg_namespace.oid)"
-                             "  AND  (nspname=<? value('schema') ?>));");
+  _oidMql = "SELECT pg_class.oid AS oid "
+            "FROM pg_class, pg_namespace "
+            "WHERE ((relname=LOWER(<? value('name') ?>))"
+            "  AND  (relkind IN ('v', 'm'))"
+            "  AND  (relnamespace=pg_namespace.oid)"
+            "  AND  (nspname=<? value('schema') ?>));";
 
   int returnVal = CreateDBObj::writeToDB(pdata, pkgname, params, errMsg);
 
-  delete _oidMql;
-  _oidMql = 0;
-
   return returnVal;
 }
@@ -23,6 +23,7 @@ class CreateView : public CreateDBObj
     CreateView(const QDomElement &, QStringList &, QList<bool> &);
 
     virtual int writeToDB(QByteArray &pdata, const QString pkgname, ParameterList &params, QString &errMsg);
+    virtual QStringList catalogKinds() const { return QStringList() << "v" << "m"; }
 
 };
 
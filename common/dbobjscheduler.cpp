@@ -0,0 +1,304 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "dbobjscheduler.h"
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QRegExp>
+#include <QSet>
+#include <QVector>
+
+#include "createdbobj.h"
+#include "script.h"
+
+#define DEBUG false
+#define TR(a) QObject::tr(a)
+
+// the unqualified name in schema.name
+static QString unqualified(const QString &name)
+{
+  return name.mid(name.lastIndexOf('.') + 1);
+}
+
+DbObjScheduler::DbObjScheduler()
+{
+}
+
+DbObjScheduler::~DbObjScheduler()
+{
+}
+
+void DbObjScheduler::add(Script *script, const QByteArray &data)
+{
+  const char *sql = data.constData();
+  QString     text = QString::fromLocal8Bit(sql, qstrnlen(sql, data.size()));
+
+  Node node;
+  node.script  = script;
+  node.defines = definitions(text);
+
+  CreateDBObj *obj = dynamic_cast<CreateDBObj*>(script);
+  if (obj && ! node.defines.contains(unqualified(obj->name().toLower())))
+    node.defines.append(unqualified(obj->name().toLower()));
+
+  // a script that recreates what it uses does not depend on anyone else
+  foreach (QString name, references(text))
+    if (! node.defines.contains(name))
+      node.uses.append(name);
+
+  if (DEBUG)
+    qDebug("DbObjScheduler::add(%s) defines %s, uses %s",
+           qPrintable(script->filename()), qPrintable(node.defines.join(",")),
+           qPrintable(node.uses.join(",")));
+
+  _nodes.append(node);
+  _order.clear();
+}
+
+void DbObjScheduler::clear()
+{
+  _nodes.clear();
+  _order.clear();
+  _cycle.clear();
+}
+
+/* sql in lower case without comments, the contents of quoted strings or
+   dollar-quoted bodies, or the quotes around identifiers.
+ */
+QString DbObjScheduler::stripped(const QString &sql)
+{
+  QRegExp dollarRE("^\\$([A-Za-z_][A-Za-z0-9_]*)?\\$");
+  QString result;
+  result.reserve(sql.size());
+
+  int i = 0;
+  while (i < sql.size())
+  {
+    QChar c    = sql.at(i);
+    QChar next = i + 1 < sql.size() ? sql.at(i + 1) : QChar();
+    if (c == '-' && next == '-')
+    {
+      int end = sql.indexOf('\n', i);
+      i = end < 0 ? sql.size() : end;
+      result += ' ';
+    }
+    else if (c == '/' && next == '*')
+    {
+      int end = sql.indexOf("*/", i + 2);
+      i = end < 0 ? sql.size() : end + 2;
+      result += ' ';
+    }
+    else if (c == '\'')
+    {
+      bool escapes = i > 0 && (sql.at(i - 1) == 'e' || sql.at(i - 1) == 'E');
+      for (i++; i < sql.size(); i++)
+      {
+        if (escapes && sql.at(i) == '\\')
+          i++;
+        else if (sql.at(i) == '\'')
+        {
+          if (i + 1 < sql.size() && sql.at(i + 1) == '\'')
+            i++;
+          else
+            break;
+        }
+      }
+      i++;
+      result += "''";
+    }
+    else if (c == '$' && dollarRE.indexIn(sql, i, QRegExp::CaretAtOffset) == i)
+    {
+      QString tag = dollarRE.cap(0);
+      int     end = sql.indexOf(tag, i + tag.size());
+      i = end < 0 ? sql.size() : end + tag.size();
+      result += ' ';
+    }
+    else if (c == '"')
+    {
+      int end = sql.indexOf('"', i + 1);
+      if (end < 0)
+        end = sql.size();
+      result += sql.mid(i + 1, end - i - 1);
+      i = end + 1;
+    }
+    else
+    {
+      result += c;
+      i++;
+    }
+  }
+
+  return result.toLower();
+}
+
+// names of the tables, views, functions, etc. that sql creates
+QStringList DbObjScheduler::definitions(const QString &sql)
+{
+  QRegExp createRE("^create\\s+(or\\s+replace\\s+)?"
+                   "((temp|temporary|unlogged|materialized|constraint|recursive)\\s+)*"
+                   "(table|view|function|trigger|type|sequence|aggregate|domain)\\s+"
+                   "(if\\s+not\\s+exists\\s+)?([a-z0-9_$.]+)");
+  QStringList result;
+  foreach (QString stmt, stripped(sql).split(';'))
+  {
+    if (createRE.indexIn(stmt.trimmed()) == 0)
+    {
+      QString name = unqualified(createRE.cap(6));
+      if (! result.contains(name))
+        result.append(name);
+    }
+  }
+  return result;
+}
+
+// names that sql needs to exist, ignoring anything it only drops
+QStringList DbObjScheduler::references(const QString &sql)
+{
+  QString name("([a-z_][a-z0-9_$]*(\\.[a-z_][a-z0-9_$]*)?)");
+  QRegExp contextRE("\\b(?:(?:from|join|references|on|"
+                    "execute\\s+(?:procedure|function))\\s+(?:only\\s+)?|"
+                    "inherits\\s*\\(\\s*)" + name);
+  QRegExp callRE(name + "\\s*\\(");
+
+  QStringList result;
+  foreach (QString stmt, stripped(sql).split(';'))
+  {
+    stmt = stmt.trimmed();
+    if (stmt.startsWith("drop"))
+      continue;
+
+    for (int pos = 0; (pos = contextRE.indexIn(stmt, pos)) >= 0;
+         pos += contextRE.matchedLength())
+    {
+      QString ref = unqualified(contextRE.cap(1));
+      if (! result.contains(ref))
+        result.append(ref);
+    }
+    for (int pos = 0; (pos = callRE.indexIn(stmt, pos)) >= 0;
+         pos += callRE.matchedLength())
+    {
+      QString ref = unqualified(callRE.cap(1));
+      if (! result.contains(ref))
+        result.append(ref);
+    }
+  }
+  return result;
+}
+
+/* Sort the scripts so each follows the ones defining what it uses. Ties
+   go to the script added first, so without dependencies nothing moves.
+ */
+bool DbObjScheduler::schedule(QString &errMsg)
+{
+  _order.clear();
+  _cycle.clear();
+
+  int n = _nodes.size();
+  QHash<QString, QList<int> > definers;
+  for (int i = 0; i < n; i++)
+    foreach (QString name, _nodes.at(i).defines)
+      definers[name].append(i);
+
+  QVector<QList<int> > dependents(n);
+  QVector<QSet<int> >  dependencies(n);
+  for (int j = 0; j < n; j++)
+  {
+    foreach (QString name, _nodes.at(j).uses)
+    {
+      foreach (int i, definers.value(name))
+      {
+        if (i != j && ! dependencies[j].contains(i))
+        {
+          dependencies[j].insert(i);
+          dependents[i].append(j);
+        }
+      }
+    }
+  }
+
+  QVector<int>     waiting(n);
+  QMap<int, bool>  ready;       // ordered by position in the package
+  for (int j = 0; j < n; j++)
+  {
+    waiting[j] = dependencies[j].size();
+    if (waiting[j] == 0)
+      ready.insert(j, true);
+  }
+
+  while (! ready.isEmpty())
+  {
+    int i = ready.begin().key();
+    ready.remove(i);
+    _order.append(i);
+    foreach (int j, dependents[i])
+      if (--waiting[j] == 0)
+        ready.insert(j, true);
+  }
+
+  if (_order.size() == n)
+    return true;
+
+  // every script left waits on another one left; follow them round
+  QSet<int> done = _order.toSet();
+  int       cur  = 0;
+  while (done.contains(cur))
+    cur++;
+
+  QList<int> path;
+  while (! path.contains(cur))
+  {
+    path.append(cur);
+    foreach (int i, dependencies[cur])
+    {
+      if (! done.contains(i))
+      {
+        cur = i;
+        break;
+      }
+    }
+  }
+  path = path.mid(path.indexOf(cur));
+  path.append(cur);
+
+  foreach (int i, path)
+    _cycle.append(_nodes.at(i).script->filename());
+
+  errMsg = TR("These scripts need each other in a cycle, each using "
+              "something the next one creates: %1")
+             .arg(_cycle.join(" -> "));
+
+  _order.clear();
+  for (int i = 0; i < n; i++)
+    _order.append(i);
+
+  return false;
+}
+
+QList<Script*> DbObjScheduler::order() const
+{
+  QList<Script*> result;
+  if (_order.size() == _nodes.size())
+    foreach (int i, _order)
+      result.append(_nodes.at(i).script);
+  else
+    foreach (Node node, _nodes)
+      result.append(node.script);
+  return result;
+}
+
+bool DbObjScheduler::reordered() const
+{
+  for (int i = 0; i < _order.size(); i++)
+    if (_order.at(i) != i)
+      return true;
+  return false;
+}
@@ -0,0 +1,70 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __DBOBJSCHEDULER_H__
+#define __DBOBJSCHEDULER_H__
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class Script;
+
+/* DbObjScheduler orders a package's SQL scripts so each runs after the
+   scripts that create what it uses.
+
+   add() the scripts in the order they would otherwise be applied. Each is
+   scanned once: the names it creates (its declared name for tables, views,
+   triggers and functions plus anything in a CREATE statement) and the
+   names it uses where they must already exist - after FROM, JOIN,
+   REFERENCES, ON, INHERITS or EXECUTE PROCEDURE, or called as a function.
+   Comments, quoted strings, dollar-quoted function bodies and DROP
+   statements are ignored, so plpgsql bodies and drop-before-recreate
+   scripts do not create false dependencies.
+
+   schedule() sorts topologically, keeping the original order wherever the
+   dependencies allow. If the scripts depend on each other in a cycle it
+   returns false, cycle() names the scripts in it and order() is the
+   original order.
+ */
+class DbObjScheduler
+{
+  public:
+    DbObjScheduler();
+    virtual ~DbObjScheduler();
+
+    virtual void add(Script *script, const QByteArray &data);
+    virtual void clear();
+    virtual bool schedule(QString &errMsg);
+
+    QList<Script*> order()     const;
+    QStringList    cycle()     const { return _cycle; }
+    bool           reordered() const;
+    int            size()      const { return _nodes.size(); }
+
+    static QStringList definitions(const QString &sql);
+    static QStringList references(const QString &sql);
+    static QString     stripped(const QString &sql);
+
+  protected:
+    struct Node
+    {
+      Script     *script;
+      QStringList defines;
+      QStringList uses;
+    };
+
+    QStringList _cycle;
+    QList<Node> _nodes;
+    QList<int>  _order;
+};
+
+#endif
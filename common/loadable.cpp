@@ -17,7 +17,8 @@
 #include <QVariant>     // used by XSqlQuery::value()
 #include <limits.h>
 
-#include "metasql.h"
+#include "loadablebatch.h"
+#include "statementcache.h"
 #include "xsqlquery.h"
 
 QRegExp Loadable::trueRegExp("^t(rue)?$",   Qt::CaseInsensitive);
@@ -31,10 +32,10 @@ Loadable::Loadable(const QString &nodename, const QString &name,
                    const int grade, const bool system, const QString &schema,
                    const QString &comment,
                    const QString &filename)
-  : _comment(comment), _grade(grade),       _gradeMql(0),
-    _insertMql(0),     _selectMql(0),       _maxMql(0),      _minMql(0),
+  : _batch(0),
+    _comment(comment), _hasFile(! filename.isEmpty()), _grade(grade),
     _name(name),       _nodename(nodename), _onError(Script::Default),
-    _schema(schema),   _stripBOM(true),     _system(system), _updateMql(0)
+    _schema(schema),   _stripBOM(true),     _system(system)
 {
   _filename = (filename.isEmpty() ? name   : filename);
   _schema   = (schema.isEmpty()   ? schema : "public");
@@ -42,9 +43,10 @@ Loadable::Loadable(const QString &nodename, const QString &name,
 
 Loadable::Loadable(const QDomElement &pElem, const bool pSystem,
                    QStringList &pMsg, QList<bool> &pFatal)
-  : _grade(0),        _gradeMql(0),
-    _insertMql(0),    _selectMql(0),    _maxMql(0), _minMql(0),
-    _stripBOM(true),  _system(pSystem), _updateMql(0)
+  : _batch(0),
+    _hasFile(false),
+    _grade(0),
+    _stripBOM(true),  _system(pSystem)
 {
   Q_UNUSED(pMsg);
   Q_UNUSED(pFatal);
@@ -74,7 +76,10 @@ Loadable::Loadable(const QDomElement &pElem, const bool pSystem,
   }
 
   if (pElem.hasAttribute("file"))
+  {
     _filename = pElem.attribute("file");
+    _hasFile  = true;
+  }
   else
     _filename = _name;
 
@@ -91,12 +96,6 @@ Loadable::Loadable(const QDomElement &pElem, const bool pSystem,
 
 Loadable::~Loadable()
 {
-  if (_minMql)    delete _minMql;
-  if (_maxMql)    delete _maxMql;
-  if (_gradeMql)  delete _gradeMql;
-  if (_selectMql) delete _selectMql;
-  if (_insertMql) delete _insertMql;
-  if (_updateMql) delete _updateMql;
 }
 
 QString Loadable::schema() const
@@ -104,6 +103,12 @@ QString Loadable::schema() const
   return _schema;
 }
 
+void Loadable::setFilename(const QString &filename)
+{
+  _filename = filename;
+  _hasFile  = ! filename.isEmpty();
+}
+
 QDomElement Loadable::createElement(QDomDocument & doc)
 {
   QDomElement elem = doc.createElement(_nodename);
@@ -123,11 +128,14 @@ int Loadable::writeToDB(QByteArray &pData, const QString pPkgname,
                         QString &errMsg, ParameterList &pParams)
 {
   cleanData(pData);
-  const char *fileContent = pData.data();
+
+  // pData may be a view over a mapped package; it need not be nul-terminated
+  const char *fileContent = pData.constData();
 
   pParams.append("name",   _name);
   pParams.append("type",   _pkgitemtype);
-  pParams.append("source", QString::fromLocal8Bit(fileContent));
+  pParams.append("source", QString::fromLocal8Bit(fileContent,
+                                                  qstrnlen(fileContent, pData.size())));
   pParams.append("notes",  _comment);
 
   // alter the name of the loadable's table if necessary
@@ -167,9 +175,21 @@ int Loadable::writeToDB(QByteArray &pData, const QString pPkgname,
     }
   }
 
-  if (_minMql && _minMql->isValid() && _grade == INT_MIN)
+  // the batch resolves grades and writes the item along with the others
+  if (_batch)
+  {
+    if (! _batch->add(this, pParams))
+    {
+      errMsg = TR("<font color=red>Could not add %1 to a batch of %2.</font>")
+                .arg(_filename).arg(_batch->nodename());
+      return -8;
+    }
+    return 0;
+  }
+
+  if (! _minMql.isEmpty() && _grade == INT_MIN)
   {
-    XSqlQuery minOrder = _minMql->toQuery(pParams);
+    XSqlQuery minOrder = StatementCache::exec(_minMql, pParams);
     if (minOrder.first())
       _grade = minOrder.value(0).toInt();
     else if (minOrder.lastError().type() != QSqlError::NoError)
@@ -181,9 +201,9 @@ int Loadable::writeToDB(QByteArray &pData, const QString pPkgname,
     else
       _grade = 0;
   }
-  else if (_maxMql && _maxMql->isValid() && _grade == INT_MAX)
+  else if (! _maxMql.isEmpty() && _grade == INT_MAX)
   {
-    XSqlQuery maxOrder = _maxMql->toQuery(pParams);
+    XSqlQuery maxOrder = StatementCache::exec(_maxMql, pParams);
     if (maxOrder.first())
       _grade = maxOrder.value(0).toInt();
     else if (maxOrder.lastError().type() != QSqlError::NoError)
@@ -198,10 +218,10 @@ int Loadable::writeToDB(QByteArray &pData, const QString pPkgname,
 
   pParams.append("grade", _grade);
 
-  if (_gradeMql && _gradeMql->isValid())
+  if (! _gradeMql.isEmpty())
   {
     XSqlQuery grade;
-    grade = _gradeMql->toQuery(pParams);
+    grade = StatementCache::exec(_gradeMql, pParams);
 
     if (grade.first())
       _grade = grade.value(0).toInt();
@@ -225,7 +245,7 @@ int Loadable::writeToDB(QByteArray &pData, const QString pPkgname,
 
   XSqlQuery select;
   int itemid = -1;
-  select = _selectMql->toQuery(pParams);
+  select = StatementCache::exec(_selectMql, pParams);
 
   if (select.first())
     itemid = select.value(0).toInt();
@@ -239,9 +259,9 @@ int Loadable::writeToDB(QByteArray &pData, const QString pPkgname,
 
   XSqlQuery upsert;
   if (itemid >= 0)
-    upsert = _updateMql->toQuery(pParams);
+    upsert = StatementCache::exec(_updateMql, pParams);
   else
-    upsert = _insertMql->toQuery(pParams);
+    upsert = StatementCache::exec(_insertMql, pParams);
 
   if (upsert.first())
     itemid = upsert.value("id").toInt();
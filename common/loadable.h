@@ -18,7 +18,7 @@
 
 class QDomDocument;
 class QDomElement;
-class MetaSQLQuery;
+class LoadableBatch;
 
 #define TR(a) QObject::tr(a)
 
@@ -35,17 +35,20 @@ class Loadable
 
     virtual QDomElement createElement(QDomDocument &doc);
 
+    virtual LoadableBatch *batch() const { return _batch; }
     virtual QString comment()  const { return _comment; }
     virtual QString filename() const { return _filename; }
     virtual int     grade()    const { return _grade; }
+    virtual bool    hasFile()  const { return _hasFile; }
     virtual bool    isValid()  const { return !_nodename.isEmpty() &&
                                               !_name.isEmpty();}
     virtual QString name()     const { return _name; }
     virtual QString nodename() const { return _nodename; }
     virtual Script::OnError onError() const { return _onError; }
     virtual QString schema()   const;
+    virtual void    setBatch(LoadableBatch *batch)      { _batch = batch; }
     virtual void    setComment(const QString & comment) { _comment  = comment; }
-    virtual void    setFilename(const QString &filename){ _filename = filename;}
+    virtual void    setFilename(const QString &filename);
     virtual void    setGrade(int grade)                 { _grade = grade; }
     virtual void    setName(const QString & name)       { _name = name; }
     virtual void    setOnError(Script::OnError onError) { _onError = onError; }
@@ -60,14 +63,16 @@ class Loadable
 
   protected:
 
+    LoadableBatch *_batch;
     QString      _comment;
     QString      _filename;
+    bool         _hasFile;  // false if package.xml alone describes the item
     int          _grade;
-    MetaSQLQuery *_gradeMql;
-    MetaSQLQuery *_insertMql;
-    MetaSQLQuery *_selectMql;
-    MetaSQLQuery *_maxMql;
-    MetaSQLQuery *_minMql;
+    QString      _gradeMql;
+    QString      _insertMql;
+    QString      _selectMql;
+    QString      _maxMql;
+    QString      _minMql;
     QString      _name;
     QString      _nodename;
     Script::OnError _onError;
@@ -75,7 +80,7 @@ class Loadable
     QString      _schema;
     bool         _stripBOM;
     bool         _system;
-    MetaSQLQuery *_updateMql;
+    QString      _updateMql;
 
     virtual int writeToDB(QByteArray &pData, const QString pPkgname,
                           QString &errMsg, ParameterList &pParams);
@@ -0,0 +1,357 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "loadablebatch.h"
+
+#include <QCryptographicHash>
+#include <QSqlError>
+#include <QStringList>
+#include <limits.h>
+
+#include "loadable.h"
+#include "pgpipeline.h"
+#include "xsqlquery.h"
+
+#define DEBUG false
+
+// rows per INSERT while staging; 11 parameters each stays far below
+// PostgreSQL's limit of 65535 bind parameters per statement
+#define STAGEROWS 500
+
+/* How a kind of Loadable maps onto its table. These mirror the MetaSQL in
+   the Loadable subclasses' writeToDB() methods and must be kept in step.
+   Unused columns are 0.
+ */
+struct LoadableBatchType
+{
+  const char *nodename;
+  const char *table;
+  const char *id;
+  const char *name;
+  const char *grade;
+  const char *source;
+  const char *notes;
+  const char *enabled;
+  const char *group;
+  bool        selectOnly;   // look for existing rows in ONLY the table
+  bool        updateOnly;   // UPDATE ONLY the table
+  bool        updateGrade;  // update sets the grade and enabled columns too
+  bool        sequenced;    // grades avoid those used by other packages
+};
+
+static const LoadableBatchType batchTypes[] = {
+  { "loadmetasql",   "metasql", "metasql_id", "metasql_name", "metasql_grade",
+    "metasql_query", "metasql_notes", 0, "metasql_group",
+    true,  false, false, true  },
+  { "loadreport",    "report",  "report_id",  "report_name",  "report_grade",
+    "report_source", "report_descrip", 0, 0,
+    true,  false, false, true  },
+  { "loadappui",     "uiform",  "uiform_id",  "uiform_name",  "uiform_order",
+    "uiform_source", "uiform_notes", "uiform_enabled", 0,
+    true,  false, true,  true  },
+  { "loadappscript", "script",  "script_id",  "script_name",  "script_order",
+    "script_source", "script_notes", "script_enabled", 0,
+    true,  true,  true,  false },
+  { "loadimage",     "image",   "image_id",   "image_name",   0,
+    "image_data",    "image_descrip", 0, 0,
+    false, false, false, false }
+};
+
+static const LoadableBatchType *findType(const QString &nodename)
+{
+  for (unsigned int i = 0; i < sizeof(batchTypes) / sizeof(batchTypes[0]); i++)
+    if (nodename == batchTypes[i].nodename)
+      return &batchTypes[i];
+  return 0;
+}
+
+static QString _batcherrtxt = TR("The following error was encountered while "
+                                 "trying to import a batch of %1 into the "
+                                 "database:<br><pre>%2</pre>");
+
+LoadableBatch::LoadableBatch(const QString &nodename)
+  : _bytes(0),
+    _incremental(true),
+    _inserted(0),
+    _unchanged(0),
+    _updated(0),
+    _nodename(nodename),
+    _type(findType(nodename))
+{
+}
+
+LoadableBatch::~LoadableBatch()
+{
+}
+
+bool LoadableBatch::supports(const QString &nodename)
+{
+  return findType(nodename) != 0;
+}
+
+/* Called by Loadable::writeToDB() with the item's parameters once the
+   destination table is known but before any grade has been resolved.
+ */
+bool LoadableBatch::add(Loadable *item, const ParameterList &params)
+{
+  if (! _type || ! item || item->nodename() != _nodename)
+    return false;
+
+  bool found = false;
+  Row row;
+  row.item      = item;
+  row.tablename = params.value("tablename").toString();
+  row.pkgname   = params.value("pkgname", &found);
+  if (! found)
+    row.pkgname = QVariant(QVariant::String);
+  row.group     = params.value("group").toString();
+  row.name      = params.value("name").toString();
+  row.grade     = _type->grade ? item->grade() : 0;
+  row.enabled   = params.value("enabled", &found);
+  if (! found)
+    row.enabled = QVariant(QVariant::Bool);
+  row.source    = params.value("source").toString();
+  row.hash      = QCryptographicHash::hash(row.source.toUtf8(),
+                                           QCryptographicHash::Md5).toHex();
+  row.notes     = params.value("notes").toString();
+
+  row.round = 0;
+  for (int i = 0; i < _rows.size(); i++)
+  {
+    const Row &prev = _rows.at(i);
+    if (prev.tablename == row.tablename && prev.name == row.name &&
+        prev.group == row.group && prev.round >= row.round)
+      row.round = prev.round + 1;
+  }
+
+  _rows.append(row);
+  _bytes += row.source.size() * sizeof(QChar);
+
+  return true;
+}
+
+void LoadableBatch::clear()
+{
+  _rows.clear();
+  _bytes = 0;
+}
+
+QList<Loadable*> LoadableBatch::items() const
+{
+  QList<Loadable*> result;
+  foreach (Row row, _rows)
+    result.append(row.item);
+  return result;
+}
+
+// copy the rows into a temporary table, many to a statement
+void LoadableBatch::stage(PgPipeline &pipeline)
+{
+  pipeline.append("CREATE TEMPORARY TABLE IF NOT EXISTS updaterbatch ("
+                  "  seq     INTEGER, tbl     TEXT,    round   INTEGER,"
+                  "  pkgname TEXT,    grp     TEXT,    name    TEXT,"
+                  "  grade   INTEGER, enabled BOOLEAN, source  TEXT,"
+                  "  notes   TEXT,    id      INTEGER, hash    TEXT,"
+                  "  unchanged BOOLEAN NOT NULL DEFAULT FALSE"
+                  ") ON COMMIT DROP;");
+  pipeline.append("TRUNCATE pg_temp.updaterbatch;");
+
+  for (int first = 0; first < _rows.size(); first += STAGEROWS)
+  {
+    int last = qMin(first + STAGEROWS, _rows.size());
+
+    QStringList     values;
+    QList<QVariant> params;
+    for (int i = first; i < last; i++)
+    {
+      const Row &row = _rows.at(i);
+      values.append("(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+      params << i            << row.tablename << row.round << row.pkgname
+             << row.group    << row.name      << row.grade << row.enabled
+             << row.source   << row.notes     << row.hash;
+    }
+
+    pipeline.append("INSERT INTO pg_temp.updaterbatch (seq, tbl, round, pkgname,"
+                    "  grp, name, grade, enabled, source, notes, hash"
+                    ") VALUES " + values.join(", ") + ";", params);
+  }
+}
+
+/* Append the statements that write the batch to pipeline.
+   Returns the number of items queued or a negative value on error.
+ */
+int LoadableBatch::queue(PgPipeline &pipeline, QString &errMsg)
+{
+  if (! _type)
+  {
+    errMsg = TR("<font color=red>Cannot load %1 items in a batch.</font>")
+              .arg(_nodename);
+    return -1;
+  }
+  if (_rows.isEmpty())
+    return 0;
+
+  stage(pipeline);
+
+  QStringList tables;
+  int         rounds = 0;
+  foreach (Row row, _rows)
+  {
+    if (! tables.contains(row.tablename))
+      tables.append(row.tablename);
+    rounds = qMax(rounds, row.round + 1);
+  }
+
+  // QString::arg() with several arguments wants QStrings, not char *s
+  QString table   = _type->table;
+  QString id      = _type->id;
+  QString name    = _type->name;
+  QString grade   = _type->grade;
+  QString source  = _type->source;
+  QString notes   = _type->notes;
+  QString enabled = _type->enabled;
+  QString group   = _type->group;
+  QString selectOnly = _type->selectOnly ? "ONLY" : "";
+  QString updateOnly = _type->updateOnly ? "ONLY" : "";
+
+  // every statement's first placeholders are the table name and round
+  QString filter  = "s.tbl=? AND s.round=?";
+  QString groupEq = _type->group ? QString(" AND t.%1=s.grp").arg(group)
+                                 : QString();
+  QString gradeEq = _type->grade ? QString(" AND t.%1=s.grade").arg(grade)
+                                 : QString();
+
+  QString sets = QString("%1=s.source, %2=s.notes").arg(source, notes);
+  if (_type->updateGrade)
+    sets += QString(", %1=s.grade, %2=s.enabled").arg(grade, enabled);
+
+  QString same = QString("md5(t.%1)=s.hash"
+                         " AND t.%2 IS NOT DISTINCT FROM s.notes").arg(source, notes);
+  if (_type->updateGrade)
+    same += QString(" AND t.%1 IS NOT DISTINCT FROM s.enabled").arg(enabled);
+
+  QStringList cols;
+  QStringList vals;
+  if (_type->group)   { cols << group;   vals << "s.grp";     }
+  cols << name;                          vals << "s.name";
+  if (_type->grade)   { cols << grade;   vals << "s.grade";   }
+  if (_type->enabled) { cols << enabled; vals << "s.enabled"; }
+  cols << source << notes;               vals << "s.source" << "s.notes";
+
+  foreach (QString tablename, tables)
+  {
+    for (int round = 0; round < rounds; round++)
+    {
+      QList<QVariant> params;
+      params << tablename << round;
+
+      if (_type->grade)
+      {
+        QString extreme = "UPDATE pg_temp.updaterbatch s"
+                          "   SET grade=COALESCE((SELECT %1(t.%2) FROM %3 t"
+                          "                        WHERE t.%4=s.name%5), 0)"
+                          " WHERE %6 AND s.grade=?;";
+        pipeline.append(extreme.arg(QString("MIN"), grade, table, name,
+                                    groupEq, filter),
+                        QList<QVariant>(params) << INT_MIN);
+        pipeline.append(extreme.arg(QString("MAX"), grade, table, name,
+                                    groupEq, filter),
+                        QList<QVariant>(params) << INT_MAX);
+      }
+
+      if (_type->sequenced)
+        pipeline.append(QString("UPDATE pg_temp.updaterbatch s"
+                                "   SET grade=COALESCE((SELECT MIN(sequence_value-1)"
+                                "        FROM sequence"
+                                "       WHERE sequence_value-1>=s.grade"
+                                "         AND sequence_value-1 NOT IN (SELECT t.%1"
+                                "              FROM %2 t"
+                                "              JOIN pg_class c ON t.tableoid=c.oid"
+                                "              JOIN pg_namespace n ON c.relnamespace=n.oid"
+                                "             WHERE t.%3=s.name%4"
+                                "               AND n.nspname!=s.pkgname)), 0)"
+                                " WHERE %5;")
+                          .arg(grade, table, name, groupEq, filter), params);
+
+      pipeline.append(QString("UPDATE pg_temp.updaterbatch s"
+                              "   SET id=t.%1"
+                              "  FROM %2 %3 t"
+                              " WHERE %4 AND t.%5=s.name%6%7;")
+                        .arg(id, selectOnly, tablename, filter, name,
+                             gradeEq, groupEq), params);
+
+      if (_incremental)
+        pipeline.append(QString("UPDATE pg_temp.updaterbatch s"
+                                "   SET unchanged=TRUE"
+                                "  FROM %1 %2 t"
+                                " WHERE %3 AND t.%4=s.id AND %5;")
+                          .arg(selectOnly, tablename, filter, id, same), params);
+
+      pipeline.append(QString("UPDATE %1 %2 t"
+                              "   SET %3"
+                              "  FROM pg_temp.updaterbatch s"
+                              " WHERE %4 AND t.%5=s.id AND NOT s.unchanged;")
+                        .arg(updateOnly, tablename, sets, filter, id), params);
+
+      pipeline.append(QString("INSERT INTO %1 (%2)"
+                              " SELECT %3 FROM pg_temp.updaterbatch s"
+                              "  WHERE %4 AND s.id IS NULL"
+                              "  ORDER BY s.seq;")
+                        .arg(tablename, cols.join(", "), vals.join(", "),
+                             filter), params);
+    }
+  }
+
+  return _rows.size();
+}
+
+/* Returns the number of items written or a negative value on error. On
+   error the database is left part way through the batch; the caller must
+   roll back.
+ */
+int LoadableBatch::writeToDB(QString &errMsg)
+{
+  PgPipeline pipeline;
+  int queued = queue(pipeline, errMsg);
+  if (queued <= 0)
+    return queued;
+
+  // everything is in flight at once when the connection can pipeline
+  QString message;
+  if (! pipeline.run(message))
+  {
+    if (DEBUG)
+      qDebug("LoadableBatch::writeToDB() statement %d of the batch failed",
+             pipeline.failedAt());
+    errMsg = _batcherrtxt.arg(_nodename).arg(message);
+    return -2;
+  }
+
+  // inserted rows keep a NULL id in the staging table
+  XSqlQuery countq;
+  countq.exec("SELECT SUM(CASE WHEN unchanged THEN 1 ELSE 0 END) AS unchanged,"
+              "       SUM(CASE WHEN id IS NOT NULL AND NOT unchanged"
+              "                THEN 1 ELSE 0 END) AS updated,"
+              "       SUM(CASE WHEN id IS NULL THEN 1 ELSE 0 END) AS inserted"
+              "  FROM pg_temp.updaterbatch;");
+  if (countq.first())
+  {
+    _unchanged += countq.value("unchanged").toInt();
+    _updated   += countq.value("updated").toInt();
+    _inserted  += countq.value("inserted").toInt();
+  }
+  else if (countq.lastError().type() != QSqlError::NoError)
+  {
+    errMsg = _batcherrtxt.arg(_nodename).arg(countq.lastError().text());
+    return -2;
+  }
+
+  return _rows.size();
+}
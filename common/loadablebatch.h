@@ -0,0 +1,102 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __LOADABLEBATCH_H__
+#define __LOADABLEBATCH_H__
+
+#include <QList>
+#include <QString>
+#include <QVariant>
+
+#include <parameter.h>
+
+class Loadable;
+class PgPipeline;
+struct LoadableBatchType;
+
+/* LoadableBatch writes many Loadables of one kind with a handful of
+   set-based statements instead of five round trips per item.
+
+   While a Loadable has a batch set, its writeToDB() prepares the item as
+   usual - parsing, encoding, choosing the destination table - and then
+   hands the resulting parameters to add() instead of querying the database.
+   writeToDB() on the batch stages everything in a temporary table and
+   resolves grades, finds existing rows, updates and inserts for the whole
+   batch at once, following the same rules as Loadable::writeToDB().
+
+   Items that share a name are written in successive rounds so each one sees
+   the ones before it, as it would if they were loaded one at a time.
+
+   Only metasql, report, uiform, script and image loadables are supported;
+   see supports(). The batch does not manage savepoints. If writeToDB()
+   fails, roll back and load the items one at a time to find the culprit.
+   queue() appends the same statements to a pipeline without running them.
+
+   By default the batch is incremental: an existing row whose source has
+   the same md5 as the item's, and whose notes and enabled flag match, is
+   left alone, so it is not rewritten and its triggers do not fire. After
+   writeToDB(), inserted(), unchanged() and updated() count the outcomes
+   of every batch written since the LoadableBatch was created.
+   setIncremental(false) rewrites every row as Loadable::writeToDB() does.
+ */
+class LoadableBatch
+{
+  public:
+    LoadableBatch(const QString &nodename);
+    virtual ~LoadableBatch();
+
+    virtual bool add(Loadable *item, const ParameterList &params);
+    virtual void clear();
+    virtual int  queue(PgPipeline &pipeline, QString &errMsg);
+    virtual int  writeToDB(QString &errMsg);
+
+    QList<Loadable*> items() const;
+    bool    isValid()  const { return _type != 0; }
+    QString nodename() const { return _nodename; }
+    int     size()     const { return _rows.size(); }
+    qint64  bytes()    const { return _bytes; }
+
+    bool    incremental() const { return _incremental; }
+    void    setIncremental(bool p) { _incremental = p; }
+    int     inserted()    const { return _inserted; }
+    int     unchanged()   const { return _unchanged; }
+    int     updated()     const { return _updated; }
+
+    static bool supports(const QString &nodename);
+
+  protected:
+    struct Row
+    {
+      Loadable *item;
+      QString   tablename;
+      QVariant  pkgname;
+      QString   group;
+      QString   name;
+      int       grade;
+      QVariant  enabled;
+      QString   source;
+      QString   hash;
+      QString   notes;
+      int       round;
+    };
+
+    qint64      _bytes;
+    bool        _incremental;
+    int         _inserted;
+    int         _unchanged;
+    int         _updated;
+    QString     _nodename;
+    QList<Row>  _rows;
+    const LoadableBatchType *_type;
+
+    virtual void stage(PgPipeline &pipeline);
+};
+
+#endif
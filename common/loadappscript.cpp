@@ -12,7 +12,6 @@
 
 #include <QDomElement>
 
-#include "metasql.h"
 #include "xsqlquery.h"
 
 LoadAppScript::LoadAppScript(const QString &name, const int order,
@@ -84,36 +83,36 @@ int LoadAppScript::writeToDB(QByteArray &pdata, const QString pkgname, QString &
     return -2;
   }
 
-  _minMql = new MetaSQLQuery("SELECT MIN(script_order) AS min "
-                   "FROM script "
-                   "WHERE (script_name=<? value('name') ?>);");
-
-  _maxMql = new MetaSQLQuery("SELECT MAX(script_order) AS max "
-                   "FROM script "
-                   "WHERE (script_name=<? value('name') ?>);");
-
-  _selectMql = new MetaSQLQuery("SELECT script_id, -1, -1"
-                      "  FROM ONLY <? literal('tablename') ?> "
-                      " WHERE ((script_name=<? value('name') ?>)"
-                      "    AND (script_order=<? value('grade') ?>));");
-
-  _updateMql = new MetaSQLQuery("UPDATE ONLY <? literal('tablename') ?> "
-                      "   SET script_order=<? value('grade') ?>, "
-                      "       script_enabled=<? value('enabled') ?>,"
-                      "       script_source=<? value('source') ?>,"
-                      "       script_notes=<? value('notes') ?> "
-                      " WHERE (script_id=<? value('id') ?>) "
-                      "RETURNING script_id AS id; ");
-
-  _insertMql = new MetaSQLQuery("INSERT INTO <? literal('tablename') ?> ("
-                      "    script_id, script_name,"
-                      "    script_order, script_enabled,"
-                      "    script_source, script_notes"
-                      ") VALUES (DEFAULT, <? value('name') ?>, "
-                      "    <? value('grade') ?>,  <? value('enabled') ?>,"
-                      "    <? value('source') ?>,"
-                      "    <? value('notes') ?>) "
-                      "RETURNING script_id AS id;");
+  _minMql = "SELECT MIN(script_order) AS min "
+            "FROM script "
+            "WHERE (script_name=<? value('name') ?>);";
+
+  _maxMql = "SELECT MAX(script_order) AS max "
+            "FROM script "
+            "WHERE (script_name=<? value('name') ?>);";
+
+  _selectMql = "SELECT script_id, -1, -1"
+               "  FROM ONLY <? literal('tablename') ?> "
+               " WHERE ((script_name=<? value('name') ?>)"
+               "    AND (script_order=<? value('grade') ?>));";
+
+  _updateMql = "UPDATE ONLY <? literal('tablename') ?> "
+               "   SET script_order=<? value('grade') ?>, "
+               "       script_enabled=<? value('enabled') ?>,"
+               "       script_source=<? value('source') ?>,"
+               "       script_notes=<? value('notes') ?> "
+               " WHERE (script_id=<? value('id') ?>) "
+               "RETURNING script_id AS id; ";
+
+  _insertMql = "INSERT INTO <? literal('tablename') ?> ("
+               "    script_id, script_name,"
+               "    script_order, script_enabled,"
+               "    script_source, script_notes"
+               ") VALUES (DEFAULT, <? value('name') ?>, "
+               "    <? value('grade') ?>,  <? value('enabled') ?>,"
+               "    <? value('source') ?>,"
+               "    <? value('notes') ?>) "
+               "RETURNING script_id AS id;";
 
   ParameterList params;
   params.append("enabled",   QVariant(_enabled));
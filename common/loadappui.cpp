@@ -14,7 +14,6 @@
 #include <QVariant>     // used by XSqlQuery::bindValue()
 #include <limits.h>
 
-#include "metasql.h"
 #include "xsqlquery.h"
 
 #define DEBUG false
@@ -113,47 +112,47 @@ int LoadAppUI::writeToDB(QByteArray &pdata, const QString pkgname, QString &errM
     qDebug("LoadAppUI::writeToDB() name after looking for class node: %s",
            qPrintable(_name));
 
-  _minMql = new MetaSQLQuery("SELECT MIN(uiform_order) AS min "
-                   "FROM uiform "
-                   "WHERE (uiform_name=<? value('name') ?>);");
-
-  _maxMql = new MetaSQLQuery("SELECT MAX(uiform_order) AS max "
-                   "FROM uiform "
-                   "WHERE (uiform_name=<? value('name') ?>);");
-
-  _gradeMql = new MetaSQLQuery("SELECT MIN(sequence_value-1) "
-                     "            FROM sequence "
-                     "           WHERE sequence_value-1>=<? value('grade') ?> "
-                     "             AND sequence_value-1 NOT IN (SELECT uiform_order "
-                     "                                            FROM uiform "
-                     "                                            JOIN pg_class c ON uiform.tableoid=c.oid "
-                     "                                            JOIN pg_namespace n ON c.relnamespace=n.oid "
-                     "                                           WHERE uiform_name=<? value('name') ?> "
-                     "                                             AND n.nspname!=<? value('pkgname') ?>);");
-
-  _selectMql = new MetaSQLQuery("SELECT uiform_id, -1, -1"
-                      "  FROM ONLY <? literal('tablename') ?> "
-                      " WHERE ((uiform_name=<? value('name') ?>)"
-                      "   AND  (uiform_order=<? value('grade') ?>));");
-
-  _updateMql = new MetaSQLQuery("UPDATE <? literal('tablename') ?> "
-                      "   SET uiform_order=<? value('grade') ?>, "
-                      "       uiform_enabled=<? value('enabled') ?>,"
-                      "       uiform_source=<? value('source') ?>,"
-                      "       uiform_notes=<? value('notes') ?> "
-                      " WHERE (uiform_id=<? value('id') ?>) "
-                      "RETURNING uiform_id AS id;");
-
-  _insertMql = new MetaSQLQuery("INSERT INTO <? literal('tablename') ?> ("
-                      "    uiform_id, uiform_name,"
-                      "    uiform_order, uiform_enabled, "
-                      "    uiform_source, uiform_notes"
-                      ") VALUES ("
-                      "    DEFAULT, <? value('name') ?>,"
-                      "    <? value('grade') ?>, <? value('enabled') ?>,"
-                      "    <? value('source') ?>,"
-                      "    <? value('notes') ?>) "
-                      "RETURNING uiform_id AS id;");
+  _minMql = "SELECT MIN(uiform_order) AS min "
+            "FROM uiform "
+            "WHERE (uiform_name=<? value('name') ?>);";
+
+  _maxMql = "SELECT MAX(uiform_order) AS max "
+            "FROM uiform "
+            "WHERE (uiform_name=<? value('name') ?>);";
+
+  _gradeMql = "SELECT MIN(sequence_value-1) "
+              "            FROM sequence "
+              "           WHERE sequence_value-1>=<? value('grade') ?> "
+              "             AND sequence_value-1 NOT IN (SELECT uiform_order "
+              "                                            FROM uiform "
+              "                                            JOIN pg_class c ON uiform.tableoid=c.oid "
+              "                                            JOIN pg_namespace n ON c.relnamespace=n.oid "
+              "                                           WHERE uiform_name=<? value('name') ?> "
+              "                                             AND n.nspname!=<? value('pkgname') ?>);";
+
+  _selectMql = "SELECT uiform_id, -1, -1"
+               "  FROM ONLY <? literal('tablename') ?> "
+               " WHERE ((uiform_name=<? value('name') ?>)"
+               "   AND  (uiform_order=<? value('grade') ?>));";
+
+  _updateMql = "UPDATE <? literal('tablename') ?> "
+               "   SET uiform_order=<? value('grade') ?>, "
+               "       uiform_enabled=<? value('enabled') ?>,"
+               "       uiform_source=<? value('source') ?>,"
+               "       uiform_notes=<? value('notes') ?> "
+               " WHERE (uiform_id=<? value('id') ?>) "
+               "RETURNING uiform_id AS id;";
+
+  _insertMql = "INSERT INTO <? literal('tablename') ?> ("
+               "    uiform_id, uiform_name,"
+               "    uiform_order, uiform_enabled, "
+               "    uiform_source, uiform_notes"
+               ") VALUES ("
+               "    DEFAULT, <? value('name') ?>,"
+               "    <? value('grade') ?>, <? value('enabled') ?>,"
+               "    <? value('source') ?>,"
+               "    <? value('notes') ?>) "
+               "RETURNING uiform_id AS id;";
 
   ParameterList params;
   params.append("enabled",   QVariant(_enabled));
@@ -14,7 +14,6 @@
 #include <QSqlError>
 
 #include "loadable.h"
-#include "metasql.h"
 #include "xsqlquery.h"
 
 #define DEBUG false
@@ -130,30 +129,30 @@ QDomElement LoadCmd::createElement(QDomDocument &doc)
 int LoadCmd::writeToDB(QByteArray &pdata, const QString pkgname, QString &errMsg)
 {
   Q_UNUSED(pdata);
-  _selectMql = new MetaSQLQuery("SELECT cmd_id, -1, -1"
-                      "  FROM <? literal('tablename') ?> "
-                      " WHERE (cmd_name=<? value('name') ?>);");
-
-  _updateMql = new MetaSQLQuery("UPDATE <? literal('tablename') ?> "
-                      "   SET cmd_module=<? value('module') ?>, "
-                      "       cmd_title=<? value('title') ?>, "
-                      "       cmd_privname=<? value('privname') ?>, "
-                      "       cmd_executable=<? value('executable') ?>, "
-                      "       cmd_descrip=<? value('notes') ?> "
-                      " WHERE (cmd_id=<? value('id') ?>) "
-                      "RETURNING cmd_id AS id;");
-
-  _insertMql = new MetaSQLQuery("INSERT INTO <? literal('tablename') ?> ("
-                      "  cmd_id, cmd_module,"
-                      "  cmd_title, cmd_descrip, "
-                      "  cmd_privname,"
-                      "  cmd_executable, cmd_name"
-                      ") VALUES ("
-                      "  DEFAULT, <? value('module') ?>,"
-                      "  <? value('title') ?>, <? value('notes') ?>,"
-                      "  <? value('privname') ?>,"
-                      "  <? value('executable') ?>, <? value('name') ?>)"
-                      " RETURNING cmd_id AS id;");
+  _selectMql = "SELECT cmd_id, -1, -1"
+               "  FROM <? literal('tablename') ?> "
+               " WHERE (cmd_name=<? value('name') ?>);";
+
+  _updateMql = "UPDATE <? literal('tablename') ?> "
+               "   SET cmd_module=<? value('module') ?>, "
+               "       cmd_title=<? value('title') ?>, "
+               "       cmd_privname=<? value('privname') ?>, "
+               "       cmd_executable=<? value('executable') ?>, "
+               "       cmd_descrip=<? value('notes') ?> "
+               " WHERE (cmd_id=<? value('id') ?>) "
+               "RETURNING cmd_id AS id;";
+
+  _insertMql = "INSERT INTO <? literal('tablename') ?> ("
+               "  cmd_id, cmd_module,"
+               "  cmd_title, cmd_descrip, "
+               "  cmd_privname,"
+               "  cmd_executable, cmd_name"
+               ") VALUES ("
+               "  DEFAULT, <? value('module') ?>,"
+               "  <? value('title') ?>, <? value('notes') ?>,"
+               "  <? value('privname') ?>,"
+               "  <? value('executable') ?>, <? value('name') ?>)"
+               " RETURNING cmd_id AS id;";
 
   ParameterList params;
   params.append("tablename", "cmd");
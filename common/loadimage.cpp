@@ -17,7 +17,6 @@
 #include <QImage>
 #include <QImageWriter>
 
-#include "metasql.h"
 #include "quuencode.h"
 
 #define DEBUG false
@@ -109,23 +108,23 @@ int LoadImage::writeToDB(QByteArray &pData, const QString pPkgname, QString &err
       qDebug() << "LoadImage::writeToDB() uuencoded image" << encodeddata.left(160);
   }
 
-  _selectMql = new MetaSQLQuery("SELECT image_id, -1, -1"
-                      "  FROM <? literal('tablename') ?> "
-                      " WHERE (image_name=<? value('name') ?>);");
-
-  _updateMql = new MetaSQLQuery("UPDATE <? literal('tablename') ?> "
-                      "   SET image_data=<? value('source') ?>,"
-                      "       image_descrip=<? value('notes') ?>"
-                      " WHERE (image_id=<? value('id') ?>)"
-                      " RETURNING image_id AS id;");
-
-  _insertMql = new MetaSQLQuery("INSERT INTO <? literal('tablename') ?> ("
-                      "   image_id, image_name, image_data, image_descrip"
-                      ") VALUES ("
-                      "  DEFAULT, <? value('name') ?>,"
-                      "  <? value('source') ?>,"
-                      "  <? value('notes') ?>"
-                      ") RETURNING image_id AS id;");
+  _selectMql = "SELECT image_id, -1, -1"
+               "  FROM <? literal('tablename') ?> "
+               " WHERE (image_name=<? value('name') ?>);";
+
+  _updateMql = "UPDATE <? literal('tablename') ?> "
+               "   SET image_data=<? value('source') ?>,"
+               "       image_descrip=<? value('notes') ?>"
+               " WHERE (image_id=<? value('id') ?>)"
+               " RETURNING image_id AS id;";
+
+  _insertMql = "INSERT INTO <? literal('tablename') ?> ("
+               "   image_id, image_name, image_data, image_descrip"
+               ") VALUES ("
+               "  DEFAULT, <? value('name') ?>,"
+               "  <? value('source') ?>,"
+               "  <? value('notes') ?>"
+               ") RETURNING image_id AS id;";
 
   ParameterList params;
   params.append("tablename", "image");
@@ -14,7 +14,6 @@
 #include <QSqlError>
 #include <QVariant>     // used by XSqlQuery::bindValue()
 
-#include "metasql.h"
 #include "xsqlquery.h"
 
 #define DEBUG false
@@ -66,8 +65,9 @@ int LoadMetasql::writeToDB(QByteArray &pdata, const QString pkgname, QString &er
     return -2;
   }
 
-  const char *fileContent = pdata.data();
-  QString metasqlStr = QString::fromLocal8Bit(fileContent);
+  const char *fileContent = pdata.constData();
+  QString metasqlStr = QString::fromLocal8Bit(fileContent,
+                                              qstrnlen(fileContent, pdata.size()));
   QStringList lines  = metasqlStr.split("\n");
   QRegExp groupRE    = QRegExp("(^\\s*--\\s*GROUP:\\s*)(.*)",Qt::CaseInsensitive);
   QRegExp nameRE     = QRegExp("(^\\s*--\\s*NAME:\\s*)(.*)", Qt::CaseInsensitive);
@@ -106,47 +106,47 @@ int LoadMetasql::writeToDB(QByteArray &pdata, const QString pkgname, QString &er
            qPrintable(_name), qPrintable(_group), qPrintable(_comment),
            qPrintable(metasqlStr));
 
-  _minMql = new MetaSQLQuery("SELECT MIN(metasql_grade) AS min "
-                   "FROM metasql "
-                   "WHERE (metasql_group=<? value('group') ?>) "
-                   "AND (metasql_name=<? value('name') ?>);");
-
-  _maxMql = new MetaSQLQuery("SELECT MAX(metasql_grade) AS max "
-                   "FROM metasql "
-                   "WHERE (metasql_group=<? value('group') ?>) "
-                   "AND (metasql_name=<? value('name') ?>);");
-
-  _gradeMql = new MetaSQLQuery("SELECT MIN(sequence_value-1) "
-                     "            FROM sequence "
-                     "           WHERE sequence_value-1>=<? value('grade') ?> "
-                     "             AND sequence_value-1 NOT IN (SELECT metasql_grade "
-                     "                                            FROM metasql "
-                     "                                            JOIN pg_class c ON metasql.tableoid=c.oid "
-                     "                                            JOIN pg_namespace n ON c.relnamespace=n.oid "
-                     "                                           WHERE metasql_group=<? value('group') ?> "
-                     "                                             AND metasql_name=<? value('name') ?> "
-                     "                                             AND n.nspname!=<? value('pkgname') ?>);");
-
-  _selectMql = new MetaSQLQuery("SELECT metasql_id, -1, -1"
-                      "  FROM ONLY <? literal('tablename') ?> "
-                      " WHERE ((metasql_group=<? value('group') ?>) "
-                      "    AND (metasql_name=<? value('name') ?>) "
-                      "    AND (metasql_grade=<? value('grade') ?>) );");
-
-  _updateMql = new MetaSQLQuery("UPDATE <? literal('tablename') ?> "
-                      "   SET metasql_notes=<? value('notes') ?>, "
-                      "       metasql_query=<? value('source') ?> "
-                      " WHERE (metasql_id=<? value('id') ?>) "
-                      "RETURNING metasql_id AS id;");
-
-  _insertMql = new MetaSQLQuery("INSERT INTO <? literal('tablename') ?> ("
-                      "    metasql_group, metasql_name,"
-                      "    metasql_grade, metasql_query, metasql_notes"
-                      ") VALUES ("
-                      "    <? value('group') ?>, <? value('name') ?>,"
-                      "    <? value('grade') ?>, <? value('source') ?>,"
-                      "    <? value('notes') ?>) "
-                      "RETURNING metasql_id AS id;");
+  _minMql = "SELECT MIN(metasql_grade) AS min "
+            "FROM metasql "
+            "WHERE (metasql_group=<? value('group') ?>) "
+            "AND (metasql_name=<? value('name') ?>);";
+
+  _maxMql = "SELECT MAX(metasql_grade) AS max "
+            "FROM metasql "
+            "WHERE (metasql_group=<? value('group') ?>) "
+            "AND (metasql_name=<? value('name') ?>);";
+
+  _gradeMql = "SELECT MIN(sequence_value-1) "
+              "            FROM sequence "
+              "           WHERE sequence_value-1>=<? value('grade') ?> "
+              "             AND sequence_value-1 NOT IN (SELECT metasql_grade "
+              "                                            FROM metasql "
+              "                                            JOIN pg_class c ON metasql.tableoid=c.oid "
+              "                                            JOIN pg_namespace n ON c.relnamespace=n.oid "
+              "                                           WHERE metasql_group=<? value('group') ?> "
+              "                                             AND metasql_name=<? value('name') ?> "
+              "                                             AND n.nspname!=<? value('pkgname') ?>);";
+
+  _selectMql = "SELECT metasql_id, -1, -1"
+               "  FROM ONLY <? literal('tablename') ?> "
+               " WHERE ((metasql_group=<? value('group') ?>) "
+               "    AND (metasql_name=<? value('name') ?>) "
+               "    AND (metasql_grade=<? value('grade') ?>) );";
+
+  _updateMql = "UPDATE <? literal('tablename') ?> "
+               "   SET metasql_notes=<? value('notes') ?>, "
+               "       metasql_query=<? value('source') ?> "
+               " WHERE (metasql_id=<? value('id') ?>) "
+               "RETURNING metasql_id AS id;";
+
+  _insertMql = "INSERT INTO <? literal('tablename') ?> ("
+               "    metasql_group, metasql_name,"
+               "    metasql_grade, metasql_query, metasql_notes"
+               ") VALUES ("
+               "    <? value('group') ?>, <? value('name') ?>,"
+               "    <? value('grade') ?>, <? value('source') ?>,"
+               "    <? value('notes') ?>) "
+               "RETURNING metasql_id AS id;";
 
   ParameterList params;
   params.append("tablename", "metasql");
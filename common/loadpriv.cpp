@@ -12,7 +12,6 @@
 
 #include <QDomDocument>
 
-#include "metasql.h"
 #include "xsqlquery.h"
 
 #include "loadable.h"
@@ -82,22 +81,22 @@ int LoadPriv::writeToDB(QByteArray &pData, const QString pPkgname, QString &errM
                .arg(_name);
   }
 
-  _selectMql = new MetaSQLQuery("SELECT priv_id AS id, -1, -1"
-                      "  FROM <? literal('tablename') ?> "
-                      " WHERE (priv_name=<? value('name') ?>);");
-
-  _updateMql = new MetaSQLQuery("UPDATE <? literal('tablename') ?> "
-                      "   SET priv_module=<? value('module') ?>, "
-                      "       priv_descrip=<? value('notes') ?> "
-                      " WHERE (priv_id=<? value('id') ?>) "
-                      "RETURNING priv_id AS id;");
-
-  _insertMql = new MetaSQLQuery("INSERT INTO <? literal('tablename') ?> ("
-                      "    priv_id, priv_module, priv_name, priv_descrip "
-                      ") VALUES ("
-                      "    DEFAULT, <? value('module') ?>,"
-                      "    <? value('name') ?>, <? value('notes') ?>) "
-                      "RETURNING priv_id AS id;");
+  _selectMql = "SELECT priv_id AS id, -1, -1"
+               "  FROM <? literal('tablename') ?> "
+               " WHERE (priv_name=<? value('name') ?>);";
+
+  _updateMql = "UPDATE <? literal('tablename') ?> "
+               "   SET priv_module=<? value('module') ?>, "
+               "       priv_descrip=<? value('notes') ?> "
+               " WHERE (priv_id=<? value('id') ?>) "
+               "RETURNING priv_id AS id;";
+
+  _insertMql = "INSERT INTO <? literal('tablename') ?> ("
+               "    priv_id, priv_module, priv_name, priv_descrip "
+               ") VALUES ("
+               "    DEFAULT, <? value('module') ?>,"
+               "    <? value('name') ?>, <? value('notes') ?>) "
+               "RETURNING priv_id AS id;";
 
   ParameterList params;
   params.append("tablename", "priv");
@@ -15,7 +15,6 @@
 #include <QString>
 #include <QVariant>
 
-#include "metasql.h"
 #include "xsqlquery.h"
 
 LoadQm::LoadQm(const QString &name, const int grade, const bool system, const QString &comment, const QString &filename)
@@ -107,23 +106,23 @@ int LoadQm::writeToDB(QByteArray &pData, const QString pPkgname, QString &errMsg
     return -1;
   }
 
-  _selectMql = new MetaSQLQuery("SELECT dict_id "
-                                "  FROM ONLY <? literal('tablename') ?> "
-                                " WHERE dict_lang_id=<? value('lang') ?> "
-                                "   AND COALESCE(dict_country_id, -1)=COALESCE(<? value('country') ?>, -1) "
-                                "   AND dict_version=<? value('version') ?>;");
-
-  _updateMql = new MetaSQLQuery("UPDATE <? literal('tablename') ?> "
-                                "   SET dict_data=<? value('data') ?> "
-                                " WHERE dict_id=<? value('id') ?> "
-                                "RETURNING dict_id AS id;");
-
-  _insertMql = new MetaSQLQuery("INSERT INTO <? literal('tablename') ?> "
-                                "(dict_lang_id, dict_country_id, "
-                                " dict_data, dict_version) "
-                                "VALUES (<? value('lang') ?>, <? value('country') ?>, "
-                                " <? value('data') ?>, <? value('version') ?>) "
-                                "RETURNING dict_id AS id;");
+  _selectMql = "SELECT dict_id "
+               "  FROM ONLY <? literal('tablename') ?> "
+               " WHERE dict_lang_id=<? value('lang') ?> "
+               "   AND COALESCE(dict_country_id, -1)=COALESCE(<? value('country') ?>, -1) "
+               "   AND dict_version=<? value('version') ?>;";
+
+  _updateMql = "UPDATE <? literal('tablename') ?> "
+               "   SET dict_data=<? value('data') ?> "
+               " WHERE dict_id=<? value('id') ?> "
+               "RETURNING dict_id AS id;";
+
+  _insertMql = "INSERT INTO <? literal('tablename') ?> "
+               "(dict_lang_id, dict_country_id, "
+               " dict_data, dict_version) "
+               "VALUES (<? value('lang') ?>, <? value('country') ?>, "
+               " <? value('data') ?>, <? value('version') ?>) "
+               "RETURNING dict_id AS id;";
 
   ParameterList params;
   params.append("tablename", "dict");
@@ -12,7 +12,6 @@
 
 #include <QDomDocument>
 
-#include "metasql.h"
 #include "xsqlquery.h"
 
 LoadReport::LoadReport(const QString &name, const int grade, const bool system,
@@ -76,43 +75,43 @@ int LoadReport::writeToDB(QByteArray &pData, const QString pPkgname, QString &er
     return -3;
   }
 
-  _minMql = new MetaSQLQuery("SELECT MIN(report_grade) AS min "
-                   "FROM report "
-                   "WHERE (report_name=<? value('name') ?>);");
-
-  _maxMql = new MetaSQLQuery("SELECT MAX(report_grade) AS max "
-                   "FROM report "
-                   "WHERE (report_name=<? value('name') ?>);");
-
-  _gradeMql = new MetaSQLQuery("SELECT MIN(sequence_value-1) "
-                     "            FROM sequence "
-                     "           WHERE sequence_value-1>=<? value('grade') ?> "
-                     "             AND sequence_value-1 NOT IN (SELECT report_grade "
-                     "                                            FROM report "
-                     "                                            JOIN pg_class c ON report.tableoid=c.oid "
-                     "                                            JOIN pg_namespace n ON c.relnamespace=n.oid "
-                     "                                           WHERE report_name=<? value('name') ?> "
-                     "                                             AND n.nspname!=<? value('pkgname') ?>);");
-
-  _selectMql = new MetaSQLQuery("SELECT report_id, -1, -1"
-                      "  FROM ONLY <? literal('tablename') ?> "
-                      " WHERE ((report_name=<? value('name') ?>) "
-                      "    AND (report_grade=<? value('grade') ?>) );");
-
-  _updateMql = new MetaSQLQuery("UPDATE <? literal('tablename') ?> "
-                      "   SET report_descrip=<? value('notes') ?>, "
-                      "       report_source=<? value('source') ?> "
-                      " WHERE (report_id=<? value('id') ?>) "
-                      "RETURNING report_id AS id;");
-
-  _insertMql = new MetaSQLQuery("INSERT INTO <? literal('tablename') ?> ("
-                      "    report_id, report_name,"
-                      "    report_grade, report_source, report_descrip"
-                      ") VALUES ("
-                      "    DEFAULT, <? value('name') ?>,"
-                      "    <? value('grade') ?>, <? value('source') ?>,"
-                      "    <? value('notes') ?>) "
-                      "RETURNING report_id AS id;");
+  _minMql = "SELECT MIN(report_grade) AS min "
+            "FROM report "
+            "WHERE (report_name=<? value('name') ?>);";
+
+  _maxMql = "SELECT MAX(report_grade) AS max "
+            "FROM report "
+            "WHERE (report_name=<? value('name') ?>);";
+
+  _gradeMql = "SELECT MIN(sequence_value-1) "
+              "            FROM sequence "
+              "           WHERE sequence_value-1>=<? value('grade') ?> "
+              "             AND sequence_value-1 NOT IN (SELECT report_grade "
+              "                                            FROM report "
+              "                                            JOIN pg_class c ON report.tableoid=c.oid "
+              "                                            JOIN pg_namespace n ON c.relnamespace=n.oid "
+              "                                           WHERE report_name=<? value('name') ?> "
+              "                                             AND n.nspname!=<? value('pkgname') ?>);";
+
+  _selectMql = "SELECT report_id, -1, -1"
+               "  FROM ONLY <? literal('tablename') ?> "
+               " WHERE ((report_name=<? value('name') ?>) "
+               "    AND (report_grade=<? value('grade') ?>) );";
+
+  _updateMql = "UPDATE <? literal('tablename') ?> "
+               "   SET report_descrip=<? value('notes') ?>, "
+               "       report_source=<? value('source') ?> "
+               " WHERE (report_id=<? value('id') ?>) "
+               "RETURNING report_id AS id;";
+
+  _insertMql = "INSERT INTO <? literal('tablename') ?> ("
+               "    report_id, report_name,"
+               "    report_grade, report_source, report_descrip"
+               ") VALUES ("
+               "    DEFAULT, <? value('name') ?>,"
+               "    <? value('grade') ?>, <? value('source') ?>,"
+               "    <? value('notes') ?>) "
+               "RETURNING report_id AS id;";
 
   ParameterList params;
   params.append("tablename", "report");
@@ -11,10 +11,12 @@
 #include "package.h"
 
 #include <QDomDocument>
+#include <QHash>
 #include <QList>
 #include <QMessageBox>
 #include <QSqlError>
 #include <QVariant>
+#include <QXmlStreamReader>
 
 #include "createfunction.h"
 #include "createtable.h"
@@ -44,8 +46,172 @@ Package::Package(const QString & id)
 {
 }
 
+/* Each child element of <package> is handed to the factory registered for
+   its tag name, which adds the item it describes to the package.
+ */
+typedef void (*ItemFactory)(Package *, const QDomElement &, QStringList &, QList<bool> &);
+
+static void addFunction(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_functions.append(new CreateFunction(elem, msgList, fatalList)); }
+
+static void addTable(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_tables.append(new CreateTable(elem, msgList, fatalList)); }
+
+static void addTrigger(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_triggers.append(new CreateTrigger(elem, msgList, fatalList)); }
+
+static void addView(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_views.append(new CreateView(elem, msgList, fatalList)); }
+
+static void addMetasql(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_metasqls.append(new LoadMetasql(elem, pkg->system(), msgList, fatalList)); }
+
+static void addPriv(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_privs.append(new LoadPriv(elem, pkg->system(), msgList, fatalList)); }
+
+static void addReport(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_reports.append(new LoadReport(elem, pkg->system(), msgList, fatalList)); }
+
+static void addAppUI(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_appuis.append(new LoadAppUI(elem, pkg->system(), msgList, fatalList)); }
+
+static void addAppScript(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_appscripts.append(new LoadAppScript(elem, pkg->system(), msgList, fatalList)); }
+
+static void addCmd(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_cmds.append(new LoadCmd(elem, pkg->system(), msgList, fatalList)); }
+
+static void addImage(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_images.append(new LoadImage(elem, pkg->system(), msgList, fatalList)); }
+
+static void addQm(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_qms.append(new LoadQm(elem, pkg->system(), msgList, fatalList)); }
+
+static void addPrerequisite(Package *pkg, const QDomElement &elem, QStringList &, QList<bool> &)
+{ pkg->_prerequisites.append(new Prerequisite(elem)); }
+
+static void addScript(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_scripts.append(new Script(elem, msgList, fatalList)); }
+
+static void addFinalScript(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_finalscripts.append(new FinalScript(elem, msgList, fatalList)); }
+
+static void addInitScript(Package *pkg, const QDomElement &elem, QStringList &msgList, QList<bool> &fatalList)
+{ pkg->_initscripts.append(new InitScript(elem, msgList, fatalList)); }
+
+static void ignoreElement(Package *, const QDomElement &, QStringList &, QList<bool> &)
+{ }
+
+static QHash<QString, ItemFactory> itemFactories()
+{
+  QHash<QString, ItemFactory> result;
+  result.insert("createfunction", addFunction);
+  result.insert("createtable",    addTable);
+  result.insert("createtrigger",  addTrigger);
+  result.insert("createview",     addView);
+  result.insert("loadmetasql",    addMetasql);
+  result.insert("loadpriv",       addPriv);
+  result.insert("loadreport",     addReport);
+  result.insert("loadappui",      addAppUI);
+  result.insert("loadappscript",  addAppScript);
+  result.insert("loadcmd",        addCmd);
+  result.insert("loadimage",      addImage);
+  result.insert("loadqm",         addQm);
+  result.insert("prerequisite",   addPrerequisite);
+  result.insert("script",         addScript);
+  result.insert("finalscript",    addFinalScript);
+  result.insert("initscript",     addInitScript);
+  result.insert("comment",        ignoreElement);
+  return result;
+}
+
+/* Copy the element the reader is positioned on, with its attributes and
+   everything inside it, into doc so the item constructors can read it.
+ */
+static QDomElement readElement(QXmlStreamReader &reader, QDomDocument &doc)
+{
+  QDomElement elem = doc.createElement(reader.qualifiedName().toString());
+  foreach (QXmlStreamAttribute attr, reader.attributes())
+    elem.setAttribute(attr.qualifiedName().toString(), attr.value().toString());
+
+  while (! reader.atEnd())
+  {
+    reader.readNext();
+    if (reader.isStartElement())
+      elem.appendChild(readElement(reader, doc));
+    else if (reader.isCharacters())
+      elem.appendChild(doc.createTextNode(reader.text().toString()));
+    else if (reader.isEndElement())
+      break;
+  }
+
+  return elem;
+}
+
 Package::Package(const QDomElement & elem, QStringList &msgList,
                  QList<bool> &fatalList, XAbstractMessageHandler *handler)
+{
+  if (! setHeader(elem, msgList, fatalList))
+    return;
+
+  QStringList reportedErrorTags;
+
+  QDomNodeList nList = elem.childNodes();
+  for(int n = 0; n < nList.count(); ++n)
+  {
+    if (nList.item(n).isComment())
+      continue;
+    addElement(nList.item(n).toElement(), msgList, fatalList,
+               reportedErrorTags, handler);
+  }
+
+  if (DEBUG)
+  {
+    qDebug("Package::Package(QDomElement) msgList & fatalList at %d and %d",
+           msgList.size(), fatalList.size());
+    dumpCounts();
+  }
+}
+
+/* Build the package straight from package.xml without a DOM tree of the
+   whole file. Only one child of <package> at a time is turned into a small
+   QDomElement, so the items are built and checked exactly as they are by
+   the QDomElement constructor. Check reader.hasError() afterwards for
+   malformed XML.
+ */
+Package::Package(QXmlStreamReader &reader, QStringList &msgList,
+                 QList<bool> &fatalList, XAbstractMessageHandler *handler)
+{
+  if (! reader.readNextStartElement())
+    return;
+
+  QDomDocument scratch;
+  QDomElement  root = scratch.createElement(reader.qualifiedName().toString());
+  foreach (QXmlStreamAttribute attr, reader.attributes())
+    root.setAttribute(attr.qualifiedName().toString(), attr.value().toString());
+
+  if (! setHeader(root, msgList, fatalList))
+    return;
+
+  QStringList reportedErrorTags;
+  while (reader.readNextStartElement())
+    addElement(readElement(reader, scratch), msgList, fatalList,
+               reportedErrorTags, handler);
+
+  while (! reader.atEnd())      // so errors after </package> are caught too
+    reader.readNext();
+
+  if (DEBUG)
+  {
+    qDebug("Package::Package(QXmlStreamReader) msgList & fatalList at %d and %d",
+           msgList.size(), fatalList.size());
+    dumpCounts();
+  }
+}
+
+// check and copy the attributes of the <package> element
+bool Package::setHeader(const QDomElement & elem, QStringList &msgList,
+                        QList<bool> &fatalList)
 {
   if (elem.tagName() != "package")
   {
@@ -62,7 +228,7 @@ Package::Package(const QDomElement & elem, QStringList &msgList,
       msgList << TR("Could not parse the application's version string %1")
                   .arg(Updater::version);
       fatalList << true;
-      return;
+      return false;
     }
 
     XVersion requiredversion(elem.attribute("updater"));
@@ -71,7 +237,7 @@ Package::Package(const QDomElement & elem, QStringList &msgList,
       msgList << TR("Could not parse the updater version string %1 required "
                     "by the package") .arg(elem.attribute("updater"));
       fatalList << true;
-      return;
+      return false;
     }
 
     if (updaterversion < requiredversion)
@@ -81,7 +247,7 @@ Package::Package(const QDomElement & elem, QStringList &msgList,
                     "a newer updater.")
                   .arg(elem.attribute("updater")).arg(Updater::version);
       fatalList << true;
-      return;
+      return false;
     }
   }
 
@@ -91,7 +257,7 @@ Package::Package(const QDomElement & elem, QStringList &msgList,
   _descrip = elem.attribute("descrip");
 
   if (DEBUG)
-    qDebug("Package::Package() - _name '%s', _developer '%s' => system %d",
+    qDebug("Package::setHeader() - _name '%s', _developer '%s' => system %d",
            qPrintable(_name), qPrintable(_developer), system());
 
   if (elem.hasAttribute("version"))
@@ -102,7 +268,7 @@ Package::Package(const QDomElement & elem, QStringList &msgList,
       msgList << TR("Could not parse the package version string %1.")
                   .arg(elem.attribute("version"));
       fatalList << true;
-      return;
+      return false;
     }
   }
   else if (! system())
@@ -110,82 +276,51 @@ Package::Package(const QDomElement & elem, QStringList &msgList,
     msgList << TR("Add-on packages must have version numbers but the package "
                   "element has no version attribute.");
     fatalList << true;
-    return;
+    return false;
   }
 
-  QStringList reportedErrorTags;
+  return true;
+}
 
-  QDomNodeList nList = elem.childNodes();
-  for(int n = 0; n < nList.count(); ++n)
+void Package::addElement(const QDomElement & elemThis, QStringList &msgList,
+                         QList<bool> &fatalList, QStringList &reportedErrorTags,
+                         XAbstractMessageHandler *handler)
+{
+  static const QHash<QString, ItemFactory> factories = itemFactories();
+
+  QHash<QString, ItemFactory>::const_iterator it = factories.constFind(elemThis.tagName());
+  if (it != factories.constEnd())
+    it.value()(this, elemThis, msgList, fatalList);
+  else if (elemThis.tagName() == "pkgnotes")
+    _notes += elemThis.text();
+  else if (! reportedErrorTags.contains(elemThis.tagName()))
   {
-    QDomElement elemThis = nList.item(n).toElement();
-    if (elemThis.tagName() == "createfunction")
-      _functions.append(new CreateFunction(elemThis, msgList, fatalList));
-    else if (elemThis.tagName() == "createtable")
-      _tables.append(new CreateTable(elemThis, msgList, fatalList));
-    else if (elemThis.tagName() == "createtrigger")
-      _triggers.append(new CreateTrigger(elemThis, msgList, fatalList));
-    else if (elemThis.tagName() == "createview")
-      _views.append(new CreateView(elemThis, msgList, fatalList));
-    else if(elemThis.tagName() == "loadmetasql")
-      _metasqls.append(new LoadMetasql(elemThis, system(), msgList, fatalList));
-    else if(elemThis.tagName() == "loadpriv")
-      _privs.append(new LoadPriv(elemThis, system(), msgList, fatalList));
-    else if(elemThis.tagName() == "loadreport")
-      _reports.append(new LoadReport(elemThis, system(), msgList, fatalList));
-    else if(elemThis.tagName() == "loadappui")
-      _appuis.append(new LoadAppUI(elemThis, system(), msgList, fatalList));
-    else if(elemThis.tagName() == "loadappscript")
-      _appscripts.append(new LoadAppScript(elemThis, system(), msgList, fatalList));
-    else if(elemThis.tagName() == "loadcmd")
-      _cmds.append(new LoadCmd(elemThis, system(), msgList, fatalList));
-    else if(elemThis.tagName() == "loadimage")
-      _images.append(new LoadImage(elemThis, system(), msgList, fatalList));
-    else if(elemThis.tagName() == "loadqm")
-      _qms.append(new LoadQm(elemThis, system(), msgList, fatalList));
-    else if (elemThis.tagName() == "pkgnotes")
-      _notes += elemThis.text();
-    else if(elemThis.tagName() == "prerequisite")
-      _prerequisites.append(new Prerequisite(elemThis));
-    else if(elemThis.tagName() == "script")
-      _scripts.append(new Script(elemThis, msgList, fatalList));
-    else if(elemThis.tagName() == "finalscript")
-      _finalscripts.append(new FinalScript(elemThis, msgList, fatalList));
-    else if(elemThis.tagName() == "initscript")
-      _initscripts.append(new InitScript(elemThis, msgList, fatalList));
-    else if(elemThis.tagName() == "comment" || nList.item(n).isComment())
-      ; // ignore <comment> tags and XML comments
-    else if (! reportedErrorTags.contains(elemThis.tagName()))
-    {
-      if (handler)
-        handler->message(QtWarningMsg,
-                         TR("This package contains an element '%1'. "
-                            "The application does not know how to "
-                            "process it and so it will be ignored.")
-                           .arg(elemThis.tagName()));
-      reportedErrorTags << elemThis.tagName();
-    }
+    if (handler)
+      handler->message(QtWarningMsg,
+                       TR("This package contains an element '%1'. "
+                          "The application does not know how to "
+                          "process it and so it will be ignored.")
+                         .arg(elemThis.tagName()));
+    reportedErrorTags << elemThis.tagName();
   }
+}
 
-  if (DEBUG)
-  {
-    qDebug("Package::Package(QDomElement) msgList & fatalList at %d and %d",
-           msgList.size(), fatalList.size());
-    qDebug("_functions:     %d", _functions.size());
-    qDebug("_tables:        %d", _tables.size());
-    qDebug("_triggers:      %d", _triggers.size());
-    qDebug("_views:         %d", _views.size());
-    qDebug("_metasqls:      %d", _metasqls.size());
-    qDebug("_privs:         %d", _privs.size());
-    qDebug("_reports:       %d", _reports.size());
-    qDebug("_appuis:        %d", _appuis.size());
-    qDebug("_appscripts:    %d", _appscripts.size());
-    qDebug("_cmds:          %d", _cmds.size());
-    qDebug("_images:        %d", _images.size());
-    qDebug("_qms:           %d", _qms.size());
-    qDebug("_prerequisites: %d", _prerequisites.size());
-    qDebug("_scripts:       %d", _scripts.size());
-  }
+void Package::dumpCounts() const
+{
+  qDebug("_functions:     %d", _functions.size());
+  qDebug("_tables:        %d", _tables.size());
+  qDebug("_triggers:      %d", _triggers.size());
+  qDebug("_views:         %d", _views.size());
+  qDebug("_metasqls:      %d", _metasqls.size());
+  qDebug("_privs:         %d", _privs.size());
+  qDebug("_reports:       %d", _reports.size());
+  qDebug("_appuis:        %d", _appuis.size());
+  qDebug("_appscripts:    %d", _appscripts.size());
+  qDebug("_cmds:          %d", _cmds.size());
+  qDebug("_images:        %d", _images.size());
+  qDebug("_qms:           %d", _qms.size());
+  qDebug("_prerequisites: %d", _prerequisites.size());
+  qDebug("_scripts:       %d", _scripts.size());
 }
 
 Package::~Package()
@@ -18,6 +18,7 @@
 
 class QDomDocument;
 class QDomElement;
+class QXmlStreamReader;
 
 class Loadable;
 class Prerequisite;
@@ -29,6 +30,7 @@ class Package
   public:
     Package(const QString & id = QString::null);
     Package(const QDomElement &, QStringList &, QList<bool> &, XAbstractMessageHandler *);
+    Package(QXmlStreamReader &, QStringList &, QList<bool> &, XAbstractMessageHandler *);
 
     virtual ~Package();
 
@@ -84,6 +86,11 @@ class Package
     XVersion    _pkgversion;
     QString     _name;
     QString     _notes;
+
+    void addElement(const QDomElement &, QStringList &, QList<bool> &,
+                    QStringList &reportedErrorTags, XAbstractMessageHandler *);
+    void dumpCounts() const;
+    bool setHeader(const QDomElement &, QStringList &, QList<bool> &);
 };
 
 #endif
@@ -0,0 +1,472 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "pgpipeline.h"
+
+#include <QByteArray>
+#include <QObject>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlField>
+#include <QVector>
+
+#ifdef HAVE_LIBPQ
+#include <libpq-fe.h>
+#endif
+
+#ifdef LIBPQ_HAS_PIPELINING
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#else
+#include <sys/select.h>
+#endif
+#endif
+
+#include "xsqlquery.h"
+
+#define DEBUG false
+#define TR(a) QObject::tr(a)
+
+static bool isIdentChar(QChar c)
+{
+  return c.isLetterOrNumber() || c == '_' || c == '$';
+}
+
+/* If a string literal, quoted identifier, comment or dollar-quoted body
+   starts at sql[i], the index just past its end (or the end of sql if it is
+   not closed); otherwise i. Placeholders and semicolons inside these do not
+   count, just as the server and the QPSQL driver see them.
+ */
+static int skipQuoted(const QString &sql, int i)
+{
+  QChar c    = sql.at(i);
+  QChar next = i + 1 < sql.size() ? sql.at(i + 1) : QChar();
+
+  if (c == '\'')
+  {
+    // E'...' strings take backslash escapes
+    bool escapes = i > 0 && (sql.at(i - 1) == 'E' || sql.at(i - 1) == 'e') &&
+                   (i < 2 || ! isIdentChar(sql.at(i - 2)));
+    for (int j = i + 1; j < sql.size(); j++)
+    {
+      if (escapes && sql.at(j) == '\\')
+        j++;
+      else if (sql.at(j) == '\'')
+      {
+        if (j + 1 < sql.size() && sql.at(j + 1) == '\'')
+          j++;
+        else
+          return j + 1;
+      }
+    }
+    return sql.size();
+  }
+  else if (c == '"')
+  {
+    int end = sql.indexOf('"', i + 1);
+    return end < 0 ? sql.size() : end + 1;
+  }
+  else if (c == '-' && next == '-')
+  {
+    int end = sql.indexOf('\n', i + 2);
+    return end < 0 ? sql.size() : end + 1;
+  }
+  else if (c == '/' && next == '*')
+  {
+    int depth = 1;      // block comments nest in PostgreSQL
+    for (int j = i + 2; j < sql.size() - 1; j++)
+    {
+      if (sql.at(j) == '/' && sql.at(j + 1) == '*')
+      {
+        depth++;
+        j++;
+      }
+      else if (sql.at(j) == '*' && sql.at(j + 1) == '/')
+      {
+        j++;
+        if (--depth == 0)
+          return j + 1;
+      }
+    }
+    return sql.size();
+  }
+  else if (c == '$' && (i == 0 || ! isIdentChar(sql.at(i - 1))))
+  {
+    // $$ or $tag$, but not a $1 parameter
+    int j = i + 1;
+    if (j < sql.size() && sql.at(j).isDigit())
+      return i;
+    while (j < sql.size() && sql.at(j) != '$' && isIdentChar(sql.at(j)))
+      j++;
+    if (j >= sql.size() || sql.at(j) != '$')
+      return i;
+
+    QString tag = sql.mid(i, j - i + 1);
+    int     end = sql.indexOf(tag, j + 1);
+    return end < 0 ? sql.size() : end + tag.size();
+  }
+
+  return i;
+}
+
+#ifdef LIBPQ_HAS_PIPELINING
+// the libpq connection behind a QPSQL database connection, if there is one
+static PGconn *pgconn(QSqlDatabase &db)
+{
+  if (! db.isOpen() || ! db.driver())
+    return 0;
+
+  QVariant handle = db.driver()->handle();
+  if (handle.isValid() && qstrcmp(handle.typeName(), "PGconn*") == 0)
+    return *static_cast<PGconn **>(handle.data());
+
+  return 0;
+}
+
+/* Send what libpq has buffered on a nonblocking connection. While the
+   socket will take no more, read whatever the server has sent so it is
+   never left waiting for us to read while we wait for it to.
+ */
+static bool flush(PGconn *conn)
+{
+  int pending;
+  while ((pending = PQflush(conn)) == 1)
+  {
+    int    sock = PQsocket(conn);
+    fd_set readable;
+    fd_set writable;
+    FD_ZERO(&readable);
+    FD_ZERO(&writable);
+    FD_SET(sock, &readable);
+    FD_SET(sock, &writable);
+    if (select(sock + 1, &readable, &writable, 0, 0) < 0)
+      return false;
+    if (FD_ISSET(sock, &readable) && ! PQconsumeInput(conn))
+      return false;
+  }
+  return pending == 0;
+}
+
+// the first column of the first row of res, typed as QPSQL would type it
+static QVariant firstValue(PGresult *res)
+{
+  if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) < 1 ||
+      PQnfields(res) < 1 || PQgetisnull(res, 0, 0))
+    return QVariant();
+
+  QString text = QString::fromUtf8(PQgetvalue(res, 0, 0));
+  switch (PQftype(res, 0))
+  {
+    case 16:                            // bool
+      return QVariant(text == "t");
+    case 20: case 21: case 23:          // int8, int2, int4
+      return QVariant(text.toLongLong());
+    case 700: case 701: case 1700:      // float4, float8, numeric
+      return QVariant(text.toDouble());
+    default:
+      return QVariant(text);
+  }
+}
+
+#endif
+
+PgPipeline::PgPipeline(QSqlDatabase db)
+  : _db(db),
+    _enabled(true),
+    _failedAt(-1)
+{
+}
+
+PgPipeline::~PgPipeline()
+{
+}
+
+/* sql with its XSqlQuery-style ? placeholders numbered for libpq as $1,
+   $2, ... A ? in a string, quoted identifier, comment or dollar-quoted
+   body is left alone; any other ? is taken for a placeholder, so the jsonb
+   ? operators cannot be used in statements that take parameters.
+ */
+QByteArray PgPipeline::numbered(const QString &sql)
+{
+  QString result;
+  int     param = 0;
+  for (int i = 0; i < sql.size(); )
+  {
+    int end = skipQuoted(sql, i);
+    if (end > i)
+    {
+      result += sql.mid(i, end - i);
+      i = end;
+    }
+    else if (sql.at(i) == '?')
+    {
+      result += QString("$%1").arg(++param);
+      i++;
+    }
+    else
+      result += sql.at(i++);
+  }
+  return result.toUtf8();
+}
+
+// false if sql holds more than one statement, which a pipeline cannot send
+bool PgPipeline::isSingleStatement(const QString &sql)
+{
+  bool ended = false;   // seen a ; outside quotes
+  for (int i = 0; i < sql.size(); )
+  {
+    int end = skipQuoted(sql, i);
+    QChar c = sql.at(i);
+    if (end > i)
+    {
+      bool comment = c == '-' || c == '/';
+      if (ended && ! comment)
+        return false;
+      i = end;
+    }
+    else if (c == ';')
+    {
+      ended = true;
+      i++;
+    }
+    else if (ended && ! c.isSpace())
+      return false;
+    else
+      i++;
+  }
+  return true;
+}
+
+bool PgPipeline::available(QSqlDatabase db)
+{
+#ifdef LIBPQ_HAS_PIPELINING
+  return pgconn(db) != 0;
+#else
+  Q_UNUSED(db);
+  return false;
+#endif
+}
+
+bool PgPipeline::isPipelined() const
+{
+  return _enabled && available(_db);
+}
+
+void PgPipeline::append(const QString &sql, const QList<QVariant> &params)
+{
+  Statement stmt;
+  stmt.sql    = sql;
+  stmt.params = params;
+  _queue.append(stmt);
+}
+
+// the queue with each ? replaced by its parameter quoted by the driver
+QStringList PgPipeline::statements() const
+{
+  QStringList result;
+  foreach (Statement stmt, _queue)
+  {
+    QString sql;
+    int     param = 0;
+    for (int i = 0; i < stmt.sql.size(); )
+    {
+      int end = skipQuoted(stmt.sql, i);
+      if (end > i)
+      {
+        sql += stmt.sql.mid(i, end - i);
+        i = end;
+      }
+      else if (stmt.sql.at(i) == '?' && param < stmt.params.size())
+      {
+        QVariant  value = stmt.params.at(param++);
+        QSqlField field("param", value.type());
+        field.setValue(value);
+        sql += _db.driver() ? _db.driver()->formatValue(field)
+                            : QString("'%1'").arg(value.toString()
+                                                  .replace("'", "''"));
+        i++;
+      }
+      else
+        sql += stmt.sql.at(i++);
+    }
+    result.append(sql);
+  }
+  return result;
+}
+
+/* the first column of the first row statement index returned in the last
+   run(), or an invalid QVariant if it returned no rows or did not run
+ */
+QVariant PgPipeline::value(int index) const
+{
+  return _values.value(index);
+}
+
+void PgPipeline::clear()
+{
+  _queue.clear();
+}
+
+bool PgPipeline::run(QString &errMsg)
+{
+  _failedAt = -1;
+  _values.clear();
+  for (int i = 0; i < _queue.size(); i++)
+    _values.append(QVariant());
+  if (_queue.isEmpty())
+    return true;
+
+  // the extended protocol behind pipelining takes one statement at a time
+  bool pipelined = isPipelined();
+  for (int i = 0; i < _queue.size() && pipelined; i++)
+    pipelined = isSingleStatement(_queue.at(i).sql);
+
+  bool result = pipelined ? runPipelined(errMsg) : runQueries(errMsg);
+  _queue.clear();
+  return result;
+}
+
+bool PgPipeline::runQueries(QString &errMsg)
+{
+  for (int i = 0; i < _queue.size(); i++)
+  {
+    const Statement &stmt = _queue.at(i);
+    XSqlQuery qry;
+    bool ok;
+    if (stmt.params.isEmpty())
+      ok = qry.exec(stmt.sql);
+    else
+    {
+      qry.prepare(stmt.sql);
+      foreach (QVariant param, stmt.params)
+        qry.addBindValue(param);
+      ok = qry.exec();
+    }
+
+    if (! ok)
+    {
+      QSqlError err = qry.lastError();
+      errMsg = err.driverText() + "<br>" + err.databaseText();
+      _failedAt = i;
+      return false;
+    }
+    if (qry.first())
+      _values[i] = qry.value(0);
+  }
+  return true;
+}
+
+/* Statements may return rows, e.g. Query prerequisites, and the server
+   stops reading once we stop reading its results. Sending in blocking mode
+   could then wait forever, so the statements are sent in nonblocking mode
+   with flush() reading results into libpq's buffer while the socket is
+   full. The connection goes back to blocking mode to collect the results.
+ */
+bool PgPipeline::runPipelined(QString &errMsg)
+{
+#ifdef LIBPQ_HAS_PIPELINING
+  PGconn *conn = pgconn(_db);
+  if (! conn || PQpipelineStatus(conn) != PQ_PIPELINE_OFF ||
+      ! PQenterPipelineMode(conn))
+    return runQueries(errMsg);
+  if (PQsetnonblocking(conn, 1) != 0)
+  {
+    PQexitPipelineMode(conn);
+    return runQueries(errMsg);
+  }
+
+  if (DEBUG)
+    qDebug("PgPipeline::runPipelined() sending %d statements", _queue.size());
+
+  int sent = 0;
+  for (; sent < _queue.size(); sent++)
+  {
+    const Statement &stmt = _queue.at(sent);
+    // without parameters a ? is an operator, not a placeholder
+    QByteArray sql = stmt.params.isEmpty() ? stmt.sql.toUtf8()
+                                           : numbered(stmt.sql);
+
+    QList<QByteArray> values;
+    foreach (QVariant param, stmt.params)
+    {
+      if (param.isNull())
+        values.append(QByteArray());
+      else if (param.type() == QVariant::Bool)
+        values.append(param.toBool() ? "t" : "f");
+      else
+        values.append(param.toString().toUtf8());
+    }
+
+    QVector<const char *> ptrs;
+    for (int i = 0; i < values.size(); i++)
+      ptrs.append(stmt.params.at(i).isNull() ? 0 : values.at(i).constData());
+
+    if (! PQsendQueryParams(conn, sql.constData(), ptrs.size(), 0,
+                            ptrs.isEmpty() ? 0 : ptrs.constData(), 0, 0, 0) ||
+        ! flush(conn))
+    {
+      errMsg = TR("Could not send a statement to the database:<br>%1")
+                .arg(QString::fromUtf8(PQerrorMessage(conn)));
+      _failedAt = sent;
+      break;
+    }
+  }
+
+  if (! PQpipelineSync(conn) || ! flush(conn))
+  {
+    if (_failedAt < 0)
+    {
+      errMsg = TR("Could not send a statement to the database:<br>%1")
+                .arg(QString::fromUtf8(PQerrorMessage(conn)));
+      _failedAt = sent;
+    }
+    PQsetnonblocking(conn, 0);
+    PQexitPipelineMode(conn);
+    return false;
+  }
+  PQsetnonblocking(conn, 0);
+
+  // each statement's results end with a null; the sync point comes last
+  for (int i = 0; i < sent; i++)
+  {
+    PGresult *res;
+    while ((res = PQgetResult(conn)) != 0)
+    {
+      if (PQresultStatus(res) == PGRES_FATAL_ERROR && _failedAt < 0)
+      {
+        errMsg = QString::fromUtf8(PQresultErrorMessage(res));
+        _failedAt = i;
+      }
+      else if (PQresultStatus(res) == PGRES_TUPLES_OK)
+        _values[i] = firstValue(res);
+      PQclear(res);
+    }
+  }
+
+  PGresult *res;
+  while ((res = PQgetResult(conn)) != 0)
+  {
+    bool synced = PQresultStatus(res) == PGRES_PIPELINE_SYNC;
+    PQclear(res);
+    if (synced)
+      break;
+  }
+
+  if (! PQexitPipelineMode(conn) && _failedAt < 0)
+  {
+    errMsg = QString::fromUtf8(PQerrorMessage(conn));
+    _failedAt = sent;
+  }
+
+  return _failedAt < 0;
+#else
+  return runQueries(errMsg);
+#endif
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __PGPIPELINE_H__
+#define __PGPIPELINE_H__
+
+#include <QList>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+/* PgPipeline sends a series of statements to the server without waiting
+   for each result, using libpq's pipeline mode on the connection behind a
+   QSqlDatabase. Statements use ? placeholders, as XSqlQuery does. The
+   pipeline reports whether each one succeeded and, for checks that
+   SELECT a single answer, keeps the first column of the first row each
+   statement returned as value().
+
+   append() queues a statement and run() sends them all, waits for all of
+   the results and empties the queue. If a statement fails the server skips
+   the rest; run() reports the first failure and its index, and the
+   surrounding transaction must be rolled back, just as after a failed
+   XSqlQuery.
+
+   Pipelining needs libpq 14 or later and the QPSQL driver, and every
+   statement in the queue must be a single statement. Otherwise, or when
+   setEnabled(false), run() executes the queue with XSqlQuery one statement
+   at a time, so callers need not care which they get.
+
+   statements() renders the queue as plain SQL with the parameters written
+   out as literals, for callers that want to run it some other way.
+ */
+class PgPipeline
+{
+  public:
+    PgPipeline(QSqlDatabase db = QSqlDatabase::database());
+    virtual ~PgPipeline();
+
+    virtual void append(const QString &sql,
+                        const QList<QVariant> &params = QList<QVariant>());
+    virtual void clear();
+    virtual bool run(QString &errMsg);
+
+    QStringList statements() const;
+    QVariant    value(int index) const;
+
+    bool isPipelined() const;
+    int  failedAt()    const { return _failedAt; }
+    int  size()        const { return _queue.size(); }
+    void setEnabled(bool p)  { _enabled = p; }
+
+    static bool       available(QSqlDatabase db = QSqlDatabase::database());
+    static bool       isSingleStatement(const QString &sql);
+    static QByteArray numbered(const QString &sql);
+
+  protected:
+    struct Statement
+    {
+      QString         sql;
+      QList<QVariant> params;
+    };
+
+    QSqlDatabase     _db;
+    bool             _enabled;
+    int              _failedAt;  // index of the statement that failed
+    QList<Statement> _queue;
+    QList<QVariant>  _values;    // from the last run(), one per statement
+
+    virtual bool runPipelined(QString &errMsg);
+    virtual bool runQueries(QString &errMsg);
+};
+
+#endif
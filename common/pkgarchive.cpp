@@ -0,0 +1,1091 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "pkgarchive.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QObject>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <string.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#define TR(a) QObject::tr(a)
+
+#define DEBUG false
+
+#define CHUNK     16384
+#define TARBLOCK  512
+
+// frames bigger than this are streamed rather than decoded in one piece
+#define MAXFRAME  (64 * 1024 * 1024)
+
+#define INDEXMAGIC    0x58555049      // "XUPI"
+#define INDEXVERSION  2
+
+// element names in package.xml, indexed by item type. append only
+static const char *itemTags[] = {
+  "",
+  "package",
+  "initscript",
+  "script",
+  "createfunction",
+  "createtable",
+  "createtrigger",
+  "createview",
+  "loadpriv",
+  "loadmetasql",
+  "loadreport",
+  "loadappui",
+  "loadappscript",
+  "loadimage",
+  "loadqm",
+  "loadcmd",
+  "finalscript",
+  0
+};
+
+struct ZstdJob
+{
+  const uchar *src;
+  qint64       csize;
+  QByteArray   out;
+  QString      error;
+};
+
+static void decodeZstdJob(ZstdJob &job)
+{
+  size_t result = ZSTD_decompress(job.out.data(), job.out.size(),
+                                  job.src, job.csize);
+  if (ZSTD_isError(result))
+    job.error = ZSTD_getErrorName(result);
+  else
+    job.out.resize(result);
+}
+
+/* Decompress the single gzip member or zstd frame at the start of src, or at
+   least the first max bytes of it if max is not negative. consumed is set to
+   the compressed size of the frame if its end was reached, otherwise -1.
+   Returns an error message, empty on success.
+ */
+static QString decodeFrame(PkgArchive::Format format, const uchar *src,
+                           qint64 avail, qint64 max, QByteArray &out,
+                           qint64 &consumed)
+{
+  char    buf[CHUNK];
+  QString error;
+
+  out.clear();
+  consumed = -1;
+
+  if (format == PkgArchive::Gzip)
+  {
+    z_stream strm;
+    memset(&strm, 0, sizeof(z_stream));
+    if (inflateInit2(&strm, 15 + 16) != Z_OK)
+      return QString("inflateInit2");
+    strm.next_in  = (Bytef *)src;
+    strm.avail_in = (uInt)qMin(avail, (qint64)0x7fffffff);
+
+    int ret = Z_OK;
+    while (ret == Z_OK && (max < 0 || out.size() < max))
+    {
+      strm.next_out  = (Bytef *)buf;
+      strm.avail_out = sizeof(buf);
+      ret = inflate(&strm, Z_NO_FLUSH);
+      out.append(buf, sizeof(buf) - strm.avail_out);
+    }
+    if (ret == Z_STREAM_END)
+      consumed = strm.total_in;
+    else if (ret != Z_OK)
+      error = strm.msg ? strm.msg : "truncated";
+    inflateEnd(&strm);
+  }
+  else if (format == PkgArchive::Zstd)
+  {
+    ZSTD_DStream  *dstream = ZSTD_createDStream();
+    ZSTD_inBuffer  in      = { src, (size_t)avail, 0 };
+    size_t         result  = 1;
+    ZSTD_initDStream(dstream);
+    while (result != 0 && (max < 0 || out.size() < max))
+    {
+      ZSTD_outBuffer ob = { buf, sizeof(buf), 0 };
+      result = ZSTD_decompressStream(dstream, &ob, &in);
+      if (ZSTD_isError(result))
+      {
+        error = ZSTD_getErrorName(result);
+        break;
+      }
+      out.append(buf, ob.pos);
+      if (ob.pos == 0 && in.pos >= in.size && result != 0)
+      {
+        error = "truncated";
+        break;
+      }
+    }
+    ZSTD_freeDStream(dstream);
+    if (error.isEmpty() && result == 0)
+      consumed = ZSTD_findFrameCompressedSize(src, avail);
+  }
+
+  return error;
+}
+
+// one member of a v2 package, decoded and checked on any thread
+struct FrameJob
+{
+  PkgArchive::Format format;
+  const uchar       *src;
+  const PkgMember   *member;
+  QByteArray         out;
+  QString            error;   // what data() reports, empty on success
+};
+
+static void decodeFrameJob(FrameJob &job)
+{
+  const PkgMember *m = job.member;
+  QByteArray frame;
+  qint64     consumed;
+  QString    error = decodeFrame(job.format, job.src + m->frame, m->fsize,
+                                 m->offset + m->size, frame, consumed);
+  if (! error.isEmpty() || frame.size() < m->offset + m->size)
+  {
+    job.error = error.isEmpty() ? TR("truncated") : error;
+    return;
+  }
+  job.out = frame.mid(m->offset, m->size);
+  if (crc32(crc32(0L, Z_NULL, 0), (const Bytef *)job.out.constData(),
+            (uInt)job.out.size()) != m->crc)
+  {
+    job.error = TR("checksum mismatch");
+    job.out.clear();
+  }
+}
+
+static QString tarString(const char *p, int max)
+{
+  const char *end = (const char *)memchr(p, '\0', max);
+  return QString::fromLocal8Bit(p, end ? end - p : max);
+}
+
+static qint64 tarNumber(const char *p, int len)
+{
+  qint64 result = 0;
+  if (p[0] & 0x80)      // GNU base-256 encoding for large members
+  {
+    for (int i = 1; i < len; i++)
+      result = (result << 8) | (unsigned char)p[i];
+    return result;
+  }
+
+  int i = 0;
+  while (i < len && (p[i] == ' ' || p[i] == '\0'))
+    i++;
+  for (; i < len && p[i] >= '0' && p[i] <= '7'; i++)
+    result = result * 8 + (p[i] - '0');
+  return result;
+}
+
+static bool tarChecksumOk(const char *header)
+{
+  qint64 expected = tarNumber(header + 148, 8);
+  qint64 usum = 0;
+  qint64 ssum = 0;
+  for (int i = 0; i < TARBLOCK; i++)
+  {
+    char c = (i >= 148 && i < 156) ? ' ' : header[i];
+    usum += (unsigned char)c;
+    ssum += (signed char)c;
+  }
+  return expected == usum || expected == ssum;
+}
+
+static bool tarBlockIsZero(const char *header)
+{
+  for (int i = 0; i < TARBLOCK; i++)
+    if (header[i])
+      return false;
+  return true;
+}
+
+PkgArchive::PkgArchive(const QString &filename)
+  : _atEnd(false),
+    _filename(filename),
+    _format(Unknown),
+    _in(filename),
+    _decoded(0),
+    _dstream(0),
+    _nextFrame(0),
+    _indexed(false),
+    _map(0),
+    _mapSize(0),
+    _pos(0),
+    _spool(0),
+    _src(0),
+    _srcSize(0),
+    _streamIn(0),
+    _stream(0),
+    _uniqueCount(0),
+    _valid(false)
+{
+}
+
+PkgArchive::~PkgArchive()
+{
+  if (_stream)
+  {
+    inflateEnd((z_stream *)_stream);
+    delete (z_stream *)_stream;
+  }
+  if (_dstream)
+    ZSTD_freeDStream((ZSTD_DStream *)_dstream);
+  delete _spool;
+}
+
+bool PkgArchive::open(QString &errMsg)
+{
+  if (! _in.open(QIODevice::ReadOnly))
+  {
+    errMsg = TR("<p>Could not open %1: %2").arg(_filename, _in.errorString());
+    return false;
+  }
+
+  QByteArray magic = _in.peek(TARBLOCK);
+  if (magic.startsWith("\x1f\x8b"))
+  {
+    z_stream *strm = new z_stream;
+    memset(strm, 0, sizeof(z_stream));
+    if (inflateInit2(strm, 15 + 32) != Z_OK)
+    {
+      delete strm;
+      errMsg = TR("<p>Could not initialize decompression of %1.").arg(_filename);
+      return false;
+    }
+    _stream = strm;
+    _inbuf.resize(CHUNK);
+    _format = Gzip;
+
+    // only needed for v2 packages, which are read frame by frame
+    _srcSize = _in.size();
+    _src     = _in.map(0, _srcSize);
+  }
+  else if (magic.startsWith("\x28\xb5\x2f\xfd"))
+  {
+    qint64 size = _in.size();
+    _src     = _in.map(0, size);
+    _srcSize = size;
+    if (! _src)
+    {
+      errMsg = TR("<p>Could not map %1 into memory: %2")
+                 .arg(_filename, _in.errorString());
+      return false;
+    }
+
+    // frame boundaries come from the frame headers so frames can be decoded
+    // independently of each other
+    for (qint64 in = 0; in < size; )
+    {
+      size_t csize = ZSTD_findFrameCompressedSize(_src + in, size - in);
+      if (ZSTD_isError(csize))
+      {
+        errMsg = TR("<p>The file %1 is not compressed in the expected format "
+                    "(%2).").arg(_filename).arg(ZSTD_getErrorName(csize));
+        return false;
+      }
+
+      unsigned long long dsize = ZSTD_getFrameContentSize(_src + in, csize);
+      PkgFrame frame;
+      frame.in    = in;
+      frame.csize = csize;
+      frame.dsize = (dsize == ZSTD_CONTENTSIZE_UNKNOWN ||
+                     dsize == ZSTD_CONTENTSIZE_ERROR) ? -1 : (qint64)dsize;
+      _frames.append(frame);
+      in += csize;
+    }
+    _format = Zstd;
+  }
+  else if (magic.startsWith("\xfd" "7zXZ"))
+  {
+    errMsg = TR("<p>The file %1 is compressed with xz, which is not "
+                "supported. Please use a .gz or .tar.zst package.")
+               .arg(_filename);
+    return false;
+  }
+  else if (magic.size() == TARBLOCK && tarChecksumOk(magic.constData()))
+  {
+    _format = Tar;
+    map(_in);
+  }
+  else
+  {
+    errMsg = TR("<p>The file %1 appears to be empty or it is not "
+                "compressed in the expected format.").arg(_filename);
+    return false;
+  }
+
+  _valid = true;
+  if (! readIndex(errMsg))
+  {
+    _valid = false;
+    return false;
+  }
+
+  // v1 compressed packages are unpacked as they are scanned
+  if (! _indexed && _format != Tar)
+  {
+    if (_spoolName.isEmpty())
+    {
+      QTemporaryFile *tmp = new QTemporaryFile();
+      _spool = tmp;
+      tmp->open();
+    }
+    else
+    {
+      _spool = new QFile(_spoolName);
+      _spool->open(QIODevice::ReadWrite | QIODevice::Truncate);
+    }
+
+    if (! _spool->isOpen())
+    {
+      errMsg = TR("<p>Could not create a temporary file to unpack %1: %2")
+                 .arg(_filename, _spool->errorString());
+      _valid = false;
+      return false;
+    }
+  }
+
+  if (DEBUG)
+    qDebug("PkgArchive::open(%s) format %d, %s", qPrintable(_filename),
+           _format, _indexed ? "v2" : "v1");
+
+  return true;
+}
+
+/* Look for a v2 index as the first member and load it. Returns false only
+   if there is one and it is unusable; v1 packages are left to be scanned.
+ */
+bool PkgArchive::readIndex(QString &errMsg)
+{
+  const uchar *src  = (_format == Tar) ? _map     : _src;
+  qint64       size = (_format == Tar) ? _mapSize : _srcSize;
+  if (! src)
+    return true;
+
+  QByteArray head;
+  qint64     consumed = -1;
+  if (_format == Tar)
+    head = QByteArray::fromRawData((const char *)src, qMin(size, (qint64)TARBLOCK));
+  else if (! decodeFrame(_format, src, size, TARBLOCK, head, consumed).isEmpty())
+    return true;
+
+  if (head.size() < TARBLOCK || ! tarChecksumOk(head.constData()) ||
+      tarString(head.constData(), 100) != indexName())
+    return true;
+
+  errMsg = TR("<p>The package index in %1 is corrupt.").arg(_filename);
+
+  qint64 isize  = tarNumber(head.constData() + 124, 12);
+  qint64 padded = (isize + TARBLOCK - 1) & ~(qint64)(TARBLOCK - 1);
+  QByteArray frame;
+  if (_format == Tar)
+  {
+    if (TARBLOCK + padded > size)
+      return false;
+    frame    = QByteArray::fromRawData((const char *)src, TARBLOCK + isize);
+    consumed = TARBLOCK + padded;
+  }
+  else if (! decodeFrame(_format, src, size, -1, frame, consumed).isEmpty() ||
+           consumed < 0 || frame.size() < TARBLOCK + isize)
+    return false;
+
+  QList<PkgMember> members;
+  if (! unpackIndex(frame.mid(TARBLOCK, isize), members))
+    return false;
+
+  // frame offsets in the index are relative to the end of the index frame
+  foreach (PkgMember member, members)
+  {
+    if (_format == Tar)
+    {
+      member.offset += consumed + member.frame;
+      member.frame   = -1;
+      if (member.offset + member.size > size)
+        return false;
+    }
+    else
+    {
+      member.frame += consumed;
+      if (member.frame + member.fsize > size)
+        return false;
+    }
+
+    QString key = normalize(member.name);
+    if (! _index.contains(key))
+      _names.append(member.name);
+    _index.insert(key, member);
+  }
+
+  errMsg  = QString::null;
+  _indexed = true;
+  _atEnd   = true;
+  return true;
+}
+
+// the members in the order they appear in the package
+QList<PkgMember> PkgArchive::memberList() const
+{
+  QList<PkgMember> result;
+  foreach (QString name, _names)
+    result.append(_index.value(normalize(name)));
+  return result;
+}
+
+/* Take the index of a v1 package from an earlier scan instead of scanning
+   again. spoolName is the unpacked tar stream that scan left behind, and
+   is ignored for uncompressed packages. Call right after open().
+ */
+bool PkgArchive::restore(const QList<PkgMember> &members,
+                         const QString &spoolName, QString &errMsg)
+{
+  if (! _valid || _indexed || _pos > 0)
+  {
+    errMsg = TR("<p>Could not restore the index of %1.").arg(_filename);
+    return false;
+  }
+
+  if (_format != Tar)
+  {
+    QFile *spool = new QFile(spoolName);
+    if (! spool->open(QIODevice::ReadOnly))
+    {
+      errMsg = TR("<p>Could not open %1: %2").arg(spoolName, spool->errorString());
+      delete spool;
+      return false;
+    }
+    delete _spool;
+    _spool = spool;
+    map(*_spool);
+  }
+
+  _index.clear();
+  _names.clear();
+  foreach (PkgMember member, members)
+  {
+    QString key = normalize(member.name);
+    if (! _index.contains(key))
+      _names.append(member.name);
+    _index.insert(key, member);
+  }
+  _atEnd = true;
+
+  return true;
+}
+
+QString PkgArchive::indexName()
+{
+  return QString("pkgindex.bin");
+}
+
+int PkgArchive::itemType(const QString &tagName)
+{
+  for (int i = 1; itemTags[i]; i++)
+    if (tagName == itemTags[i])
+      return i;
+  return 0;
+}
+
+QString PkgArchive::itemTag(int type)
+{
+  for (int i = 0; itemTags[i]; i++)
+    if (i == type)
+      return QString(itemTags[i]);
+  return QString::null;
+}
+
+/* The index is a QDataStream of the magic number, the index version and
+   the member count, followed by name, frame, fsize, offset, size, crc and
+   type for each member. Names are UTF-8 and frames are relative to the end
+   of the frame holding the index.
+ */
+QByteArray PkgArchive::packIndex(const QList<PkgMember> &members)
+{
+  QByteArray  result;
+  QDataStream out(&result, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_4_0);
+
+  out << (quint32)INDEXMAGIC << (quint32)INDEXVERSION << (quint32)members.size();
+  foreach (PkgMember member, members)
+    out << member.name.toUtf8()
+        << (qint64)member.frame  << (qint64)member.fsize
+        << (qint64)member.offset << (qint64)member.size
+        << (quint32)member.crc   << (quint8)member.type;
+
+  return result;
+}
+
+bool PkgArchive::unpackIndex(const QByteArray &index, QList<PkgMember> &members)
+{
+  QDataStream in(index);
+  in.setVersion(QDataStream::Qt_4_0);
+
+  quint32 magic, version, count;
+  in >> magic >> version >> count;
+  if (in.status() != QDataStream::Ok || magic != INDEXMAGIC ||
+      version != INDEXVERSION)
+    return false;
+
+  for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++)
+  {
+    QByteArray name;
+    quint8     type;
+    PkgMember  member;
+    in >> name >> member.frame >> member.fsize >> member.offset >> member.size
+       >> member.crc >> type;
+    member.name = QString::fromUtf8(name);
+    member.type = type;
+    members.append(member);
+  }
+
+  return in.status() == QDataStream::Ok;
+}
+
+// falls back to reading through the file if the mapping fails
+void PkgArchive::map(QFile &file)
+{
+  file.flush();
+  _mapSize = file.size();
+  _map     = _mapSize > 0 ? file.map(0, _mapSize) : 0;
+  if (! _map)
+    _mapSize = 0;
+
+  if (DEBUG)
+    qDebug("PkgArchive::map(%s) %lld bytes at %p",
+           qPrintable(file.fileName()), _mapSize, _map);
+}
+
+void PkgArchive::setError(const QString &errMsg)
+{
+  if (DEBUG)
+    qDebug("PkgArchive::setError(%s)", qPrintable(errMsg));
+  _errMsg = errMsg;
+  _valid  = false;
+}
+
+/* Advance len bytes through the uncompressed tar stream, copying them to buf
+   if it is not null and accumulating their CRC-32 in crc if that is not null.
+   Gzip data are spooled as they are inflated so members can be read back
+   later without inflating again.
+ */
+bool PkgArchive::pull(char *buf, qint64 len, quint32 *crc)
+{
+  if (_format == Tar || _format == Zstd)
+  {
+    QFile *dev = (_format == Tar) ? &_in : _spool;
+    if (_format == Zstd)
+    {
+      while (_decoded < _pos + len)
+        if (! decodeFrames(_pos + len))
+          return false;
+    }
+    else if (_pos + len > _in.size())
+    {
+      setError(TR("<p>The file %1 is truncated.").arg(_filename));
+      return false;
+    }
+
+    if (buf || crc)
+    {
+      char   scratch[CHUNK];
+      qint64 done = 0;
+      if (dev->pos() != _pos)
+        dev->seek(_pos);
+      while (done < len)
+      {
+        char  *out  = buf ? buf + done : scratch;
+        qint64 want = buf ? len - done : qMin(len - done, (qint64)CHUNK);
+        if (dev->read(out, want) != want)
+        {
+          setError(TR("<p>Could not read %1: %2").arg(_filename, dev->errorString()));
+          return false;
+        }
+        if (crc)
+          *crc = crc32(*crc, (const Bytef *)out, (uInt)want);
+        done += want;
+      }
+    }
+    _pos += len;
+    return true;
+  }
+
+  z_stream *strm = (z_stream *)_stream;
+  char      scratch[CHUNK];
+  qint64    done = 0;
+
+  if (_spool->pos() != _pos)
+    _spool->seek(_pos);
+
+  while (done < len)
+  {
+    if (strm->avail_in == 0)
+    {
+      qint64 got = _in.read(_inbuf.data(), _inbuf.size());
+      if (got <= 0)
+      {
+        setError(TR("<p>The file %1 is truncated.").arg(_filename));
+        return false;
+      }
+      strm->next_in  = (Bytef *)_inbuf.data();
+      strm->avail_in = (uInt)got;
+    }
+
+    char *out  = buf ? buf + done : scratch;
+    uInt  want = (uInt)qMin(len - done, (qint64)CHUNK);
+    strm->next_out  = (Bytef *)out;
+    strm->avail_out = want;
+
+    int ret = inflate(strm, Z_NO_FLUSH);
+    qint64 got = want - strm->avail_out;
+    if (crc && got > 0)
+      *crc = crc32(*crc, (const Bytef *)out, (uInt)got);
+    if (got > 0 && _spool->write(out, got) != got)
+    {
+      setError(TR("<p>Could not write to a temporary file while unpacking "
+                  "%1: %2").arg(_filename, _spool->errorString()));
+      return false;
+    }
+    done += got;
+
+    if (ret == Z_STREAM_END)
+    {
+      // concatenated gzip members are legal, keep going if there's more input
+      if (strm->avail_in == 0 && _in.atEnd())
+      {
+        if (done < len)
+        {
+          setError(TR("<p>The file %1 is truncated.").arg(_filename));
+          return false;
+        }
+        break;
+      }
+      inflateReset(strm);
+    }
+    else if (ret != Z_OK && (ret != Z_BUF_ERROR || strm->avail_in > 0))
+    {
+      setError(TR("<p>The file %1 is not compressed in the expected format "
+                  "(%2).").arg(_filename).arg(strm->msg ? strm->msg : ""));
+      return false;
+    }
+  }
+
+  _pos += len;
+  return true;
+}
+
+/* Decode zstd frames into the spool until it holds at least want bytes.
+   Frames with a recorded size are decoded idealThreadCount() at a time in
+   parallel, others are streamed.
+ */
+bool PkgArchive::decodeFrames(qint64 want)
+{
+  if (_spool->pos() != _decoded)
+    _spool->seek(_decoded);
+
+  if (! _dstream && _nextFrame < _frames.size() &&
+      (_frames.at(_nextFrame).dsize < 0 ||
+       _frames.at(_nextFrame).dsize > MAXFRAME))
+  {
+    _dstream  = ZSTD_createDStream();
+    ZSTD_initDStream((ZSTD_DStream *)_dstream);
+    _streamIn = _frames.at(_nextFrame).in;
+    _nextFrame++;
+  }
+
+  if (_dstream)
+  {
+    const PkgFrame &frame = _frames.at(_nextFrame - 1);
+    ZSTD_inBuffer in = { _src + _streamIn, (size_t)(frame.in + frame.csize - _streamIn), 0 };
+    char   out[CHUNK];
+    size_t result = 1;
+    bool   more   = true;   // input left, or output zstd has yet to return
+    while (_decoded < want && more && result != 0)
+    {
+      ZSTD_outBuffer ob = { out, sizeof(out), 0 };
+      result = ZSTD_decompressStream((ZSTD_DStream *)_dstream, &ob, &in);
+      if (ZSTD_isError(result))
+      {
+        setError(TR("<p>The file %1 is not compressed in the expected format "
+                    "(%2).").arg(_filename).arg(ZSTD_getErrorName(result)));
+        return false;
+      }
+      if (ob.pos > 0 && _spool->write(out, ob.pos) != (qint64)ob.pos)
+      {
+        setError(TR("<p>Could not write to a temporary file while unpacking "
+                    "%1: %2").arg(_filename, _spool->errorString()));
+        return false;
+      }
+      _decoded += ob.pos;
+      more = in.pos < in.size || ob.pos == ob.size;
+    }
+    _streamIn += in.pos;
+
+    // all input consumed and flushed but the frame is not complete
+    if (result != 0 && ! more)
+    {
+      setError(TR("<p>The file %1 is truncated.").arg(_filename));
+      return false;
+    }
+    if (result == 0)
+    {
+      ZSTD_freeDStream((ZSTD_DStream *)_dstream);
+      _dstream = 0;
+    }
+    return true;
+  }
+
+  if (_nextFrame >= _frames.size())
+  {
+    setError(TR("<p>The file %1 is truncated.").arg(_filename));
+    return false;
+  }
+
+  QList<ZstdJob> jobs;
+  while (_nextFrame < _frames.size() && jobs.size() < QThread::idealThreadCount() &&
+         _frames.at(_nextFrame).dsize >= 0 &&
+         _frames.at(_nextFrame).dsize <= MAXFRAME)
+  {
+    const PkgFrame &frame = _frames.at(_nextFrame++);
+    ZstdJob job;
+    job.src   = _src + frame.in;
+    job.csize = frame.csize;
+    job.out.resize(frame.dsize);
+    jobs.append(job);
+  }
+
+  if (jobs.size() > 1)
+    QtConcurrent::blockingMap(jobs, decodeZstdJob);
+  else if (jobs.size() == 1)
+    decodeZstdJob(jobs[0]);
+
+  foreach (ZstdJob job, jobs)
+  {
+    if (! job.error.isEmpty())
+    {
+      setError(TR("<p>The file %1 is not compressed in the expected format "
+                  "(%2).").arg(_filename, job.error));
+      return false;
+    }
+    if (_spool->write(job.out) != job.out.size())
+    {
+      setError(TR("<p>Could not write to a temporary file while unpacking "
+                  "%1: %2").arg(_filename, _spool->errorString()));
+      return false;
+    }
+    _decoded += job.out.size();
+  }
+
+  if (DEBUG)
+    qDebug("PkgArchive::decodeFrames(%lld) decoded %d frames, %lld bytes",
+           want, jobs.size(), _decoded);
+  return true;
+}
+
+bool PkgArchive::readAt(qint64 offset, char *buf, qint64 len)
+{
+  QIODevice *dev = (_format == Tar) ? (QIODevice *)&_in : (QIODevice *)_spool;
+  if (! dev->seek(offset) || dev->read(buf, len) != len)
+  {
+    setError(TR("<p>Could not read %1: %2").arg(_filename, dev->errorString()));
+    return false;
+  }
+  return true;
+}
+
+/* Walk forward to the next regular file in the tar stream and add it to the
+   index. Returns false at the end of the archive or on error.
+ */
+bool PkgArchive::scanNext()
+{
+  if (_atEnd || ! _valid)
+    return false;
+
+  QString longname;
+  char    header[TARBLOCK];
+  forever
+  {
+    if (! pull(header, TARBLOCK))
+      return false;
+
+    if (tarBlockIsZero(header))
+    {
+      _atEnd = true;
+      if (_spool)
+        map(*_spool);
+      return false;
+    }
+
+    if (! tarChecksumOk(header))
+    {
+      setError(TR("<p>The file %1 does not appear to contain a valid "
+                  "update package (not a valid TAR file?).").arg(_filename));
+      return false;
+    }
+
+    QString name = tarString(header, 100);
+    if (memcmp(header + 257, "ustar", 5) == 0 && header[345])
+      name = tarString(header + 345, 155) + "/" + name;
+
+    qint64 size   = tarNumber(header + 124, 12);
+    qint64 padded = (size + TARBLOCK - 1) & ~(qint64)(TARBLOCK - 1);
+    char   type   = header[156];
+
+    if (type == 'L' || type == 'x' || type == 'g')  // GNU long name or pax
+    {
+      QByteArray meta(padded, '\0');
+      if (! pull(meta.data(), padded))
+        return false;
+      meta.truncate(size);
+
+      if (type == 'L')
+        longname = tarString(meta.constData(), meta.size());
+      else if (type == 'x')
+      {
+        // pax records look like "<length> <key>=<value>\n"
+        int start = 0;
+        while (start < meta.size())
+        {
+          int space = meta.indexOf(' ', start);
+          int reclen = meta.mid(start, space - start).toInt();
+          if (space < 0 || reclen <= 0)
+            break;
+          QByteArray record = meta.mid(space + 1, reclen - (space - start) - 2);
+          if (record.startsWith("path="))
+            longname = QString::fromUtf8(record.mid(5));
+          start += reclen;
+        }
+      }
+      continue;
+    }
+
+    if (! longname.isEmpty())
+      name = longname;
+
+    if (type == '0' || type == '\0' || type == '7')
+    {
+      PkgMember member;
+      member.name   = name;
+      member.offset = _pos;
+      member.size   = size;
+      member.crc    = crc32(0L, Z_NULL, 0);
+      member.frame  = -1;
+      member.fsize  = 0;
+      member.type   = 0;
+      if (! pull(0, size, &member.crc) || ! pull(0, padded - size))
+        return false;
+
+      QString key = normalize(name);
+      if (! _index.contains(key))
+      {
+        _names.append(name);
+        if (! _unique.isEmpty() && QFileInfo(name).fileName() == _unique &&
+            ++_uniqueCount > 1)
+        {
+          setError(TR("<p>Multiple %1 files found in %2. Currently only "
+                      "packages containing a single content.xml file are "
+                      "supported.").arg(_unique, _filename));
+          return false;
+        }
+      }
+      _index.insert(key, member);
+      return true;
+    }
+
+    // directories, links, devices: nothing to index
+    if (! pull(0, padded))
+      return false;
+    longname.clear();
+  }
+
+  return false;
+}
+
+bool PkgArchive::scan(QString &errMsg)
+{
+  while (scanNext())
+    ;
+  if (! _valid)
+  {
+    errMsg = _errMsg;
+    return false;
+  }
+  return true;
+}
+
+QString PkgArchive::findFile(const QString &basename)
+{
+  foreach (QString name, _names)
+  {
+    if (QFileInfo(name).fileName() == basename)
+      return name;
+  }
+
+  while (scanNext())
+  {
+    if (QFileInfo(_names.last()).fileName() == basename)
+      return _names.last();
+  }
+
+  return QString::null;
+}
+
+/* Fail the scan as soon as it finds a second file called basename, in any
+   directory, rather than when the whole package has been read. Returns
+   false at once if the files indexed so far already include two.
+ */
+bool PkgArchive::setUniqueName(const QString &basename)
+{
+  _unique      = basename;
+  _uniqueCount = 0;
+  foreach (QString name, _names)
+    if (QFileInfo(name).fileName() == basename)
+      _uniqueCount++;
+
+  if (_uniqueCount > 1)
+  {
+    setError(TR("<p>Multiple %1 files found in %2. Currently only "
+                "packages containing a single content.xml file are "
+                "supported.").arg(_unique, _filename));
+    return false;
+  }
+  return true;
+}
+
+QString PkgArchive::normalize(const QString &name)
+{
+  QString result = QDir::cleanPath(name);
+  while (result.startsWith("./"))
+    result.remove(0, 2);
+  while (result.startsWith("/"))
+    result.remove(0, 1);
+  return result;
+}
+
+const PkgMember *PkgArchive::member(const QString &name)
+{
+  QString key = normalize(name);
+  while (! _index.contains(key) && scanNext())
+    ;
+
+  QHash<QString, PkgMember>::const_iterator it = _index.constFind(key);
+  return it == _index.constEnd() ? 0 : &it.value();
+}
+
+bool PkgArchive::contains(const QString &name)
+{
+  return member(name) != 0;
+}
+
+/* Materialize a member's data, verifying it against the CRC-32 recorded
+   when the member was indexed. Mapped members are returned without copying.
+ */
+QByteArray PkgArchive::data(const QString &name)
+{
+  const PkgMember *m = member(name);
+  if (! m)
+    return QByteArray();
+
+  QByteArray result;
+  if (m->frame >= 0)
+  {
+    FrameJob job = { _format, _src, m, QByteArray(), QString() };
+    decodeFrameJob(job);
+    if (! job.error.isEmpty())
+    {
+      setError(TR("<p>The contents of %1 in %2 are corrupt (%3).")
+                 .arg(m->name, _filename, job.error));
+      return QByteArray();
+    }
+    return job.out;
+  }
+  else if (_map && m->offset + m->size <= _mapSize)
+    result = QByteArray::fromRawData((const char *)_map + m->offset, m->size);
+  else
+  {
+    result.resize(m->size);
+    if (m->size > 0 && ! readAt(m->offset, result.data(), m->size))
+      return QByteArray();
+  }
+
+  if (crc32(crc32(0L, Z_NULL, 0), (const Bytef *)result.constData(),
+            (uInt)result.size()) != m->crc)
+  {
+    setError(TR("<p>The contents of %1 in %2 are corrupt (checksum mismatch).")
+               .arg(m->name, _filename));
+    return QByteArray();
+  }
+
+  return result;
+}
+
+/* The data of several members, in order. The frames of v2 members are
+   decoded and checked on all available cores at once; everything else is
+   read one member at a time as data() does. Stops at the first member that
+   cannot be read, so a short result means isValid() is false.
+ */
+QList<QByteArray> PkgArchive::data(const QStringList &names)
+{
+  QList<FrameJob> jobs;
+  foreach (QString name, names)
+  {
+    const PkgMember *m = member(name);
+    if (m && m->frame >= 0)
+    {
+      FrameJob job = { _format, _src, m, QByteArray(), QString() };
+      jobs.append(job);
+    }
+  }
+  if (jobs.size() > 1)
+    QtConcurrent::blockingMap(jobs, decodeFrameJob);
+  else if (jobs.size() == 1)
+    decodeFrameJob(jobs[0]);
+
+  QList<QByteArray> result;
+  int               next = 0;
+  foreach (QString name, names)
+  {
+    const PkgMember *m = member(name);
+    if (m && m->frame >= 0)
+    {
+      FrameJob &job = jobs[next++];
+      if (! job.error.isEmpty())
+      {
+        setError(TR("<p>The contents of %1 in %2 are corrupt (%3).")
+                   .arg(m->name, _filename, job.error));
+        break;
+      }
+      result.append(job.out);
+    }
+    else
+    {
+      result.append(data(name));
+      if (! _valid)
+      {
+        result.removeLast();
+        break;
+      }
+    }
+  }
+
+  return result;
+}
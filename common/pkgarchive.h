@@ -0,0 +1,160 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __PKGARCHIVE_H__
+#define __PKGARCHIVE_H__
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/* One regular file inside the tar stream of a package.
+   offset is the position of the member's data in the uncompressed tar
+   stream, not in the (possibly compressed) package file. crc is the CRC-32
+   of the data, computed while scanning and checked when the data are read.
+
+   Members of compressed v2 packages each sit in a frame of their own: frame
+   and fsize locate that gzip member or zstd frame in the package file and
+   offset is the position of the data within the decompressed frame. frame
+   is -1 for everything else. type is the package.xml element that loads the
+   member, see itemType(), or 0 if unknown.
+ */
+struct PkgMember
+{
+  QString name;
+  qint64  offset;
+  qint64  size;
+  quint32 crc;
+  qint64  frame;
+  qint64  fsize;
+  int     type;
+};
+
+/* One zstd frame of a .tar.zst package. dsize is -1 if the frame header does
+   not record the decompressed size.
+ */
+struct PkgFrame
+{
+  qint64 in;
+  qint64 csize;
+  qint64 dsize;
+};
+
+/* PkgArchive reads update packages (.tar, .tar.gz or .tar.zst) without
+   inflating the whole package into memory. The format is detected from the
+   leading magic bytes, not the file name. The tar headers are walked
+   incrementally as the stream is inflated, so finding package.xml only
+   inflates as much of the package as precedes it. Inflated data is spooled
+   to a temporary file and member contents are read back from there on
+   demand.
+
+   Members are indexed by normalized path (see normalize()), so lookups do
+   not depend on how package.xml spells a file name. Nothing but the index
+   stays resident: callers own the data() they ask for and should drop it
+   as soon as they are done with it.
+
+   Uncompressed packages, and the spool of compressed ones once the scan is
+   complete, are memory-mapped. data() then returns a QByteArray that points
+   into the mapping instead of a copy. Such views are only valid while the
+   PkgArchive exists, are not nul-terminated, and detach on modification.
+
+   Zstd packages written as a series of independent frames, as the builder's
+   PkgArchiveWriter does, are decoded a batch of frames at a time on all
+   available cores. Single-frame packages from the stock zstd tool are
+   streamed on one thread.
+
+   v2 packages start with a member named indexName(), compressed on its own,
+   that lists every other member with its location, size, CRC-32 and item
+   type. When open() finds one the package is never scanned: members are
+   decompressed frame by frame straight from the package file, and
+   data(QStringList) decodes the frames of several members on all available
+   cores. v2 packages are still plain tar files, so older updaters and tar
+   itself can read them too.
+ */
+class PkgArchive
+{
+  public:
+    enum Format { Unknown = 0, Tar, Gzip, Zstd };
+
+    PkgArchive(const QString &filename);
+    virtual ~PkgArchive();
+
+    virtual bool       open(QString &errMsg);
+    virtual bool       scan(QString &errMsg);
+    virtual QString    findFile(const QString &basename);
+    virtual bool       contains(const QString &name);
+    virtual QByteArray data(const QString &name);
+    virtual QList<QByteArray> data(const QStringList &names);
+    virtual const PkgMember *member(const QString &name);
+    virtual bool       restore(const QList<PkgMember> &members,
+                               const QString &spoolName, QString &errMsg);
+    QList<PkgMember>   memberList() const;
+
+    static QString normalize(const QString &name);
+    static QString indexName();
+    static int     itemType(const QString &tagName);
+    static QString itemTag(int type);
+    static QByteArray packIndex(const QList<PkgMember> &members);
+    static bool       unpackIndex(const QByteArray &index, QList<PkgMember> &members);
+
+    QString     errorString() const { return _errMsg; }
+    QString     filename()    const { return _filename; }
+    Format      format()      const { return _format; }
+    bool        hasIndex()    const { return _indexed; }
+    bool        isValid()     const { return _valid; }
+    bool        isMapped()    const { return _map != 0; }
+    QStringList members()     const { return _names; }
+    bool        scanned()     const { return _atEnd; }
+    QString     spoolName()   const { return _spoolName; }
+
+    // where to unpack compressed v1 packages; set before open()
+    void setSpoolName(const QString &name) { _spoolName = name; }
+    virtual bool setUniqueName(const QString &basename);
+
+  protected:
+    bool _atEnd;
+    QString _errMsg;
+    QString _filename;
+    Format  _format;
+    QFile   _in;
+    QByteArray _inbuf;
+    qint64          _decoded;   // bytes of zstd output spooled so far
+    void           *_dstream;   // ZSTD_DStream for a frame being streamed
+    QList<PkgFrame> _frames;
+    int             _nextFrame;
+    QHash<QString, PkgMember> _index;
+    bool            _indexed;   // a v2 package
+    uchar          *_map;
+    qint64          _mapSize;
+    QStringList     _names;
+    qint64          _pos;       // uncompressed bytes walked so far
+    QFile          *_spool;
+    QString         _spoolName; // empty for a temporary file
+    const uchar    *_src;       // mapped compressed package
+    qint64          _srcSize;
+    qint64          _streamIn;  // position in _src of the streamed frame
+    void           *_stream;    // z_stream, kept opaque to avoid zlib.h here
+    QString         _unique;    // basename the scan may find only once
+    int             _uniqueCount;
+    bool            _valid;
+
+    virtual bool decodeFrames(qint64 want);
+    virtual void map(QFile &file);
+    virtual bool pull(char *buf, qint64 len, quint32 *crc = 0);
+    virtual bool readAt(qint64 offset, char *buf, qint64 len);
+    virtual bool readIndex(QString &errMsg);
+    virtual bool scanNext();
+    virtual void setError(const QString &errMsg);
+};
+
+#endif
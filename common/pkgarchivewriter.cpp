@@ -0,0 +1,386 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "pkgarchivewriter.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QDomDocument>
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QTemporaryFile>
+
+#include <string.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#define TR(a) QObject::tr(a)
+
+#define DEBUG false
+
+#define CHUNK     16384
+#define TARBLOCK  512
+#define ZSTDLEVEL 10
+
+static QByteArray padding(qint64 size)
+{
+  return QByteArray((TARBLOCK - size % TARBLOCK) % TARBLOCK, '\0');
+}
+
+PkgArchiveWriter::PkgArchiveWriter(const QString &filename,
+                                   PkgArchive::Format format)
+  : _body(0),
+    _file(filename),
+    _format(format),
+    _frameSize(4 * 1024 * 1024),
+    _indexed(false),
+    _stream(0)
+{
+}
+
+PkgArchiveWriter::~PkgArchiveWriter()
+{
+  if (_stream)
+  {
+    deflateEnd((z_stream *)_stream);
+    delete (z_stream *)_stream;
+  }
+  delete _body;
+}
+
+PkgArchive::Format PkgArchiveWriter::formatFor(const QString &filename)
+{
+  if (filename.endsWith(".zst", Qt::CaseInsensitive))
+    return PkgArchive::Zstd;
+  else if (filename.endsWith(".tar", Qt::CaseInsensitive))
+    return PkgArchive::Tar;
+  return PkgArchive::Gzip;
+}
+
+bool PkgArchiveWriter::open(QString &errMsg)
+{
+  if (! _file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    errMsg = TR("Could not open %1 for writing: %2")
+               .arg(_file.fileName(), _file.errorString());
+    return false;
+  }
+
+  if (_indexed)
+  {
+    _body = new QTemporaryFile();
+    if (! _body->open())
+    {
+      errMsg = TR("Could not create a temporary file to build %1: %2")
+                 .arg(_file.fileName(), _body->errorString());
+      return false;
+    }
+  }
+  else if (_format == PkgArchive::Gzip)
+  {
+    z_stream *strm = new z_stream;
+    memset(strm, 0, sizeof(z_stream));
+    if (deflateInit2(strm, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      delete strm;
+      errMsg = TR("Could not initialize compression of %1.").arg(_file.fileName());
+      return false;
+    }
+    _stream = strm;
+  }
+
+  return true;
+}
+
+// compress data into one self-contained gzip member or zstd frame
+bool PkgArchiveWriter::compress(const QByteArray &data, QByteArray &out,
+                                QString &errMsg)
+{
+  if (_format == PkgArchive::Gzip)
+  {
+    z_stream strm;
+    memset(&strm, 0, sizeof(z_stream));
+    if (deflateInit2(&strm, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      errMsg = TR("Could not initialize compression of %1.").arg(_file.fileName());
+      return false;
+    }
+    out.resize(deflateBound(&strm, data.size()) + 32);  // room for the gzip header
+    strm.next_in   = (Bytef *)data.constData();
+    strm.avail_in  = data.size();
+    strm.next_out  = (Bytef *)out.data();
+    strm.avail_out = out.size();
+    int ret = deflate(&strm, Z_FINISH);
+    out.resize(strm.total_out);
+    deflateEnd(&strm);
+    if (ret != Z_STREAM_END)
+    {
+      errMsg = TR("Could not compress %1.").arg(_file.fileName());
+      return false;
+    }
+  }
+  else if (_format == PkgArchive::Zstd)
+  {
+    out.resize(ZSTD_compressBound(data.size()));
+    size_t result = ZSTD_compress(out.data(), out.size(),
+                                  data.constData(), data.size(), ZSTDLEVEL);
+    if (ZSTD_isError(result))
+    {
+      errMsg = TR("Could not compress %1: %2")
+                 .arg(_file.fileName()).arg(ZSTD_getErrorName(result));
+      return false;
+    }
+    out.resize(result);
+  }
+  else
+    out = data;
+
+  return true;
+}
+
+bool PkgArchiveWriter::flush(bool finish, QString &errMsg)
+{
+  if (_format == PkgArchive::Tar)
+  {
+    if (_file.write(_frame) != _frame.size())
+    {
+      errMsg = TR("Could not write %1: %2").arg(_file.fileName(), _file.errorString());
+      return false;
+    }
+  }
+  else if (_format == PkgArchive::Gzip)
+  {
+    z_stream *strm = (z_stream *)_stream;
+    char      out[CHUNK];
+    int       ret;
+    strm->next_in  = (Bytef *)_frame.constData();
+    strm->avail_in = _frame.size();
+    do {
+      strm->next_out  = (Bytef *)out;
+      strm->avail_out = sizeof(out);
+      ret = deflate(strm, finish ? Z_FINISH : Z_NO_FLUSH);
+      qint64 got = sizeof(out) - strm->avail_out;
+      if (ret == Z_STREAM_ERROR || _file.write(out, got) != got)
+      {
+        errMsg = TR("Could not write %1: %2").arg(_file.fileName(), _file.errorString());
+        return false;
+      }
+    } while (strm->avail_out == 0 || (finish && ret != Z_STREAM_END));
+  }
+  else if (_format == PkgArchive::Zstd && ! _frame.isEmpty())
+  {
+    // each frame is compressed on its own so it can be decoded on its own
+    QByteArray out;
+    if (! compress(_frame, out, errMsg))
+      return false;
+    if (_file.write(out) != out.size())
+    {
+      errMsg = TR("Could not write %1: %2").arg(_file.fileName(), _file.errorString());
+      return false;
+    }
+  }
+
+  _frame.clear();
+  return true;
+}
+
+bool PkgArchiveWriter::write(const QByteArray &data, QString &errMsg)
+{
+  _frame.append(data);
+  if (_format != PkgArchive::Zstd || _frame.size() >= _frameSize)
+    return flush(false, errMsg);
+  return true;
+}
+
+/* Build the tar header block(s) for a member. Long names are split into
+   the ustar prefix and name fields or, failing that, preceded by a GNU
+   long name entry.
+ */
+QByteArray PkgArchiveWriter::header(const QString &name, qint64 size, char type)
+{
+  QByteArray result;
+  QByteArray path = name.toLocal8Bit();
+  QByteArray prefix;
+
+  if (path.size() > 100)
+  {
+    for (int slash = path.indexOf('/'); slash >= 0; slash = path.indexOf('/', slash + 1))
+    {
+      if (slash <= 155 && path.size() - slash - 1 <= 100)
+      {
+        prefix = path.left(slash);
+        path   = path.mid(slash + 1);
+        break;
+      }
+      if (slash > 155)
+        break;
+    }
+
+    if (prefix.isEmpty())     // no usable slash
+    {
+      QByteArray longname = path + '\0';
+      result = header("././@LongLink", longname.size(), 'L')
+             + longname + padding(longname.size());
+      path.truncate(100);
+    }
+  }
+
+  QByteArray block(TARBLOCK, '\0');
+  char *h = block.data();
+  memcpy(h, path.constData(), qMin(path.size(), 100));
+  qsnprintf(h + 100, 8,  "%07o", 0644);
+  qsnprintf(h + 108, 8,  "%07o", 0);
+  qsnprintf(h + 116, 8,  "%07o", 0);
+  qsnprintf(h + 124, 12, "%011llo", (unsigned long long)size);
+  qsnprintf(h + 136, 12, "%011llo",
+            (unsigned long long)QDateTime::currentDateTime().toTime_t());
+  h[156] = type;
+  memcpy(h + 257, "ustar", 6);
+  memcpy(h + 263, "00", 2);
+  memcpy(h + 345, prefix.constData(), qMin(prefix.size(), 155));
+
+  memset(h + 148, ' ', 8);
+  unsigned int sum = 0;
+  for (int i = 0; i < TARBLOCK; i++)
+    sum += (unsigned char)h[i];
+  qsnprintf(h + 148, 8, "%06o", sum);
+  h[155] = ' ';
+
+  return result + block;
+}
+
+bool PkgArchiveWriter::addFile(const QString &name, const QByteArray &data,
+                               QString &errMsg, int type)
+{
+  if (DEBUG)
+    qDebug("PkgArchiveWriter::addFile(%s, %d bytes, type %d)",
+           qPrintable(name), data.size(), type);
+
+  QByteArray hdr = header(name, data.size(), '0');
+  if (! _indexed)
+    return write(hdr, errMsg) && write(data, errMsg) &&
+           write(padding(data.size()), errMsg);
+
+  QByteArray frame;
+  if (! compress(hdr + data + padding(data.size()), frame, errMsg))
+    return false;
+
+  PkgMember member;
+  member.name   = name;
+  member.offset = hdr.size();
+  member.size   = data.size();
+  member.crc    = crc32(crc32(0L, Z_NULL, 0), (const Bytef *)data.constData(),
+                        (uInt)data.size());
+  member.frame  = _body->pos();
+  member.fsize  = frame.size();
+  member.type   = type;
+
+  if (_body->write(frame) != frame.size())
+  {
+    errMsg = TR("Could not write to a temporary file while building %1: %2")
+               .arg(_file.fileName(), _body->errorString());
+    return false;
+  }
+  _members.append(member);
+  return true;
+}
+
+/* Add every regular file under dirname, named prefix/relative path. Files
+   are added in sorted order except that package.xml goes first, so the
+   loader can find it without unpacking the rest of the package.
+ */
+bool PkgArchiveWriter::addDirectory(const QString &dirname, const QString &prefix,
+                                    QString &errMsg)
+{
+  QDir        dir(dirname);
+  QStringList files;
+  QDirIterator it(dirname, QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext())
+    files.append(dir.relativeFilePath(it.next()));
+  files.sort();
+
+  int contents = files.indexOf("package.xml");
+  if (contents > 0)
+    files.move(contents, 0);
+
+  // the v2 index records which package.xml element loads each file
+  QHash<QString, int> types;
+  if (_indexed && contents >= 0)
+  {
+    QFile        file(dir.filePath("package.xml"));
+    QDomDocument doc;
+    if (file.open(QIODevice::ReadOnly) && doc.setContent(&file))
+    {
+      types.insert("package.xml", PkgArchive::itemType("package"));
+      for (QDomElement elem = doc.documentElement().firstChildElement();
+           ! elem.isNull(); elem = elem.nextSiblingElement())
+      {
+        if (elem.hasAttribute("file"))
+          types.insert(PkgArchive::normalize(elem.attribute("file")),
+                       PkgArchive::itemType(elem.tagName()));
+      }
+    }
+  }
+
+  foreach (QString relative, files)
+  {
+    QFile file(dir.filePath(relative));
+    if (! file.open(QIODevice::ReadOnly))
+    {
+      errMsg = TR("Could not read %1: %2").arg(file.fileName(), file.errorString());
+      return false;
+    }
+    QString name = prefix.isEmpty() ? relative : prefix + "/" + relative;
+    if (! addFile(name, file.readAll(), errMsg, types.value(relative)))
+      return false;
+  }
+
+  return true;
+}
+
+bool PkgArchiveWriter::close(QString &errMsg)
+{
+  if (! _indexed)
+  {
+    // end of archive is two empty blocks
+    if (! write(QByteArray(2 * TARBLOCK, '\0'), errMsg) || ! flush(true, errMsg))
+      return false;
+
+    _file.close();
+    return true;
+  }
+
+  QByteArray index = PkgArchive::packIndex(_members);
+  QByteArray indexFrame;
+  QByteArray endFrame;
+  if (! compress(header(PkgArchive::indexName(), index.size(), '0')
+                 + index + padding(index.size()), indexFrame, errMsg) ||
+      ! compress(QByteArray(2 * TARBLOCK, '\0'), endFrame, errMsg))
+    return false;
+
+  bool ok = _file.write(indexFrame) == indexFrame.size() && _body->seek(0);
+  while (ok && ! _body->atEnd())
+  {
+    QByteArray chunk = _body->read(64 * CHUNK);
+    ok = ! chunk.isEmpty() && _file.write(chunk) == chunk.size();
+  }
+  if (! ok || _file.write(endFrame) != endFrame.size())
+  {
+    errMsg = TR("Could not write %1: %2").arg(_file.fileName(), _file.errorString());
+    return false;
+  }
+
+  _file.close();
+  return true;
+}
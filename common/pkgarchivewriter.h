@@ -0,0 +1,71 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __PKGARCHIVEWRITER_H__
+#define __PKGARCHIVEWRITER_H__
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+#include "pkgarchive.h"
+
+class QTemporaryFile;
+
+/* PkgArchiveWriter writes update packages that PkgArchive can read: a tar
+   stream, optionally gzip or zstd compressed. Zstd output is cut into
+   independent frames of frameSize() bytes of tar data each so the loader
+   can decode them in parallel.
+
+   With setIndexed(true) it writes a v2 package instead: every member gets a
+   compressed frame of its own and an index of them is written first. The
+   member frames are held in a temporary file until close().
+ */
+class PkgArchiveWriter
+{
+  public:
+    PkgArchiveWriter(const QString &filename,
+                     PkgArchive::Format format = PkgArchive::Gzip);
+    virtual ~PkgArchiveWriter();
+
+    virtual bool open(QString &errMsg);
+    virtual bool addFile(const QString &name, const QByteArray &data,
+                         QString &errMsg, int type = 0);
+    virtual bool addDirectory(const QString &dirname, const QString &prefix,
+                              QString &errMsg);
+    virtual bool close(QString &errMsg);
+
+    PkgArchive::Format format()    const { return _format; }
+    int                frameSize() const { return _frameSize; }
+    bool               indexed()   const { return _indexed; }
+    void setFrameSize(int size)          { _frameSize = size; }
+    void setIndexed(bool indexed)        { _indexed = indexed; }
+
+    static PkgArchive::Format formatFor(const QString &filename);
+
+  protected:
+    QTemporaryFile    *_body;       // v2 member frames
+    QFile              _file;
+    PkgArchive::Format _format;
+    QByteArray         _frame;      // tar data not yet compressed
+    int                _frameSize;
+    bool               _indexed;
+    QList<PkgMember>   _members;    // v2 index entries
+    void              *_stream;     // z_stream, kept opaque to avoid zlib.h
+
+    virtual bool       compress(const QByteArray &data, QByteArray &out,
+                                QString &errMsg);
+    virtual bool       flush(bool finish, QString &errMsg);
+    virtual QByteArray header(const QString &name, qint64 size, char type);
+    virtual bool       write(const QByteArray &data, QString &errMsg);
+};
+
+#endif
@@ -0,0 +1,232 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "pkgcache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QSettings>
+#include <QStringList>
+#if QT_VERSION >= 0x050000
+#include <QStandardPaths>
+#else
+#include <QDesktopServices>
+#endif
+
+#include "pkgarchive.h"
+#include "updaterdata.h"
+
+#define DEBUG false
+
+#define CACHEMAGIC    0x58555043      // "XUPC"
+#define CACHEVERSION  1
+
+PkgCache::PkgCache(const QString &dir)
+  : _dir(dir.isEmpty() ? defaultDir() : dir),
+    _maxEntries(5)
+{
+}
+
+PkgCache::~PkgCache()
+{
+}
+
+QString PkgCache::defaultDir()
+{
+#if QT_VERSION >= 0x050000
+  QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+#else
+  QString base = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+#endif
+  if (base.isEmpty())
+    base = QDir::tempPath() + "/xTuple Updater";
+  return base + "/packages";
+}
+
+bool PkgCache::enabled()
+{
+  QSettings settings("xTuple.com", "Updater");
+  return settings.value("PackageCache", false).toBool();
+}
+
+void PkgCache::setEnabled(bool enabled)
+{
+  QSettings settings("xTuple.com", "Updater");
+  settings.setValue("PackageCache", enabled);
+}
+
+QString PkgCache::key(const QString &filename)
+{
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly))
+    return QString::null;
+
+  QCryptographicHash hash(QCryptographicHash::Md5);
+  while (! file.atEnd())
+  {
+    QByteArray chunk = file.read(1024 * 1024);
+    if (chunk.isEmpty())
+      return QString::null;
+    hash.addData(chunk);
+  }
+  hash.addData(Updater::version.toUtf8());
+
+  return QString(hash.result().toHex());
+}
+
+/* Open archive, from the cache if it holds this package and otherwise by
+   scanning the whole package and adding it to the cache. A package that
+   cannot be cached is still opened as usual.
+ */
+bool PkgCache::open(PkgArchive *archive, QString &errMsg)
+{
+  QString k = key(archive->filename());
+  if (k.isEmpty() || ! QDir().mkpath(_dir))
+    return archive->open(errMsg);
+
+  QList<PkgMember> members;
+  if (load(archive, k, members))
+  {
+    if (! archive->open(errMsg))
+      return false;
+
+    QString restoreMsg;
+    if (archive->hasIndex() ||
+        ! archive->restore(members, QDir(_dir).filePath(k + ".spool"), restoreMsg))
+    {
+      // the package will be scanned as if it had never been cached
+      if (DEBUG)
+        qDebug("PkgCache::open(%s) could not restore: %s",
+               qPrintable(k), qPrintable(restoreMsg));
+      remove(k);
+    }
+    else if (DEBUG)
+      qDebug("PkgCache::open(%s) restored %d members of %s", qPrintable(k),
+             members.size(), qPrintable(archive->filename()));
+    return true;
+  }
+
+  archive->setSpoolName(QDir(_dir).filePath(k + ".spool"));
+  if (! archive->open(errMsg))
+  {
+    remove(k);
+    return false;
+  }
+
+  if (archive->hasIndex())
+    return true;
+
+  if (! archive->scan(errMsg))
+  {
+    remove(k);
+    return false;
+  }
+
+  if (! save(archive, k))
+    remove(k);
+
+  return true;
+}
+
+// read the entry for k, checking that it is complete and belongs to archive
+bool PkgCache::load(PkgArchive *archive, const QString &k, QList<PkgMember> &members)
+{
+  QFile file(QDir(_dir).filePath(k + ".idx"));
+  if (! file.open(QIODevice::ReadOnly))
+    return false;
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_4_0);
+
+  quint32    magic, version, count;
+  QString    storedKey;
+  qint64     pkgSize, spoolSize;
+  in >> magic >> version >> storedKey >> pkgSize >> spoolSize >> count;
+
+  QString spoolName = QDir(_dir).filePath(k + ".spool");
+  bool ok = in.status() == QDataStream::Ok && magic == CACHEMAGIC &&
+            version == CACHEVERSION && storedKey == k &&
+            pkgSize == QFileInfo(archive->filename()).size() &&
+            (spoolSize < 0 || spoolSize == QFileInfo(spoolName).size());
+
+  for (quint32 i = 0; ok && i < count && in.status() == QDataStream::Ok; i++)
+  {
+    QByteArray name;
+    PkgMember  member;
+    in >> name >> member.offset >> member.size >> member.crc;
+    member.name  = QString::fromUtf8(name);
+    member.frame = -1;
+    member.fsize = 0;
+    member.type  = 0;
+    members.append(member);
+  }
+  file.close();
+
+  if (! ok || in.status() != QDataStream::Ok)
+  {
+    members.clear();
+    remove(k);
+    return false;
+  }
+  return true;
+}
+
+bool PkgCache::save(PkgArchive *archive, const QString &k)
+{
+  QFile file(QDir(_dir).filePath(k + ".idx"));
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return false;
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_4_0);
+
+  QList<PkgMember> members = archive->memberList();
+  qint64 spoolSize = archive->format() == PkgArchive::Tar
+                   ? -1 : QFileInfo(archive->spoolName()).size();
+  out << (quint32)CACHEMAGIC << (quint32)CACHEVERSION << k
+      << (qint64)QFileInfo(archive->filename()).size() << spoolSize
+      << (quint32)members.size();
+  foreach (PkgMember member, members)
+    out << member.name.toUtf8() << member.offset << member.size << member.crc;
+
+  file.close();
+  if (out.status() != QDataStream::Ok || file.error() != QFile::NoError)
+    return false;
+
+  prune();
+  return true;
+}
+
+void PkgCache::remove(const QString &k)
+{
+  QDir dir(_dir);
+  dir.remove(k + ".idx");
+  dir.remove(k + ".spool");
+}
+
+// keep the newest maxEntries() entries
+void PkgCache::prune()
+{
+  QDir dir(_dir);
+  QStringList entries = dir.entryList(QStringList("*.idx"), QDir::Files, QDir::Time);
+  for (int i = _maxEntries; i < entries.size(); i++)
+    remove(QFileInfo(entries.at(i)).completeBaseName());
+}
+
+void PkgCache::clear()
+{
+  QDir dir(_dir);
+  foreach (QString entry, dir.entryList(QStringList("*.idx"), QDir::Files))
+    remove(QFileInfo(entry).completeBaseName());
+}
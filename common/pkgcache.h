@@ -0,0 +1,58 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __PKGCACHE_H__
+#define __PKGCACHE_H__
+
+#include <QList>
+#include <QString>
+
+class PkgArchive;
+struct PkgMember;
+
+/* PkgCache keeps what opening a v1 package costs, the unpacked tar stream
+   and the member index from scanning it, in a local directory so reopening
+   the same package skips decompression and the scan. Entries are keyed by
+   the MD5 of the package file and the updater version; an entry that does
+   not match in every detail is thrown away. At most maxEntries() packages
+   are kept, newest first.
+
+   v2 packages carry their own index and are not cached.
+ */
+class PkgCache
+{
+  public:
+    PkgCache(const QString &dir = QString::null);
+    virtual ~PkgCache();
+
+    virtual bool open(PkgArchive *archive, QString &errMsg);
+    virtual void clear();
+
+    QString dir()        const { return _dir; }
+    int     maxEntries() const { return _maxEntries; }
+    void    setMaxEntries(int max) { _maxEntries = max; }
+
+    static QString defaultDir();
+    static bool    enabled();
+    static void    setEnabled(bool enabled);
+
+  protected:
+    QString _dir;
+    int     _maxEntries;
+
+    virtual QString key(const QString &filename);
+    virtual bool    load(PkgArchive *archive, const QString &key,
+                         QList<PkgMember> &members);
+    virtual void    prune();
+    virtual void    remove(const QString &key);
+    virtual bool    save(PkgArchive *archive, const QString &key);
+};
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "pkgprefetcher.h"
+
+#include <QMutexLocker>
+#include <QObject>
+
+#include "pkgarchive.h"
+
+#define TR(a) QObject::tr(a)
+
+#define DEBUG false
+
+PkgPrefetcher::PkgPrefetcher(PkgArchive *archive, const QStringList &names,
+                             int depth, qint64 maxBytes)
+  : _archive(archive),
+    _bytes(0),
+    _depth(qMax(depth, 1)),
+    _done(false),
+    _finishing(false),
+    _maxBytes(maxBytes),
+    _names(names),
+    _stopping(false)
+{
+}
+
+PkgPrefetcher::~PkgPrefetcher()
+{
+  stop();
+  wait();
+}
+
+/* v2 members are read a batch at a time so their frames are decoded in
+   parallel, as many as there are cores and room in the queue. Other
+   packages are read one member at a time, in tar order.
+ */
+void PkgPrefetcher::run()
+{
+  int cores = _archive->hasIndex() ? qMax(QThread::idealThreadCount(), 1) : 1;
+  for (int next = 0; next < _names.size(); )
+  {
+    int count;
+    {
+      QMutexLocker locker(&_mutex);
+      while (! _stopping && ! _finishing && ! _queue.isEmpty() &&
+             (_queue.size() >= _depth || _bytes >= _maxBytes))
+        _space.wait(&_mutex);
+      if (_stopping)
+        break;
+      count = qMax(qMin(cores, _depth - _queue.size()), 1);
+    }
+
+    // the archive is only touched outside the lock, by this thread alone
+    QStringList       names = _names.mid(next, count);
+    QList<QByteArray> batch = _archive->data(names);
+    bool              valid = _archive->isValid() &&
+                              batch.size() == names.size();
+    next += names.size();
+
+    if (DEBUG)
+      qDebug("PkgPrefetcher::run() read %d of %d members from %s",
+             batch.size(), names.size(), qPrintable(names.first()));
+
+    QMutexLocker locker(&_mutex);
+    if (_finishing)           // nobody will take() the rest
+      break;
+    for (int i = 0; i < batch.size(); i++)
+    {
+      Entry entry;
+      entry.name = names.at(i);
+      entry.data = batch.at(i);
+      _bytes += entry.data.size();
+      _queue.enqueue(entry);
+    }
+    if (! batch.isEmpty())
+      _ready.wakeAll();
+    if (! valid)
+    {
+      _errMsg = _archive->errorString();
+      break;
+    }
+  }
+
+  // index whatever follows the last member we were asked for
+  QString errMsg;
+  bool    stopping;
+  {
+    QMutexLocker locker(&_mutex);
+    stopping = _stopping || ! _errMsg.isEmpty();
+  }
+  if (! stopping && ! _archive->scan(errMsg))
+  {
+    QMutexLocker locker(&_mutex);
+    _errMsg = errMsg;
+  }
+
+  QMutexLocker locker(&_mutex);
+  _done = true;
+  _ready.wakeAll();
+}
+
+/* Return the data of the next member in the queue, waiting for it if the
+   reader has not got there yet. name must be the next name in the list the
+   prefetcher was given.
+ */
+bool PkgPrefetcher::take(const QString &name, QByteArray &data, QString &errMsg)
+{
+  QMutexLocker locker(&_mutex);
+  while (_queue.isEmpty() && ! _done)
+    _ready.wait(&_mutex);
+
+  if (_queue.isEmpty())
+  {
+    errMsg = _errMsg.isEmpty() ? TR("<p>Could not read %1 from the package.")
+                                   .arg(name)
+                               : _errMsg;
+    return false;
+  }
+
+  Entry entry = _queue.dequeue();
+  _bytes -= entry.data.size();
+  _space.wakeAll();
+
+  if (entry.name != name)
+  {
+    errMsg = TR("<p>Expected to read %1 from the package but got %2.")
+               .arg(name, entry.name);
+    return false;
+  }
+
+  data = entry.data;
+  return true;
+}
+
+/* Wait for the reader to finish the scan of the package. Members not yet
+   taken are discarded.
+ */
+bool PkgPrefetcher::finish(QString &errMsg)
+{
+  {
+    QMutexLocker locker(&_mutex);
+    _finishing = true;
+    _queue.clear();
+    _bytes = 0;
+    _space.wakeAll();
+  }
+  wait();
+
+  QMutexLocker locker(&_mutex);
+  if (! _errMsg.isEmpty())
+  {
+    errMsg = _errMsg;
+    return false;
+  }
+  return true;
+}
+
+void PkgPrefetcher::stop()
+{
+  QMutexLocker locker(&_mutex);
+  _stopping = true;
+  _space.wakeAll();
+}
@@ -0,0 +1,75 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __PKGPREFETCHER_H__
+#define __PKGPREFETCHER_H__
+
+#include <QByteArray>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+class PkgArchive;
+
+/* PkgPrefetcher reads package members on a background thread, in the order
+   they will be applied, so decompression and checksumming of the next
+   members overlap the database work on the current one. Once the list is
+   exhausted it finishes scanning the rest of the package. The frames of
+   v2 members are decoded several at a time, one per core.
+
+   At most depth() members, or maxBytes() bytes of them, wait in the queue;
+   the reader blocks until take() makes room. A single member larger than
+   maxBytes() is still admitted when the queue is empty.
+
+   While the prefetcher runs it is the only user of the PkgArchive. Delete
+   the prefetcher, or call finish(), before touching the archive again.
+ */
+class PkgPrefetcher : public QThread
+{
+  public:
+    PkgPrefetcher(PkgArchive *archive, const QStringList &names,
+                  int depth = 8, qint64 maxBytes = 64 * 1024 * 1024);
+    virtual ~PkgPrefetcher();
+
+    virtual bool take(const QString &name, QByteArray &data, QString &errMsg);
+    virtual bool finish(QString &errMsg);
+    virtual void stop();
+
+    int    depth()    const { return _depth; }
+    qint64 maxBytes() const { return _maxBytes; }
+
+  protected:
+    struct Entry
+    {
+      QString    name;
+      QByteArray data;
+    };
+
+    PkgArchive     *_archive;
+    qint64          _bytes;     // queued so far
+    int             _depth;
+    bool            _done;
+    QString         _errMsg;
+    bool            _finishing; // no more take()s are coming
+    qint64          _maxBytes;
+    QMutex          _mutex;
+    QStringList     _names;
+    QQueue<Entry>   _queue;
+    QWaitCondition  _ready;     // something was queued or the reader ended
+    QWaitCondition  _space;     // something was taken or stop() was called
+    bool            _stopping;
+
+    virtual void run();
+};
+
+#endif
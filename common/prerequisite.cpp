@@ -13,8 +13,10 @@
 #include <QDomDocument>
 #include <QList>
 #include <QSqlError>
+#include <QtAlgorithms>
 #include <QVariant>
 
+#include "pgpipeline.h"
 #include "xabstractmessagehandler.h"
 #include "xsqlquery.h"
 
@@ -252,6 +254,18 @@ Prerequisite::Type Prerequisite::nameToType(const QString & name)
   return None;
 }
 
+QString Prerequisite::unmetDependencyMsg() const
+{
+  return TR("%1<br>The prerequisite %2 has not been met. It "
+            "requires that the package %3 (version %4, "
+            "developer %5) be installed first.")
+           .arg(_message).arg(_name).arg(_dependency->name())
+           .arg(_dependency->version().isEmpty() ?
+                TR("Unspecified") : _dependency->version())
+           .arg(_dependency->developer().isEmpty() ?
+                TR("Unspecified") : _dependency->developer());
+}
+
 QStringList Prerequisite::typeList(bool includeNone)
 {
   QStringList list;
@@ -329,14 +343,7 @@ bool Prerequisite::met(QString &errMsg, XAbstractMessageHandler *handler)
         errMsg = _sqlerrtxt.arg(_name).arg(query.lastError().databaseText())
                            .arg(query.lastError().driverText());
       else
-        errMsg = TR("%1<br>The prerequisite %2 has not been met. It "
-                             "requires that the package %3 (version %4, "
-                             "developer %5) be installed first.")
-                    .arg(_message).arg(_name).arg(_dependency->name())
-                    .arg(_dependency->version().isEmpty() ?
-                         TR("Unspecified") : _dependency->version())
-                    .arg(_dependency->developer().isEmpty() ?
-                         TR("Unspecified") : _dependency->developer());
+        errMsg = unmetDependencyMsg();
       break;
       }
 
@@ -464,3 +471,125 @@ int Prerequisite::writeToDB(const QString pkgname, QString &errMsg)
 
   return 0;
 }
+
+/* Check a package's prerequisites with as few round trips as possible and
+   return how many were used. Every Dependency is resolved by one query
+   against pkghead and single-statement Query prerequisites are sent
+   together through a PgPipeline. met and errMsgs get one entry per prerequisite in list, set
+   just as met() would have set them. Anything the batches cannot answer,
+   multi-statement queries and License prompts included, falls back to
+   met().
+ */
+int Prerequisite::metAll(const QList<Prerequisite*> &list, QList<bool> &met,
+                         QStringList &errMsgs, XAbstractMessageHandler *handler)
+{
+  met.clear();
+  errMsgs.clear();
+
+  QList<int>  dependencies;
+  QList<int>  queries;
+  QList<int>  others;
+  QStringList names;
+  for (int i = 0; i < list.size(); i++)
+  {
+    met.append(false);
+    errMsgs.append(QString());
+
+    Prerequisite *prereq = list.at(i);
+    if (prereq->_type == Dependency && prereq->_dependency)
+    {
+      dependencies.append(i);
+      if (! names.contains(prereq->_dependency->name()))
+        names.append(prereq->_dependency->name());
+    }
+    else if (prereq->_type == Query &&
+             PgPipeline::isSingleStatement(prereq->_query))
+      queries.append(i);
+    else
+      others.append(i);
+  }
+
+  int roundTrips = 0;
+
+  if (! dependencies.isEmpty())
+  {
+    QStringList marks;
+    for (int i = 0; i < names.size(); i++)
+      marks.append("?");
+
+    XSqlQuery pkghead;
+    pkghead.prepare(QString("SELECT pkghead_name, pkghead_version,"
+                            "       pkghead_developer"
+                            "  FROM pkghead"
+                            " WHERE pkghead_name IN (%1);").arg(marks.join(", ")));
+    foreach (QString name, names)
+      pkghead.addBindValue(name);
+    roundTrips++;
+    if (pkghead.exec())
+    {
+      QList<QStringList> installed;
+      while (pkghead.next())
+        installed.append(QStringList()
+                         << pkghead.value("pkghead_name").toString()
+                         << pkghead.value("pkghead_version").toString()
+                         << pkghead.value("pkghead_developer").toString());
+
+      foreach (int i, dependencies)
+      {
+        DependsOn *dep = list.at(i)->_dependency;
+        foreach (QStringList row, installed)
+        {
+          if (row.at(0) == dep->name() &&
+              (dep->version().isEmpty()   || row.at(1) == dep->version()) &&
+              (dep->developer().isEmpty() || row.at(2) == dep->developer()))
+          {
+            met[i] = true;
+            break;
+          }
+        }
+        if (! met.at(i))
+          errMsgs[i] = list.at(i)->unmetDependencyMsg();
+      }
+    }
+    else
+      others += dependencies;
+  }
+
+  if (! queries.isEmpty())
+  {
+    PgPipeline pipeline;
+    foreach (int i, queries)
+      pipeline.append(list.at(i)->_query);
+
+    roundTrips += pipeline.isPipelined() ? 1 : queries.size();
+    QString errMsg;
+    pipeline.run(errMsg);
+
+    // a failure ends the batch; met() reports it and checks the rest
+    int answered = pipeline.failedAt() < 0 ? queries.size()
+                                           : pipeline.failedAt();
+    for (int q = 0; q < queries.size(); q++)
+    {
+      if (q < answered)
+      {
+        met[queries.at(q)]     = pipeline.value(q).toBool();
+        errMsgs[queries.at(q)] = list.at(queries.at(q))->_message;
+      }
+      else
+        others.append(queries.at(q));
+    }
+  }
+
+  qSort(others);
+  foreach (int i, others)
+  {
+    met[i] = list.at(i)->met(errMsgs[i], handler);
+    if (list.at(i)->_type == Dependency || list.at(i)->_type == Query)
+      roundTrips++;
+  }
+
+  if (DEBUG)
+    qDebug("Prerequisite::metAll() %d prerequisites in %d round trips",
+           list.size(), roundTrips);
+  return roundTrips;
+}
@@ -82,6 +82,8 @@ class Prerequisite
     };
 
     virtual bool met(QString &errMsg, XAbstractMessageHandler *handler);
+    static  int  metAll(const QList<Prerequisite*> &list, QList<bool> &met,
+                        QStringList &errMsgs, XAbstractMessageHandler *handler);
     virtual int  writeToDB(const QString, QString &);
 
     QString name() const { return _name; }
@@ -94,6 +96,8 @@ class Prerequisite
     void setMessage(const QString & message) { _message = message; }
 
     QString query() const { return _query; }
+
+    DependsOn *dependency() const { return _dependency; }
     void setQuery(const QString & query) { _query = query; }
 
     void setProvider(const PrerequisiteProvider &);
@@ -106,6 +110,8 @@ class Prerequisite
     static QStringList typeList(bool includeNone = true);
 
   protected:
+    QString unmetDependencyMsg() const;
+
     DependsOn  *_dependency;
     QString    _message;
     QString    _name;
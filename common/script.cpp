@@ -14,7 +14,6 @@
 #include <QDomDocument>
 #include <QSqlError>
 
-#include "metasql.h"
 #include "xsqlquery.h"
 
 #define DEBUG false
@@ -117,9 +116,11 @@ int Script::writeToDB(QByteArray &pData, const QString pAnnotation, ParameterLis
   }
 
   cleanData(pData);
-  char *data = pData.data();
+
+  // pData may be a view over a mapped package; it need not be nul-terminated
+  const char *data = pData.constData();
   XSqlQuery create;
-  create.exec(QString::fromLocal8Bit(data));
+  create.exec(QString::fromLocal8Bit(data, qstrnlen(data, pData.size())));
   if (create.lastError().type() != QSqlError::NoError)
   {
     errMsg = _sqlerrtxt.arg(filename())
@@ -0,0 +1,261 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "serverapply.h"
+
+#include <QObject>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QStringList>
+#include <QVariant>
+
+#ifdef HAVE_LIBPQ
+#include <libpq-fe.h>
+#endif
+
+#include "loadablebatch.h"
+#include "pgpipeline.h"
+#include "script.h"
+#include "xsqlquery.h"
+
+#define DEBUG false
+#define TR(a) QObject::tr(a)
+
+// staging INSERTs when COPY is not available
+#define STAGEROWS  100
+#define STAGEBYTES (4 * 1024 * 1024)
+
+// the size of each piece of COPY data handed to libpq
+#define COPYCHUNK  (1024 * 1024)
+
+#ifdef HAVE_LIBPQ
+// the libpq connection behind a QPSQL database connection, if there is one
+static PGconn *pgconn(QSqlDatabase &db)
+{
+  if (! db.isOpen() || ! db.driver())
+    return 0;
+
+  QVariant handle = db.driver()->handle();
+  if (handle.isValid() && qstrcmp(handle.typeName(), "PGconn*") == 0)
+    return *static_cast<PGconn **>(handle.data());
+
+  return 0;
+}
+#endif
+
+// a field in COPY's text format
+static QByteArray copyField(const QString &value)
+{
+  QByteArray result = value.toUtf8();
+  result.replace('\\', "\\\\");
+  result.replace('\t', "\\t");
+  result.replace('\n', "\\n");
+  result.replace('\r', "\\r");
+  return result;
+}
+
+ServerApply::ServerApply(QSqlDatabase db)
+  : _bytes(0),
+    _db(db)
+{
+}
+
+ServerApply::~ServerApply()
+{
+}
+
+/* Queue the statements that write batch. The batch itself is left alone.
+   Returns the number of items in the batch or a negative value on error.
+ */
+int ServerApply::addBatch(LoadableBatch &batch, QString &errMsg)
+{
+  PgPipeline pipeline(_db);
+  int result = batch.queue(pipeline, errMsg);
+  if (result <= 0)
+    return result;
+
+  QString label = TR("a batch of %1 %2 items").arg(result).arg(batch.nodename());
+  foreach (QString sql, pipeline.statements())
+  {
+    Item item;
+    item.label = label;
+    item.sql   = sql;
+    _items.append(item);
+    _bytes += sql.size();
+  }
+
+  return result;
+}
+
+/* Queue a script's contents, prepared as Script::writeToDB() would.
+   Returns -1 with a warning in errMsg if there is nothing to run.
+ */
+int ServerApply::addScript(Script *script, QByteArray &data, QString &errMsg)
+{
+  if (data.isEmpty())
+  {
+    errMsg = TR("The file %1 is empty.").arg(script->filename());
+    return -1;
+  }
+
+  script->cleanData(data);
+
+  const char *sql = data.constData();
+  Item item;
+  item.label = script->filename();
+  item.sql   = QString::fromLocal8Bit(sql, qstrnlen(sql, data.size()));
+  _items.append(item);
+  _bytes += item.sql.size();
+
+  return 0;
+}
+
+void ServerApply::clear()
+{
+  _items.clear();
+  _bytes = 0;
+}
+
+bool ServerApply::copy(const QByteArray &rows, QString &errMsg)
+{
+#ifdef HAVE_LIBPQ
+  PGconn *conn = pgconn(_db);
+  if (! conn)
+  {
+    errMsg = TR("The database connection does not support COPY.");
+    return false;
+  }
+
+  PGresult *res = PQexec(conn, "COPY pg_temp.updaterstage (seq, label, sql)"
+                               " FROM STDIN;");
+  bool ok = PQresultStatus(res) == PGRES_COPY_IN;
+  PQclear(res);
+
+  for (int i = 0; ok && i < rows.size(); i += COPYCHUNK)
+    ok = PQputCopyData(conn, rows.constData() + i,
+                       qMin(COPYCHUNK, rows.size() - i)) == 1;
+  if (PQputCopyEnd(conn, ok ? 0 : "updater staging failed") != 1)
+    ok = false;
+
+  while ((res = PQgetResult(conn)))
+  {
+    if (PQresultStatus(res) != PGRES_COMMAND_OK)
+      ok = false;
+    PQclear(res);
+  }
+
+  if (! ok)
+    errMsg = QString::fromUtf8(PQerrorMessage(conn));
+  return ok;
+#else
+  Q_UNUSED(rows);
+  errMsg = TR("This program was built without libpq and cannot use COPY.");
+  return false;
+#endif
+}
+
+// create the staging table and apply function and fill the table
+bool ServerApply::stage(QString &errMsg)
+{
+  PgPipeline pipeline(_db);
+  pipeline.append("CREATE TEMPORARY TABLE IF NOT EXISTS updaterstage ("
+                  "  seq INTEGER, label TEXT, sql TEXT"
+                  ") ON COMMIT DROP;");
+  pipeline.append("TRUNCATE pg_temp.updaterstage;");
+  pipeline.append("CREATE OR REPLACE FUNCTION pg_temp.updaterapply()"
+                  " RETURNS INTEGER AS $updaterapply$"
+                  " DECLARE"
+                  "   _r     RECORD;"
+                  "   _label TEXT;"
+                  "   _count INTEGER := 0;"
+                  " BEGIN"
+                  "   FOR _r IN SELECT label, sql FROM pg_temp.updaterstage"
+                  "              ORDER BY seq LOOP"
+                  "     _label := _r.label;"
+                  "     EXECUTE _r.sql;"
+                  "     _count := _count + 1;"
+                  "   END LOOP;"
+                  "   RETURN _count;"
+                  " EXCEPTION WHEN OTHERS THEN"
+                  "   RAISE EXCEPTION '%: %', _label, SQLERRM"
+                  "         USING ERRCODE = SQLSTATE;"
+                  " END;"
+                  " $updaterapply$ LANGUAGE plpgsql;");
+
+#ifdef HAVE_LIBPQ
+  if (pgconn(_db))
+  {
+    if (! pipeline.run(errMsg))
+      return false;
+
+    QByteArray rows;
+    for (int i = 0; i < _items.size(); i++)
+      rows += QByteArray::number(i) + '\t' + copyField(_items.at(i).label) +
+              '\t' + copyField(_items.at(i).sql) + '\n';
+    return copy(rows, errMsg);
+  }
+#endif
+
+  QStringList     values;
+  QList<QVariant> params;
+  qint64          bytes = 0;
+  for (int i = 0; i < _items.size(); i++)
+  {
+    values.append("(?, ?, ?)");
+    params << i << _items.at(i).label << _items.at(i).sql;
+    bytes += _items.at(i).sql.size();
+
+    if (values.size() >= STAGEROWS || bytes >= STAGEBYTES ||
+        i == _items.size() - 1)
+    {
+      pipeline.append("INSERT INTO pg_temp.updaterstage (seq, label, sql)"
+                      " VALUES " + values.join(", ") + ";", params);
+      values.clear();
+      params.clear();
+      bytes = 0;
+    }
+  }
+
+  return pipeline.run(errMsg);
+}
+
+/* Returns the number of items applied or a negative value on error, in
+   which case the transaction is aborted and must be rolled back.
+ */
+int ServerApply::run(QString &errMsg)
+{
+  if (_items.isEmpty())
+    return 0;
+
+  QString message;
+  if (! stage(message))
+  {
+    errMsg = TR("Could not stage the package on the server:<br><pre>%1</pre>")
+              .arg(message);
+    return -1;
+  }
+
+  XSqlQuery applyq(_db);
+  applyq.exec("SELECT pg_temp.updaterapply() AS applied;");
+  if (applyq.lastError().type() != QSqlError::NoError)
+  {
+    errMsg = TR("Could not apply the package on the server:<br><pre>%1<br>%2</pre>")
+              .arg(applyq.lastError().databaseText())
+              .arg(applyq.lastError().driverText());
+    return -2;
+  }
+
+  int result = applyq.first() ? applyq.value("applied").toInt() : 0;
+  if (DEBUG)
+    qDebug("ServerApply::run() applied %d statements, %lld characters",
+           result, _bytes);
+
+  return result;
+}
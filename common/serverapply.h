@@ -0,0 +1,67 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __SERVERAPPLY_H__
+#define __SERVERAPPLY_H__
+
+#include <QByteArray>
+#include <QList>
+#include <QSqlDatabase>
+#include <QString>
+
+class LoadableBatch;
+class Script;
+
+/* ServerApply ships many package items to the server at once and applies
+   them there, so the time an update takes no longer grows with the number
+   of round trips to a distant database.
+
+   Each item is reduced to the SQL the client would have run for it: a
+   Script's contents as is, a LoadableBatch's statements with their
+   parameters written out. run() loads them into a temporary table, with
+   COPY when the connection has libpq behind it, and calls a temporary
+   PL/pgSQL function that executes them in order.
+
+   The items either all succeed or run() fails, naming the item that broke,
+   and leaves the transaction aborted. There is no OnError handling or
+   catalog check on the server; wrap run() in a savepoint and apply the
+   items from the client when it fails, and check database objects with a
+   CatalogSnapshot afterwards.
+ */
+class ServerApply
+{
+  public:
+    ServerApply(QSqlDatabase db = QSqlDatabase::database());
+    virtual ~ServerApply();
+
+    virtual int  addBatch(LoadableBatch &batch, QString &errMsg);
+    virtual int  addScript(Script *script, QByteArray &data, QString &errMsg);
+    virtual void clear();
+    virtual int  run(QString &errMsg);
+
+    qint64 bytes() const { return _bytes; }
+    int    size()  const { return _items.size(); }
+
+  protected:
+    struct Item
+    {
+      QString label;
+      QString sql;
+    };
+
+    qint64       _bytes;
+    QSqlDatabase _db;
+    QList<Item>  _items;
+
+    virtual bool copy(const QByteArray &rows, QString &errMsg);
+    virtual bool stage(QString &errMsg);
+};
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "statementcache.h"
+
+#include <QList>
+#include <QRegExp>
+#include <QStringList>
+#include <QVariant>
+
+#include "metasql.h"
+#include "xsqlquery.h"
+
+#define DEBUG false
+
+/* A MetaSQL template split around its value() and literal() tags:
+   text.at(i) precedes tag i and the last element of text follows the last
+   tag. mql is set instead when the template uses anything else.
+ */
+struct MqlTemplate
+{
+  QStringList   text;
+  QStringList   names;
+  QList<bool>   literal;
+  MetaSQLQuery *mql;
+};
+
+// one per distinct template, kept for the life of the process
+static QHash<QString, MqlTemplate *> _templates;
+
+static MqlTemplate *parse(const QString &mql)
+{
+  MqlTemplate *result = _templates.value(mql, 0);
+  if (result)
+    return result;
+
+  result = new MqlTemplate;
+  result->mql = 0;
+
+  QRegExp tagRE("<\\?\\s*(value|literal)\\s*\\(\\s*[\"']([^\"']+)[\"']\\s*\\)\\s*\\?>");
+  int pos   = 0;
+  int start = 0;
+  while ((start = tagRE.indexIn(mql, pos)) >= 0)
+  {
+    result->text.append(mql.mid(pos, start - pos));
+    result->literal.append(tagRE.cap(1) == "literal");
+    result->names.append(tagRE.cap(2));
+    pos = start + tagRE.matchedLength();
+  }
+  result->text.append(mql.mid(pos));
+
+  foreach (QString text, result->text)
+  {
+    if (text.contains("<?"))
+    {
+      result->mql = new MetaSQLQuery(mql);
+      break;
+    }
+  }
+
+  if (DEBUG)
+    qDebug("StatementCache parse() found %d tags%s", result->names.size(),
+           result->mql ? " and more" : "");
+
+  _templates.insert(mql, result);
+  return result;
+}
+
+StatementCache *StatementCache::_current = 0;
+
+StatementCache::StatementCache(QSqlDatabase db)
+  : _db(db),
+    _hits(0),
+    _previous(_current)
+{
+  _current = this;
+}
+
+StatementCache::~StatementCache()
+{
+  if (DEBUG)
+    qDebug("StatementCache::~StatementCache() %d statements, %d reused",
+           _prepared.size(), _hits);
+
+  qDeleteAll(_prepared);
+  _prepared.clear();
+
+  if (_current == this)
+    _current = _previous;
+}
+
+StatementCache *StatementCache::current()
+{
+  return _current;
+}
+
+XSqlQuery *StatementCache::query(const QString &sql)
+{
+  XSqlQuery *result = _prepared.value(sql, 0);
+  if (result)
+  {
+    _hits++;
+    return result;
+  }
+
+  result = new XSqlQuery(_db);
+  if (! result->prepare(sql))
+  {
+    delete result;
+    return 0;
+  }
+  _prepared.insert(sql, result);
+
+  return result;
+}
+
+/* Like MetaSQLQuery::toQuery(): the result has been executed and errors are
+   reported through its lastError(). A value() whose parameter is missing is
+   bound as NULL. The result may share its state with the cached query, so
+   use it before running the same statement again.
+ */
+XSqlQuery StatementCache::exec(const QString &mql, ParameterList &params)
+{
+  MqlTemplate *tmpl = parse(mql);
+  if (tmpl->mql)
+    return tmpl->mql->toQuery(params);
+
+  QString         sql = tmpl->text.at(0);
+  QList<QVariant> values;
+  for (int i = 0; i < tmpl->names.size(); i++)
+  {
+    bool     found = false;
+    QVariant value = params.value(tmpl->names.at(i), &found);
+    if (tmpl->literal.at(i))
+      sql += value.toString();
+    else
+    {
+      sql += "?";
+      values.append(found ? value : QVariant());
+    }
+    sql += tmpl->text.at(i + 1);
+  }
+
+  XSqlQuery  once;
+  XSqlQuery *qry = _current ? _current->query(sql) : 0;
+  if (! qry)
+  {
+    once.prepare(sql);
+    qry = &once;
+  }
+
+  for (int i = 0; i < values.size(); i++)
+    qry->bindValue(i, values.at(i));
+  qry->exec();
+
+  return *qry;
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __STATEMENTCACHE_H__
+#define __STATEMENTCACHE_H__
+
+#include <QHash>
+#include <QSqlDatabase>
+#include <QString>
+
+#include <parameter.h>
+
+class XSqlQuery;
+
+/* StatementCache runs the MetaSQL templates that Loadables and database
+   objects use to write themselves to the database.
+
+   Each template is parsed once per process, not once per item. Templates
+   that use only value() and literal() tags, which is all of them today, are
+   rendered without MetaSQL: literal()s are substituted and value()s become
+   bind parameters. Anything fancier is handed to MetaSQLQuery, still
+   parsed only once.
+
+   While a StatementCache object exists, typically for the length of an
+   update, the rendered statements stay prepared on the server and are
+   reused, one per template and set of literal()s (in practice one per
+   template and table name). Each item then costs one round trip per
+   statement instead of a prepare, an execute and a deallocate. Without a
+   StatementCache object, exec() prepares a fresh query every time.
+
+   The cached queries belong to the connection; destroy the StatementCache
+   before closing it.
+ */
+class StatementCache
+{
+  public:
+    StatementCache(QSqlDatabase db = QSqlDatabase::database());
+    virtual ~StatementCache();
+
+    static XSqlQuery exec(const QString &mql, ParameterList &params);
+    static StatementCache *current();
+
+    int hits()     const { return _hits; }
+    int prepared() const { return _prepared.size(); }
+
+  protected:
+    QSqlDatabase                _db;
+    int                         _hits;
+    QHash<QString, XSqlQuery *> _prepared;  // rendered sql to its query
+    StatementCache             *_previous;
+
+    virtual XSqlQuery *query(const QString &sql);
+
+    static StatementCache *_current;
+};
+
+#endif
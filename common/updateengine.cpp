@@ -0,0 +1,2323 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "updateengine.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QMessageBox>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QXmlStreamReader>
+#if QT_VERSION >= 0x050000
+#include <QGuiApplication>
+#endif
+
+#include <xabstractmessagehandler.h>
+
+#include "catalogsnapshot.h"
+#include "createfunction.h"
+#include "createtable.h"
+#include "createtrigger.h"
+#include "createview.h"
+#include "dbobjscheduler.h"
+#include "finalscript.h"
+#include "initscript.h"
+#include "loadablebatch.h"
+#include "loadappscript.h"
+#include "loadappui.h"
+#include "loadcmd.h"
+#include "loadimage.h"
+#include "loadmetasql.h"
+#include "loadpriv.h"
+#include "loadreport.h"
+#include "package.h"
+#include "pkgarchive.h"
+#include "pkgcache.h"
+#include "pkgprefetcher.h"
+#include "pkgschema.h"
+#include "prerequisite.h"
+#include "script.h"
+#include "serverapply.h"
+#include "statementcache.h"
+#include "updaterdata.h"
+#include "updatejournal.h"
+#include "updatetimings.h"
+#include "xsqlquery.h"
+#include "xversion.h"
+
+#define DEBUG false
+
+#if defined(Q_OS_WIN32)
+#define NOCRYPT
+#include <windows.h>
+#include <lmcons.h>
+#undef LoadImage
+#else
+#if defined(Q_OS_MAC)
+#include <stdlib.h>
+#endif
+#endif
+#if not defined(Q_OS_WIN)
+#include <unistd.h>
+#include <pwd.h>
+#endif
+
+QString UpdateEngine::_rollbackMsg(tr("<p><font color='red'>The upgrade has "
+                                      "been aborted due to an error and your "
+                                      "database was rolled back to the state "
+                                      "it was in when the upgrade was "
+                                      "initiated.</font><br>"));
+
+class UpdateEnginePrivate
+{
+  private:
+    UpdateEngine *_p;
+
+  public:
+    UpdateEnginePrivate(UpdateEngine *parent, XAbstractMessageHandler *phandler)
+      : _p(parent),
+        handler(phandler),
+        journal(0),
+        prefetcher(0)
+    {
+      alwaysRollback = false;
+      inTransaction  = false;
+      groupSize   = 8;
+      lockWait    = 0;
+      serverApply = false;
+      rewrite     = false;
+      schedule    = false;
+      useJournal  = false;
+      useCache = PkgCache::enabled();
+    }
+
+    ~UpdateEnginePrivate()
+    {
+      delete prefetcher;
+      delete journal;
+    }
+
+    QString elapsedTime(QDateTime startTime, QDateTime endTime)
+    {
+      int elapsed = startTime.secsTo(endTime);
+      int sec = elapsed % 60;
+      elapsed = (elapsed - sec) / 60;
+      int min = elapsed % 60;
+      elapsed = (elapsed - min) / 60;
+      int hour = elapsed;
+      return _p->tr("<p>Total elapsed time is %1h %2m %3s</p>").arg(hour).arg(min).arg(sec);
+    }
+
+    // true if an earlier journaled run committed this stage
+    bool done(const QString &stage) const
+    {
+      return journal && journal->done(stage);
+    }
+
+    QString rollbackMsg() const
+    {
+      if (! journal || journal->resumable().isEmpty())
+        return UpdateEngine::_rollbackMsg;
+      return _p->tr("<p><font color='red'>The upgrade has been aborted due "
+                    "to an error. Only the work since the last completed "
+                    "stage was rolled back; these stages were kept: %1. "
+                    "Run this update again to resume after them.</font><br>")
+               .arg(journal->resumable().join(", "));
+    }
+
+    // the package's transaction, or its savepoint in the caller's
+    void begin()
+    {
+      XSqlQuery qry(inTransaction ? "SAVEPOINT updaterPackage;" : "BEGIN;");
+    }
+
+    void commit()
+    {
+      XSqlQuery qry(inTransaction ? "RELEASE SAVEPOINT updaterPackage;"
+                                  : "COMMIT;");
+    }
+
+    void rollback()
+    {
+      XSqlQuery qry(inTransaction ? "ROLLBACK TO SAVEPOINT updaterPackage;"
+                                  : "ROLLBACK;");
+    }
+
+    int  checkpoint(const QStringList &stages, bool triggersOff);
+    int  disableTriggers();
+    int  enableTriggers();
+    void finishJournal();
+    bool skip(const QString &stage, int size);
+    int  toggleTriggers(bool enable);
+
+    XAbstractMessageHandler *handler;
+    bool        alwaysRollback; // roll back even a successful update
+    bool        inTransaction;  // the caller began it and will end it
+    QString     prefix;        // of package members, from the package id
+    int         groupSize;     // items applied under one savepoint
+    UpdateJournal *journal;    // stages committed so far, if journaled
+    UpdateTimings timings;     // of open() and start()
+    QString     timingsFile;   // where to save them as JSON
+    QString     traceFile;     // and as Chrome trace events
+    PkgPrefetcher *prefetcher; // reads members ahead of applyPackage()
+    QMultiHash<QString, QByteArray> held; // members read but not yet applied
+    QStringList triggers;      // to be disabled and enabled
+    int         lockWait;      // msec waiting to lock the triggers' tables
+    QSet<Script *> unverified; // failed or empty, not checked in the catalog
+    QList<Script *> scheduled; // sql objects in dependency order, if it differs
+    bool        serverApply;   // ship most of the package in one round trip
+    bool        rewrite;       // even loadables whose content is unchanged
+    bool        schedule;      // order the sql objects by their dependencies
+    bool        useCache;
+    bool        useJournal;    // commit and record each stage as it finishes
+};
+
+// a Script or Loadable waiting to be applied, with its package member
+struct LoaderItem
+{
+  Script     *script;
+  Loadable   *loadable;
+  QByteArray  data;
+  int         grade;    // writeToDB() resolves lowest and highest
+
+  LoaderItem(Script *s, const QByteArray &d)
+    : script(s), loadable(0), data(d), grade(0) {}
+  LoaderItem(Loadable *l, const QByteArray &d)
+    : script(0), loadable(l), data(d), grade(l->grade()) {}
+
+  QString filename() const
+  {
+    return script ? script->filename() : loadable->filename();
+  }
+};
+
+#define MAXGROUP      256
+#define MAXGROUPBYTES (16 * 1024 * 1024)
+
+UpdateEngine::UpdateEngine(XAbstractMessageHandler *handler, QObject *parent)
+  : QObject(parent),
+    _package(0),
+    _files(0),
+    _progress(0),
+    _maximum(0)
+{
+  _p = new UpdateEnginePrivate(this, handler);
+}
+
+UpdateEngine::~UpdateEngine()
+{
+  close();
+  delete _p;
+}
+
+XAbstractMessageHandler *UpdateEngine::handler() const
+{
+  return _p->handler;
+}
+
+// of the last open() and start()
+const UpdateTimings &UpdateEngine::timings() const
+{
+  return _p->timings;
+}
+
+// the caller owns the handler
+void UpdateEngine::setHandler(XAbstractMessageHandler *handler)
+{
+  _p->handler = handler;
+}
+
+// unload the package, if there is one
+void UpdateEngine::close()
+{
+  if (_package)
+  {
+    delete _package;
+    _package = 0;
+  }
+
+  if (_p->prefetcher)          // before _files, which it is reading
+  {
+    delete _p->prefetcher;
+    _p->prefetcher = 0;
+  }
+
+  if (_files)
+  {
+    delete _files;
+    _files = 0;
+  }
+
+  _p->held.clear();
+  _p->scheduled.clear();
+
+  delete _p->journal;
+  _p->journal = 0;
+
+  _p->timings.clear();
+  _filename = QString::null;
+  _maximum  = 0;
+  setProgress(0);
+}
+
+void UpdateEngine::setProgress(int value)
+{
+  _progress = value;
+  emit progressChanged(_progress, _maximum);
+}
+
+bool UpdateEngine::open(const QString &pfilename)
+{
+  close();
+
+  QFileInfo fi(pfilename);
+  if (fi.filePath().isEmpty())
+    return false;
+    
+  _p->timings.startPhase("open");
+  QString errMsg;
+  _files = new PkgArchive(fi.filePath());
+  PkgCache cache;
+  if (! (_p->useCache ? cache.open(_files, errMsg) : _files->open(errMsg)))
+  {
+    _p->handler->message(QtFatalMsg, errMsg);
+    delete _files;
+    _files = 0;
+    return false;
+  }
+
+  // find the content file without unpacking the rest of the package
+  QString contentFile = QString::null;
+  QStringList contentsnames;
+  contentsnames << "package.xml" << "contents.xml";
+  for (int i = 0; i < contentsnames.size() && contentFile.isNull(); i++)
+    contentFile = _files->findFile(contentsnames.at(i));
+
+  if (! _files->isValid())
+  {
+    _p->handler->message(QtFatalMsg, _files->errorString());
+    delete _files;
+    _files = 0;
+    return false;
+  }
+
+  QStringList msgList;
+  QList<bool> fatalList;
+
+  if(contentFile.isNull())
+  {
+    _p->handler->message(QtFatalMsg,
+                         tr("<p>No %1 file was found in package %2.")
+                         .arg(contentsnames.join(" or ")).arg(fi.filePath()));
+    delete _files;
+    _files = 0;
+    return false;
+  }
+  else if (! contentFile.endsWith(contentsnames.at(0)))
+  {
+    qDebug("Deprecated Package Format: Packages for this version of "
+           "the Updater should have their contents described by a file "
+           "named %s. The current package being loaded uses an outdated "
+           "file name %s.",
+           qPrintable(contentsnames.at(0)), qPrintable(contentFile));
+  }
+
+  /* a second content file fails the package now if all of it is indexed,
+     as v2 and cached packages are, or else as soon as reading the package
+     comes across one
+   */
+  if (! _files->setUniqueName(QFileInfo(contentFile).fileName()))
+  {
+    _p->handler->message(QtFatalMsg, _files->errorString());
+    delete _files;
+    _files = 0;
+    return false;
+  }
+
+  _filename = fi.fileName();
+  QByteArray docData = _files->data(contentFile);
+
+  // no DOM tree of the whole file, which can be huge for big packages
+  QXmlStreamReader reader(docData);
+  _package = new Package(reader, msgList, fatalList, _p->handler);
+  if (reader.hasError())
+  {
+    _p->handler->message(QtFatalMsg,
+                         tr("<p>There was a problem reading the %1 file in "
+                            "this package.<br>%2<br>Line %3, Column %4")
+                         .arg(contentFile).arg(reader.errorString())
+                         .arg(reader.lineNumber()).arg(reader.columnNumber()));
+    delete _package;
+    _package = 0;
+    delete _files;
+    _files = 0;
+    return false;
+  }
+
+  QString delayedWarning;
+  if (msgList.size() > 0)
+  {
+    bool fatal = false;
+    if (DEBUG)
+      qDebug("UpdateEngine::open()  i fatal msg");
+    for (int i = 0; i < msgList.size(); i++)
+    {
+      _p->handler->message(QtWarningMsg,
+                  QString("<br><font color='%1'>%2</font>")
+                    .arg(fatalList.at(i) ? "red" : "orange")
+                    .arg(msgList.at(i)));
+      fatal = fatal || fatalList.at(i);
+      if (DEBUG)
+        qDebug("UpdateEngine::open() %2d %5d %s",
+               i, fatalList.at(i), qPrintable(msgList.at(i)));
+    }
+    if (fatal)
+    {
+      _p->handler->message(QtWarningMsg,
+          tr("<p><font color='red'>The %1 file appears "
+                       "to be invalid.</font></p>").arg(contentFile));
+      return false;
+    }
+    else
+      delayedWarning = tr("<p><font color='orange'>The %1 file "
+                          "seems to have problems. You should contact %2 "
+                          "before proceeding.</font></p>")
+                      .arg(contentFile)
+                      .arg(_package->developer().isEmpty() ?
+                           tr("the package developer") : _package->developer());
+  }
+
+  _p->timings.setPackage(_package->id());
+
+  _p->prefix = QString::null;
+  if(!_package->id().isEmpty())
+    _p->prefix = _package->id() + "/";
+
+  // a v2 package lists its members up front so we can check them now
+  if (_files->hasIndex())
+  {
+    QStringList missing;
+    foreach (QString name, packageMembers())
+      if (! _files->contains(name))
+        missing.append(name);
+    if (! missing.isEmpty())
+    {
+      _p->handler->message(QtFatalMsg,
+                           tr("<p>The package %1 does not contain these files "
+                              "listed in %2:<br>%3")
+                           .arg(fi.filePath(), contentFile,
+                                missing.join("<br>")));
+      return false;
+    }
+  }
+
+  _maximum = _package->_privs.size()
+                       + _package->_metasqls.size()
+                       + _package->_reports.size()
+                       + _package->_appuis.size()
+                       + _package->_appscripts.size()
+                       + _package->_cmds.size()
+                       + _package->_images.size()
+                       + _package->_qms.size()
+                       + _package->_prerequisites.size()
+                       + _package->_initscripts.size()
+                       + _package->_scripts.size()
+                       + _package->_functions.size()
+                       + _package->_tables.size()
+                       + _package->_triggers.size()
+                       + _package->_views.size()
+                       + _package->_finalscripts.size()
+                       + 2;
+  setProgress(0);
+  if (DEBUG)
+    qDebug("UpdateEngine::open() progress initialized to max %d", _maximum);
+
+  // before any transaction starts, so a cycle is reported before the update
+  if (_p->schedule)
+  {
+    _p->timings.startPhase("schedule");
+    if (! scheduleScripts())
+      return false;
+  }
+
+  _p->timings.startPhase("prerequisites");
+  _p->handler->message(QtWarningMsg, "<h3>Checking Prerequisites...</h3>");
+  bool allOk = true;
+
+  QString str;
+  if (_package->_prerequisites.size() > 0)
+  {
+    // all at once, rather than a round trip for each
+    QList<bool> met;
+    QStringList errMsgs;
+    qint64      start      = _p->timings.elapsed();
+    int         roundTrips = Prerequisite::metAll(_package->_prerequisites,
+                                                  met, errMsgs, _p->handler);
+    _p->timings.addItem(tr("%1 prerequisites").arg(_package->_prerequisites.size()),
+                        "prerequisite", start, 0, roundTrips);
+
+    for (int p = 0; p < _package->_prerequisites.size(); p++)
+    {
+      Prerequisite *i = _package->_prerequisites.at(p);
+      _p->handler->message(QtWarningMsg, tr("Prerequisite: %1<br/>").arg(i->name()));
+      if (! met.at(p))
+      {
+        errMsg = errMsgs.at(p);
+        allOk = false;
+        str = QString("<font size='+1' color='red'><b>Failed</b></font>");
+        if (! errMsg.isEmpty())
+         str += tr("<p>%1</p>").arg(errMsg);
+
+        QStringList strlist = i->providerList();
+        if (! strlist.isEmpty())
+        {
+          str += tr("<b>Requires:</b>");
+          str += "<ul>";
+          foreach (QString slit, strlist)
+            str += tr("<li>%1: %2</li>").arg(i->provider(slit).package(), i->provider(slit).info());
+          str += "</ul>";
+        }
+        
+        _p->handler->message(QtWarningMsg, str);
+        if (DEBUG)
+          qDebug("%s", qPrintable(str));
+      }
+    }
+  }
+
+  if (! allOk)
+  {
+    _p->handler->message(QtFatalMsg,
+                         tr("<p>One or more prerequisite checks <b>FAILED</b>. "
+                            "These prerequisites must be satisified before continuing.</p>"));
+    return false;
+  }
+
+  _p->handler->message(QtDebugMsg, tr("<p>Prerequisite Checks completed.</p>"));
+  if (delayedWarning.isEmpty())
+    _p->handler->message(QtWarningMsg,
+        tr("<h2><font color='green'>Ready to Start update!</font></h2>"));
+  else
+  {
+    _p->handler->message(QtWarningMsg, tr("<h2>Ready to Start update!</h2>"));
+    _p->handler->message(QtWarningMsg, delayedWarning);
+  }
+  _p->handler->message(QtWarningMsg,
+      tr("<p><b>NOTE</b>: Have you backed up your database? If not, you should "
+                   "backup your database now. It is good practice to backup a database "
+                   "before updating it.</p><hr/>"));
+
+  _p->timings.endPhase();
+  return true;
+}
+
+// used only in UpdateEngine::applyPackage()
+struct dbobj {
+  QString stage;
+  QString header;
+  QString footer;
+  QList<Script*>   scriptlist;
+  QList<Loadable*> loadablelist;
+
+  dbobj(QString k, QString h, QString s, QList<Script*>   l) : stage(k), header(h), footer(s), scriptlist(l)   {}
+  dbobj(QString k, QString h, QString s, QList<Loadable*> l) : stage(k), header(h), footer(s), loadablelist(l) {}
+};
+
+/* Apply the package and report where the time went, saving the timings
+   as JSON or as a trace if asked to.
+ */
+bool UpdateEngine::start()
+{
+  bool result = applyPackage();
+
+  _p->timings.endPhase();
+  _p->handler->message(QtWarningMsg, _p->timings.summary(10));
+
+  QString errMsg;
+  if (! _p->timingsFile.isEmpty() &&
+      ! _p->timings.save(_p->timingsFile, errMsg))
+    _p->handler->message(QtWarningMsg,
+                         tr("<p><font color='orange'>%1</font></p>").arg(errMsg));
+  if (! _p->traceFile.isEmpty() &&
+      ! _p->timings.saveTrace(_p->traceFile, errMsg))
+    _p->handler->message(QtWarningMsg,
+                         tr("<p><font color='orange'>%1</font></p>").arg(errMsg));
+
+  return result;
+}
+
+bool UpdateEngine::applyPackage()
+{
+  bool returnValue = false;
+
+  QString errMsg;
+  delete _p->prefetcher;
+  _p->prefetcher = 0;
+  _p->held.clear();
+
+  _p->timings.startPhase("start");
+
+  // hash the stages before the prefetcher takes over the archive
+  delete _p->journal;
+  _p->journal = 0;
+  if (_p->useJournal && (_p->alwaysRollback || _p->inTransaction))
+    _p->handler->message(QtWarningMsg,
+                         tr("<p><font color='orange'>The update journal is not "
+                            "used when the update is always rolled back or "
+                            "is part of a larger transaction.</font></p>"));
+  else if (_p->useJournal)
+  {
+    _p->journal = new UpdateJournal(_package->name());
+    foreach (QString stage, stageNames())
+      _p->journal->addStage(stage, stageMembers(stage), _files);
+    if (_p->journal->open(errMsg) < 0)
+    {
+      _p->handler->message(QtWarningMsg, errMsg);
+      delete _p->journal;
+      _p->journal = 0;
+      return false;
+    }
+    if (! _p->journal->resumable().isEmpty())
+      _p->handler->message(QtWarningMsg,
+                           tr("<p>Resuming an earlier update of this package "
+                              "after these completed stages: %1</p>")
+                           .arg(_p->journal->resumable().join(", ")));
+  }
+
+  // read members in the order they are applied below, behind the db work
+  _p->prefetcher = new PkgPrefetcher(_files, packageMembers());
+  _p->prefetcher->start();
+
+  // statements shared by all items stay prepared until applyPackage returns
+  StatementCache statements;
+
+  QDateTime startTime = QDateTime::currentDateTime();
+  QDateTime endTime = QDateTime::currentDateTime();
+
+  XSqlQuery _q;
+  _q.prepare("SELECT pkghead_version FROM pkghead WHERE pkghead_name=:name;" );
+  _q.bindValue(":name", _package->name());
+  _q.exec();
+  if (_q.first())
+  {
+    prePkgVer = _q.value("pkghead_version").toString();
+  }
+
+  _q.exec("SELECT metric_value FROM metric WHERE metric_name='ServerVersion';" );
+  if (_q.first())
+  {
+    preDbVer = _q.value("metric_value").toString();
+  }
+
+  _p->handler->message(QtWarningMsg,
+      tr("<p>Starting Update at %1</p>").arg(startTime.toString()));
+
+  _p->begin();
+
+  PkgSchema schema(_package->name(),
+                   tr("Schema to hold contents of %1").arg(_package->name()));
+  int pkgid = -1;
+  if (! _package->name().isEmpty())
+  {
+    pkgid = _package->writeToDB(errMsg);
+    if (pkgid >= 0)
+      _p->handler->message(QtWarningMsg, tr("Saving Package Header was successful."));
+    else
+    {
+      _p->handler->message(QtWarningMsg, errMsg);
+      _p->rollback();
+      _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+      return false;
+    }
+
+    if (schema.create(errMsg) >= 0 && schema.setPath(errMsg) >= 0)
+      _p->handler->message(QtWarningMsg, tr("Saving Schema for Package was successful."));
+    else
+    {
+      _p->handler->message(QtWarningMsg, errMsg);
+      _p->rollback();
+      _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+    }
+  }
+
+  int ignoredErrCnt = 0;
+  int tmpReturn     = 0;
+
+  if (_package->_initscripts.size() > 0 &&
+      ! _p->skip("initscripts", _package->_initscripts.size()))
+  {
+    _p->timings.startPhase("initscripts");
+    _p->handler->message(QtWarningMsg, tr("<h3>Applying initialization scripts...</h3>"));
+    tmpReturn = applyScripts(_package->_initscripts);
+    if (tmpReturn < 0)
+    {
+      _p->rollback();
+      _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+      return false;
+    }
+    else
+      ignoredErrCnt += tmpReturn;
+    _p->handler->message(QtWarningMsg, tr("<p>Finished initialization scripts</p>"));
+    if (ignoredErrCnt == 0 &&
+        _p->checkpoint(QStringList() << "initscripts", false) < 0)
+    {
+      _p->rollback();
+      _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+      return false;
+    }
+    if (DEBUG)
+      qDebug("UpdateEngine::applyPackage() progress %d out of %d",
+             _progress, _maximum);
+  }
+
+  _p->timings.startPhase("triggers");
+  if (_p->disableTriggers() < 0)
+  {
+    _p->rollback();
+    _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+    return false;
+  }
+
+  if (_package->_privs.size() > 0 && ! _p->skip("privs", _package->_privs.size()))
+  {
+    _p->timings.startPhase("privs");
+    _p->handler->message(QtWarningMsg, tr("<h3>Loading Privileges...</h3>"));
+    tmpReturn = applyLoadables(_package->_privs);
+    if (tmpReturn < 0) {
+      _p->rollback();
+      _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+      return false;
+    }
+    else
+      ignoredErrCnt += tmpReturn;
+    _p->handler->message(QtWarningMsg, tr("<p>Finished Privileges</p>"));
+    if (ignoredErrCnt == 0 &&
+        _p->checkpoint(QStringList() << "privs", true) < 0)
+    {
+      _p->rollback();
+      _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+      return false;
+    }
+    if (DEBUG)
+      qDebug("UpdateEngine::applyPackage() progress %d out of %d",
+             _progress, _maximum);
+  }
+
+  QList<dbobj> scriptobjs;
+  if (_p->scheduled.isEmpty())
+    scriptobjs
+      << dbobj("scripts",   tr("Applying database scripts..."),    tr("Finished database scripts"),     _package->_scripts)
+      << dbobj("functions", tr("Loading Function definitions..."), tr("Finished Function definitions"), _package->_functions)
+      << dbobj("tables",    tr("Loading Table definitions..."),    tr("Finished Table definitions"),    _package->_tables)
+      << dbobj("triggers",  tr("Loading Trigger definitions..."),  tr("Finished Trigger definitions"),  _package->_triggers)
+      << dbobj("views",     tr("Loading View definitions..."),     tr("Finished View definitions"),     _package->_views)
+      ;
+  else
+    scriptobjs
+      << dbobj("objects", tr("Loading database objects in dependency order..."),
+               tr("Finished database objects"), _p->scheduled);
+
+  QList<dbobj> loadableobjs;
+  loadableobjs
+    << dbobj("metasqls",   tr("Loading MetaSQL statements..."),   tr("Finished MetaSQL statements"),   _package->_metasqls)
+    << dbobj("reports",    tr("Loading Report definitions..."),   tr("Finished Report definitions"),   _package->_reports)
+    << dbobj("uiforms",    tr("Loading User Interface forms..."), tr("Finished User Interface forms"), _package->_appuis)
+    << dbobj("appscripts", tr("Loading Application scripts..."),  tr("Finished Application scripts"),  _package->_appscripts)
+    << dbobj("images",     tr("Loading Images..."),               tr("Finished loading Images"),       _package->_images)
+    << dbobj("qms",        tr("Loading Translations..."),         tr("Finished loading Translations"), _package->_qms)
+    ;
+
+  // everything from the scripts through the images can go in one trip
+  QStringList shippedStages;
+  if (_p->serverApply)
+  {
+    QList<QList<Script*> >   scripts;
+    QList<QList<Loadable*> > loadables;
+    QStringList              stages;
+    foreach (dbobj objdesc, scriptobjs)
+    {
+      if (! objdesc.scriptlist.isEmpty() && ! _p->done(objdesc.stage))
+      {
+        scripts.append(objdesc.scriptlist);
+        stages.append(objdesc.stage);
+      }
+    }
+    foreach (dbobj objdesc, loadableobjs)
+    {
+      if (! objdesc.loadablelist.isEmpty() && ! _p->done(objdesc.stage) &&
+          LoadableBatch::supports(objdesc.loadablelist.first()->nodename()))
+      {
+        loadables.append(objdesc.loadablelist);
+        stages.append(objdesc.stage);
+      }
+    }
+
+    bool shipped = false;
+    _p->timings.startPhase("server");
+    tmpReturn = applyOnServer(scripts, loadables, shipped);
+    if (tmpReturn < 0)
+    {
+      _p->rollback();
+      _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+      return false;
+    }
+    else
+      ignoredErrCnt += tmpReturn;
+
+    if (shipped)
+    {
+      shippedStages = stages;
+      if (ignoredErrCnt == 0 && _p->checkpoint(shippedStages, true) < 0)
+      {
+        _p->rollback();
+        _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+        return false;
+      }
+    }
+  }
+
+  foreach (dbobj objdesc, scriptobjs)
+  {
+    if (objdesc.scriptlist.size() > 0 &&
+        ! shippedStages.contains(objdesc.stage) &&
+        ! _p->skip(objdesc.stage, objdesc.scriptlist.size()))
+    {
+      _p->timings.startPhase(objdesc.stage);
+      _p->handler->message(QtWarningMsg, tr("<h3>%1</h3>").arg(objdesc.header));
+      tmpReturn = applyScripts(objdesc.scriptlist);
+      if (tmpReturn < 0) {
+        _p->rollback();
+        _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+        return false;
+      }
+      else
+        ignoredErrCnt += tmpReturn;
+      _p->handler->message(QtWarningMsg, tr("<p>%1</p>").arg(objdesc.footer));
+      if (ignoredErrCnt == 0 &&
+          _p->checkpoint(QStringList() << objdesc.stage, true) < 0)
+      {
+        _p->rollback();
+        _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+        return false;
+      }
+    }
+  }
+
+  foreach (dbobj objdesc, loadableobjs)
+  {
+    if (objdesc.loadablelist.size() > 0 &&
+        ! shippedStages.contains(objdesc.stage) &&
+        ! _p->skip(objdesc.stage, objdesc.loadablelist.size()))
+    {
+      _p->timings.startPhase(objdesc.stage);
+      _p->handler->message(QtWarningMsg, tr("<h3>%1</h3>").arg(objdesc.header));
+      tmpReturn = applyLoadables(objdesc.loadablelist);
+      if (tmpReturn < 0) {
+        _p->rollback();
+        _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+        return false;
+      }
+      else
+        ignoredErrCnt += tmpReturn;
+      _p->handler->message(QtWarningMsg, tr("<p>%1</p>").arg(objdesc.footer));
+      if (ignoredErrCnt == 0 &&
+          _p->checkpoint(QStringList() << objdesc.stage, true) < 0)
+      {
+        _p->rollback();
+        _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+        return false;
+      }
+    }
+    if (DEBUG)
+      qDebug("UpdateEngine::applyPackage() progress %d out of %d", _progress, _maximum);
+  }
+
+  if (_package->_cmds.size() > 0 && ! _p->skip("cmds", _package->_cmds.size()))
+  {
+    _p->timings.startPhase("cmds");
+    _p->handler->message(QtWarningMsg, tr("<h3>Loading Custom Commands...</h3>"));
+    tmpReturn = applyLoadables(_package->_cmds);
+    if (tmpReturn < 0) {
+      _p->rollback();
+      _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+      return false;
+    }
+    else
+      ignoredErrCnt += tmpReturn;
+    XSqlQuery qry("SELECT updateCustomPrivs();");
+    _p->handler->message(QtWarningMsg, tr("<p>Finished Custom Commands</p>"));
+    if (ignoredErrCnt == 0 &&
+        _p->checkpoint(QStringList() << "cmds", true) < 0)
+    {
+      _p->rollback();
+      _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+      return false;
+    }
+    if (DEBUG)
+      qDebug("UpdateEngine::applyPackage() progress %d out of %d",
+             _progress, _maximum);
+  }
+
+  if (_package->_prerequisites.size() > 0)
+  {
+    _p->timings.startPhase("dependencies");
+    _p->handler->message(QtWarningMsg, tr("<h3>Loading Package Dependencies...</h3>"));
+    foreach (Prerequisite *i, _package->_prerequisites)
+    {
+      if (i->type() == Prerequisite::Dependency)
+      {
+        _p->handler->message(QtDebugMsg, tr("applying dependency %1<br/>").arg(i->name()));
+        if (i->writeToDB(_package->name(), errMsg) < 0)
+        {
+          _p->handler->message(QtWarningMsg, errMsg);
+          _p->rollback();
+          _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+          return false;
+        }
+      }
+      setProgress(_progress + 1);
+    }
+    _p->handler->message(QtWarningMsg, tr("<p>Completed updating dependencies.</p>"));
+    if (DEBUG)
+      qDebug("UpdateEngine::applyPackage() progress %d out of %d",
+             _progress, _maximum);
+  }
+
+  _p->timings.startPhase("triggers");
+  if (_p->enableTriggers() < 0)
+  {
+    _p->rollback();
+    _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+    return false;
+  }
+
+  if (_package->_finalscripts.size() > 0)
+  {
+    _p->timings.startPhase("finalscripts");
+    _p->handler->message(QtWarningMsg, tr("<h3>Applying final cleanup scripts...</h3>"));
+    tmpReturn = applyScripts(_package->_finalscripts);
+    if (tmpReturn < 0)
+      return false;
+    else
+      ignoredErrCnt += tmpReturn;
+    _p->handler->message(QtWarningMsg, tr("<p>Finished final cleanup</p>"));
+    if (DEBUG)
+      qDebug("UpdateEngine::applyPackage() progress %d out of %d",
+             _progress, _maximum);
+  }
+
+  // the reader scanned the rest of the package while we worked
+  _p->timings.startPhase("finish");
+  if (! _p->prefetcher->finish(errMsg))
+  {
+    _p->handler->message(QtWarningMsg, errMsg);
+    _p->rollback();
+    _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+    return false;
+  }
+  delete _p->prefetcher;
+  _p->prefetcher = 0;
+
+  setProgress(_progress + 1);
+
+  if (_p->alwaysRollback)
+  {
+    _p->rollback();
+    _p->handler->message(QtWarningMsg, tr("<h2>The Update has been rolled back as requested.</h2>"));
+    returnValue = true;
+  }
+  else if (ignoredErrCnt > 0 &&
+           _p->handler->question(tr("<h2>One or more errors were ignored while "
+                                    "processing this Package. Are you sure you "
+                                    "want to commit these changes?</h2><p>If you "
+                                    "answer 'No' then this import will be rolled "
+                                    "back.</p>"),
+                              QMessageBox::Yes | QMessageBox::No,
+                              QMessageBox::No) == QMessageBox::Yes)
+  {
+    _p->finishJournal();
+    _p->commit();
+    _p->handler->message(QtWarningMsg,
+        tr("<h2>The Update is now complete but errors were ignored!</h2>"));
+
+    endTime = QDateTime::currentDateTime();
+    _p->handler->message(QtWarningMsg,
+        tr("<p>Completed Update at %1</p>").arg(endTime.toString()));
+    _p->handler->message(QtWarningMsg, _p->elapsedTime(startTime, endTime));
+    setProgress(_maximum);
+    returnValue = true;
+  }
+  else if (ignoredErrCnt > 0)
+  {
+    _p->rollback();
+    _p->handler->message(QtWarningMsg, _p->rollbackMsg());
+    returnValue = false;
+  }
+  else
+  {
+    _p->finishJournal();
+    _p->commit();
+    _p->handler->message(QtWarningMsg, tr("<h2>The Update is now complete!</h2>"));
+
+    endTime = QDateTime::currentDateTime();
+    _p->handler->message(QtWarningMsg,
+        tr("<p>Completed Update at %1</p>").arg(endTime.toString()));
+    _p->handler->message(QtWarningMsg, _p->elapsedTime(startTime, endTime));
+    setProgress(_maximum);
+    returnValue = true;
+  }
+
+  if (DEBUG)
+    qDebug("UpdateEngine::applyPackage() progress %d out of %d after commit",
+           _progress, _maximum);
+
+  if (! _package->system() && schema.clearPath(errMsg) < 0)
+  {
+    _p->handler->message(QtWarningMsg,
+        tr("<p><font color='orange'>The update completed "
+                     "successfully but there was an error resetting "
+                     "the schema path:</font></p><pre>%1</pre>"
+                     "<p>Quit the updater and start it "
+                     "again if you want to apply another update.</p>"));
+
+  }
+
+  if (returnValue)
+    logUpdate(startTime, endTime);
+  return returnValue;
+}
+
+bool UpdateEngine::alwaysRollback() const
+{
+  return _p->alwaysRollback;
+}
+
+void UpdateEngine::setAlwaysRollback(bool p)
+{
+  _p->alwaysRollback = p;
+}
+
+/* the caller has begun a transaction and will commit or roll it back, so
+   the package is applied inside a savepoint instead of its own transaction
+ */
+void UpdateEngine::setInTransaction(bool p)
+{
+  _p->inTransaction = p;
+}
+
+void UpdateEngine::setJournal(bool p)
+{
+  _p->useJournal = p;
+}
+
+void UpdateEngine::setTimingsFile(const QString &filename)
+{
+  _p->timingsFile = filename;
+}
+
+void UpdateEngine::setTraceFile(const QString &filename)
+{
+  _p->traceFile = filename;
+}
+
+void UpdateEngine::setRewrite(bool p)
+{
+  _p->rewrite = p;
+}
+
+void UpdateEngine::setSchedule(bool p)
+{
+  _p->schedule = p;
+}
+
+void UpdateEngine::setServerApply(bool p)
+{
+  _p->serverApply = p;
+}
+
+void UpdateEngine::setUseCache(bool p)
+{
+  _p->useCache = p;
+}
+
+/* Work out the order of the scripts, functions, tables, triggers and views
+   from what each creates and uses, before any transaction starts. If it
+   differs from the usual order by kind, applyPackage() applies them in this one.
+   A cycle is reported and the usual order kept.
+   open() runs this only if setSchedule() asked for it, since it reads every
+   sql member up front. Each is parsed and dropped; applyPackage() reads it
+   again when it applies it.
+ */
+bool UpdateEngine::scheduleScripts()
+{
+  _p->scheduled.clear();
+
+  DbObjScheduler scheduler;
+  QString        errMsg;
+  foreach (Script *i, _package->_scripts + _package->_functions +
+                      _package->_tables  + _package->_triggers  +
+                      _package->_views)
+  {
+    QByteArray data;
+    if (! readMember(_p->prefix + i->filename(), data, errMsg))
+    {
+      _p->handler->message(QtFatalMsg, errMsg);
+      return false;
+    }
+    scheduler.add(i, data);
+  }
+
+  if (! scheduler.schedule(errMsg))
+    _p->handler->message(QtWarningMsg,
+                         tr("<p><font color='orange'>%1. They will be "
+                            "applied in the usual order.</font></p>")
+                         .arg(errMsg));
+  else if (scheduler.reordered())
+  {
+    _p->scheduled = scheduler.order();
+    _p->handler->message(QtDebugMsg,
+                         tr("<p>%1 database objects will be applied in "
+                            "dependency order.</p>").arg(scheduler.size()));
+  }
+
+  return true;
+}
+
+/* the package members in the order applyPackage() applies them, leaving out the
+   stages an earlier journaled run already committed
+ */
+QStringList UpdateEngine::packageMembers() const
+{
+  QStringList members;
+  foreach (QString stage, stageNames())
+    if (! _p->done(stage))
+      members += stageMembers(stage);
+
+  return members;
+}
+
+// the stages of applyPackage() that have something to apply, in order
+QStringList UpdateEngine::stageNames() const
+{
+  QStringList candidates;
+  candidates << "initscripts" << "privs";
+  if (_p->scheduled.isEmpty())
+    candidates << "scripts" << "functions" << "tables" << "triggers" << "views";
+  else
+    candidates << "objects";
+  candidates << "metasqls" << "reports" << "uiforms" << "appscripts"
+             << "images"   << "qms"     << "cmds"    << "finalscripts";
+
+  QStringList stages;
+  foreach (QString stage, candidates)
+  {
+    QList<Script*>   scripts;
+    QList<Loadable*> loadables;
+    stageItems(stage, scripts, loadables);
+    if (! scripts.isEmpty() || ! loadables.isEmpty())
+      stages.append(stage);
+  }
+
+  return stages;
+}
+
+void UpdateEngine::stageItems(const QString &stage, QList<Script*> &scripts,
+                              QList<Loadable*> &loadables) const
+{
+  if (stage == "initscripts")       scripts   = _package->_initscripts;
+  else if (stage == "privs")        loadables = _package->_privs;
+  else if (stage == "objects")      scripts   = _p->scheduled;
+  else if (stage == "scripts")      scripts   = _package->_scripts;
+  else if (stage == "functions")    scripts   = _package->_functions;
+  else if (stage == "tables")       scripts   = _package->_tables;
+  else if (stage == "triggers")     scripts   = _package->_triggers;
+  else if (stage == "views")        scripts   = _package->_views;
+  else if (stage == "metasqls")     loadables = _package->_metasqls;
+  else if (stage == "reports")      loadables = _package->_reports;
+  else if (stage == "uiforms")      loadables = _package->_appuis;
+  else if (stage == "appscripts")   loadables = _package->_appscripts;
+  else if (stage == "images")       loadables = _package->_images;
+  else if (stage == "qms")          loadables = _package->_qms;
+  else if (stage == "cmds")         loadables = _package->_cmds;
+  else if (stage == "finalscripts") scripts   = _package->_finalscripts;
+}
+
+/* the package members a stage reads. Items package.xml describes on its own,
+   like privileges and custom commands, have none.
+ */
+QStringList UpdateEngine::stageMembers(const QString &stage) const
+{
+  QList<Script*>   scripts;
+  QList<Loadable*> loadables;
+  stageItems(stage, scripts, loadables);
+
+  QStringList members;
+  foreach (Script *i, scripts)
+    members.append(_p->prefix + i->filename());
+  foreach (Loadable *i, loadables)
+    if (i->hasFile())
+      members.append(_p->prefix + i->filename());
+
+  return members;
+}
+
+/* Materialize a package member only when it is about to be applied; callers
+   drop it once it has been. During applyPackage() the prefetcher owns the archive.
+   Members applyOnServer() read but handed back are handed out first, one
+   copy per read since several items may share a file.
+ */
+bool UpdateEngine::readMember(const QString &name, QByteArray &data, QString &errMsg)
+{
+  if (_p->held.contains(name))
+  {
+    data = _p->held.take(name);
+    return true;
+  }
+
+  qint64 start = _p->timings.elapsed();
+  bool   result;
+  if (_p->prefetcher)
+    result = _p->prefetcher->take(name, data, errMsg);
+  else
+  {
+    data   = _files->data(name);
+    result = _files->isValid();
+    if (! result)
+      errMsg = _files->errorString();
+  }
+  _p->timings.addRead(start, data.size());
+  _p->timings.addSpan(tr("read %1").arg(name), "read", start);
+  return result;
+}
+
+// the content of item, empty if package.xml describes it on its own
+bool UpdateEngine::readMember(Loadable *item, QByteArray &data, QString &errMsg)
+{
+  if (! item->hasFile())
+  {
+    data.clear();
+    return true;
+  }
+  return readMember(_p->prefix + item->filename(), data, errMsg);
+}
+
+int UpdateEngine::applySql(Script *pscript)
+{
+  if (DEBUG)
+    qDebug("UpdateEngine::applySql() - running script %s in file %s",
+           qPrintable(pscript->name()), qPrintable(pscript->filename()));
+
+  QByteArray psql;
+  QString    errMsg;
+  if (! readMember(_p->prefix + pscript->filename(), psql, errMsg))
+  {
+    _p->handler->message(QtWarningMsg, errMsg);
+    return -1;
+  }
+
+  return applySql(pscript, psql);
+}
+
+int UpdateEngine::applySql(Script *pscript, const QByteArray &psql)
+{
+  XSqlQuery qry;
+  bool again     = false;
+  int  returnVal = 0;
+  do {
+    QString message;
+    qint64  start = _p->timings.elapsed();
+    int     mark  = _p->timings.mark();
+    qry.exec("SAVEPOINT updaterFile;");
+    if (pscript->onError() == Script::Default)
+      pscript->setOnError(Script::Stop);
+
+    ParameterList params;
+    QByteArray sql(psql);       // shallow, so a retry starts from psql again
+    int scriptreturn = pscript->writeToDB(sql, _package->name(), params, message);
+    _p->timings.addItem(pscript->filename(), "script", start, psql.size(), 3);
+    if (scriptreturn == -1)
+    {
+      _p->unverified.insert(pscript);
+      _p->handler->message(QtWarningMsg,
+          tr("<font color='%1'>%2</font><br>")
+                    .arg("orange")
+                    .arg(message));
+    }
+    else if (scriptreturn < 0)
+    {
+      bool fatal = ! (pscript->onError() == Script::Ignore);
+      _p->handler->message(QtWarningMsg,
+          tr("<p><font color='%1'>%2</font><br>")
+                    .arg(fatal ? "red" : "orange")
+                    .arg(message));
+      qry.exec("ROLLBACK TO updaterFile;");
+      _p->timings.discardItems(mark);
+
+      switch (pscript->onError())
+      {
+        case Script::Stop:
+          if (DEBUG)
+            qDebug("UpdateEngine::applySql() taking Script::Stop branch");
+          _p->rollback();
+          _p->handler->message(QtWarningMsg, _rollbackMsg);
+          return scriptreturn;
+          break;
+
+        case Script::Ignore:
+          if (DEBUG)
+            qDebug("UpdateEngine::applySql() taking Script::Ignore branch");
+          _p->handler->message(QtWarningMsg,
+              tr("<font color='orange'><b>IGNORING</b> the above "
+                           "errors and skipping script %1.</font><br>")
+                          .arg(pscript->filename()));
+          _p->unverified.insert(pscript);
+          returnVal++;
+          break;
+
+        case Script::Prompt:
+          if (DEBUG)
+            qDebug("UpdateEngine::applySql() taking Script::Prompt branch");
+        default:
+          if (DEBUG)
+            qDebug("UpdateEngine::applySql() taking default branch");
+          switch(_p->handler->question(
+                tr("<pre>%1.</pre><p>Please select the action "
+                   "that you would like to take.").arg(message),
+                QMessageBox::Retry|QMessageBox::Ignore|QMessageBox::Abort,
+                QMessageBox::Retry))
+          {
+            case QMessageBox::Retry:
+              _p->handler->message(QtWarningMsg, tr("RETRYING..."));
+              again = true;
+              break;
+            case QMessageBox::Ignore:
+              _p->handler->message(QtWarningMsg,
+                  tr("<font color='orange'><b>IGNORING</b> the "
+                               "above errors at user request and "
+                               "skipping script %1.</font><br>")
+                              .arg(pscript->filename()) );
+              again = false;
+              _p->unverified.insert(pscript);
+              returnVal++;
+              break;
+            case QMessageBox::Abort:
+            default:
+              _p->rollback();
+              _p->handler->message(QtWarningMsg, _rollbackMsg);
+              return scriptreturn;
+              break;
+          }
+      }
+    }
+    else
+      _p->handler->message(QtWarningMsg,
+          tr("Import of %1 was successful.").arg(pscript->filename()));
+  } while (again);
+
+  qry.exec("RELEASE SAVEPOINT updaterFile;");
+
+  setProgress(_progress + 1);
+
+  return returnVal;
+}
+
+// similar to applySql but Loadable::writeDoDB() returning -1 is a real error
+int UpdateEngine::applyLoadable(Loadable *pscript)
+{
+  if (DEBUG)
+    qDebug("UpdateEngine::applyLoadable(%s in %s)",
+           qPrintable(pscript->name()), qPrintable(pscript->filename()));
+
+  QByteArray psql;
+  QString    errMsg;
+  if (! readMember(_p->prefix + pscript->filename(), psql, errMsg))
+  {
+    _p->handler->message(QtWarningMsg, errMsg);
+    return -1;
+  }
+
+  return applyLoadable(pscript, psql);
+}
+
+int UpdateEngine::applyLoadable(Loadable *pscript, const QByteArray &psql)
+{
+  XSqlQuery qry;
+  bool again     = false;
+  int  returnVal = 0;
+  do {
+    QString message;
+    qint64  start = _p->timings.elapsed();
+    int     mark  = _p->timings.mark();
+
+    qry.exec("SAVEPOINT updaterFile;");
+    if (pscript->onError() == Script::Default)
+      pscript->setOnError(Script::Stop);
+
+    QByteArray sql(psql);
+    int scriptreturn = pscript->writeToDB(sql, _package->name(), message);
+    _p->timings.addItem(pscript->filename(), pscript->nodename(), start,
+                        psql.size(), 3);
+    if (scriptreturn < 0)
+    {
+      bool fatal = ! (pscript->onError() == Script::Ignore);
+      _p->handler->message(QtWarningMsg,
+          tr("<br><font color='%1'>%2</font><br>")
+                    .arg(fatal ? "red" : "orange")
+                    .arg(message));
+      qry.exec("ROLLBACK TO updaterFile;");
+      _p->timings.discardItems(mark);
+
+      switch (pscript->onError())
+      {
+        case Script::Stop:
+          if (DEBUG)
+            qDebug("UpdateEngine::applyLoadable() taking Script::Stop branch");
+          _p->rollback();
+          _p->handler->message(QtWarningMsg, _rollbackMsg);
+          return scriptreturn;
+          break;
+
+        case Script::Ignore:
+          if (DEBUG)
+            qDebug("UpdateEngine::applyLoadable() taking Script::Ignore branch");
+          _p->handler->message(QtWarningMsg,
+              tr("<font color='orange'><b>IGNORING</b> the above "
+                           "errors and skipping script %1.</font><br>")
+                          .arg(pscript->filename()));
+          returnVal++;
+          break;
+
+        case Script::Prompt:
+          if (DEBUG)
+            qDebug("UpdateEngine::applyLoadable() taking Script::Prompt branch");
+        default:
+          if (DEBUG)
+            qDebug("UpdateEngine::applyLoadable() taking default branch");
+          switch(_p->handler->question(
+                tr("<pre>%1.</pre><p>Please select the action "
+                   "that you would like to take.").arg(message),
+                QMessageBox::Retry|QMessageBox::Ignore|QMessageBox::Abort,
+                QMessageBox::Retry))
+          {
+            case QMessageBox::Retry:
+              _p->handler->message(QtWarningMsg, tr("RETRYING..."));
+              again = true;
+              break;
+            case QMessageBox::Ignore:
+              _p->handler->message(QtWarningMsg,
+                  tr("<font color='orange'><b>IGNORING</b> the "
+                               "above errors at user request and "
+                               "skipping script %1.</font><br>")
+                              .arg(pscript->filename()) );
+              again = false;
+              returnVal++;
+              break;
+            case QMessageBox::Abort:
+            default:
+              _p->rollback();
+              _p->handler->message(QtWarningMsg, _rollbackMsg);
+              return scriptreturn;
+              break;
+          }
+      }
+    }
+    else
+      _p->handler->message(QtWarningMsg,
+          tr("Import of %1 was successful.").arg(pscript->filename()));
+  } while (again);
+
+  qry.exec("RELEASE SAVEPOINT updaterFile;");
+
+  setProgress(_progress + 1);
+
+  return returnVal;
+}
+
+/* Load a list of Loadables of one kind. Kinds LoadableBatch supports are
+   written a batch at a time; items that cannot be prepared go through
+   applyLoadable() and the items of a batch that fails through applyGroup(),
+   so errors are reported and handled exactly as they would be without
+   batching. Other kinds are applied in groups.
+   Returns the number of errors ignored or a negative value on failure.
+ */
+int UpdateEngine::applyLoadables(const QList<Loadable*> &list)
+{
+  int ignored   = 0;
+  int tmpReturn = 0;
+
+  if (list.isEmpty())
+    return 0;
+
+  if (! LoadableBatch::supports(list.first()->nodename()))
+  {
+    QList<LoaderItem> group;
+    qint64            bytes = 0;
+    foreach (Loadable *i, list)
+    {
+      _p->handler->message(QtDebugMsg, tr("applying %1<br/>").arg(i->filename()));
+
+      QByteArray data;
+      QString    errMsg;
+      if (! readMember(i, data, errMsg))
+      {
+        _p->handler->message(QtWarningMsg, errMsg);
+        return -1;
+      }
+      group.append(LoaderItem(i, data));
+      bytes += data.size();
+
+      if (group.size() >= _p->groupSize || bytes >= MAXGROUPBYTES)
+      {
+        tmpReturn = applyGroup(group);
+        if (tmpReturn < 0)
+          return tmpReturn;
+        ignored += tmpReturn;
+        group.clear();
+        bytes = 0;
+      }
+    }
+
+    tmpReturn = applyGroup(group);
+    if (tmpReturn < 0)
+      return tmpReturn;
+    return ignored + tmpReturn;
+  }
+
+  LoadableBatch     batch(list.first()->nodename());
+  QList<QByteArray> pending;    // member data of the batched items
+  batch.setIncremental(! _p->rewrite);
+  foreach (Loadable *i, list)
+  {
+    _p->handler->message(QtDebugMsg, tr("applying %1<br/>").arg(i->filename()));
+
+    QByteArray data;
+    QString    errMsg;
+    if (! readMember(i, data, errMsg))
+    {
+      _p->handler->message(QtWarningMsg, errMsg);
+      return -1;
+    }
+
+    int result = -1;
+    if (i->nodename() == batch.nodename())
+    {
+      if (i->onError() == Script::Default)
+        i->setOnError(Script::Stop);
+
+      QByteArray copy(data);
+      i->setBatch(&batch);
+      result = i->writeToDB(copy, _package->name(), errMsg);
+      i->setBatch(0);
+    }
+
+    if (result >= 0)
+      pending.append(data);
+    else
+    {
+      tmpReturn = applyLoadable(i, data);
+      if (tmpReturn < 0)
+        return tmpReturn;
+      ignored += tmpReturn;
+    }
+
+    if (batch.size() >= 500 || batch.bytes() >= 32 * 1024 * 1024)
+    {
+      tmpReturn = applyBatch(batch, pending);
+      if (tmpReturn < 0)
+        return tmpReturn;
+      ignored += tmpReturn;
+    }
+  }
+
+  tmpReturn = applyBatch(batch, pending);
+  if (tmpReturn < 0)
+    return tmpReturn;
+
+  _p->handler->message(QtWarningMsg,
+                       tr("<p>%1 unchanged, %2 updated, %3 inserted</p>")
+                       .arg(batch.unchanged()).arg(batch.updated())
+                       .arg(batch.inserted()));
+
+  return ignored + tmpReturn;
+}
+
+/* Write a batch prepared by applyLoadables() and empty it. data holds the
+   package member of each item in the batch, in order, in case the items
+   have to be loaded again to find the one that failed.
+ */
+int UpdateEngine::applyBatch(LoadableBatch &batch, QList<QByteArray> &data)
+{
+  if (batch.size() == 0)
+    return 0;
+
+  QList<Loadable*> items = batch.items();
+  QString   errMsg;
+  XSqlQuery qry;
+
+  qint64 start = _p->timings.elapsed();
+  qint64 bytes = batch.bytes();
+  int    mark  = _p->timings.mark();
+  qry.exec("SAVEPOINT updaterBatch;");
+  int result = batch.writeToDB(errMsg);
+  _p->timings.addItem(tr("a batch of %1 %2 items").arg(items.size())
+                        .arg(batch.nodename()),
+                      "batch", start, bytes, 3);
+  batch.clear();
+
+  if (result >= 0)
+  {
+    qry.exec("RELEASE SAVEPOINT updaterBatch;");
+    foreach (Loadable *i, items)
+      _p->handler->message(QtWarningMsg,
+          tr("Import of %1 was successful.").arg(i->filename()));
+    setProgress(_progress + items.size());
+    data.clear();
+    return 0;
+  }
+
+  if (DEBUG)
+    qDebug("UpdateEngine::applyBatch() batch of %d failed: %s",
+           items.size(), qPrintable(errMsg));
+  qry.exec("ROLLBACK TO updaterBatch;");
+  qry.exec("RELEASE SAVEPOINT updaterBatch;");
+  _p->timings.discardItems(mark);
+  _p->handler->message(QtDebugMsg,
+                       tr("Loading %1 items again to find the error<br/>")
+                       .arg(items.size()));
+
+  QList<LoaderItem> group;
+  for (int i = 0; i < items.size(); i++)
+    group.append(LoaderItem(items.at(i), data.at(i)));
+  data.clear();
+
+  return applyGroup(group);
+}
+
+/* true if script creates a database object that can be checked for after
+   the rest of its stage has run. A missing object stops the update either
+   way unless the script may be ignored or retried, and those choices only
+   make sense right after the script itself, so such objects check for
+   themselves as they always have.
+ */
+static bool verifiedLater(Script *script)
+{
+  return dynamic_cast<CreateDBObj*>(script) &&
+         (script->onError() == Script::Default ||
+          script->onError() == Script::Stop);
+}
+
+/* Apply several stages of scripts and batchable loadables with a single
+   ServerApply round trip. applied says whether that happened; if the
+   items cannot all be prepared, or one of them fails on the server, the
+   work is rolled back and the caller applies them from here as usual so
+   errors are reported and handled the same way. The members read so far
+   are held for that so the prefetcher is not asked for them twice.
+   Database objects that must be checked right after their own script, see
+   verifiedLater(), keep the items on the client.
+   Returns the number of errors ignored or a negative value on failure.
+ */
+int UpdateEngine::applyOnServer(const QList<QList<Script*> > &scripts,
+                                const QList<QList<Loadable*> > &loadables,
+                                bool &applied)
+{
+  applied = false;
+
+  ServerApply         server;
+  QList<CreateDBObj*> dbobjs;
+  CatalogSnapshot     snapshot;
+  QStringList         messages;
+  QStringList         names;          // of the members read
+  QString             errMsg;
+  int                 count = 0;
+
+  foreach (QList<Script*> list, scripts)
+  {
+    foreach (Script *i, list)
+    {
+      if (dynamic_cast<CreateDBObj*>(i) && ! verifiedLater(i))
+      {
+        _p->handler->message(QtDebugMsg,
+                             tr("%1 cannot be applied on the server<br/>")
+                             .arg(i->filename()));
+        return 0;
+      }
+    }
+  }
+
+  _p->unverified.clear();
+  foreach (QList<Script*> list, scripts)
+  {
+    foreach (Script *i, list)
+    {
+      QByteArray data;
+      if (! readMember(_p->prefix + i->filename(), data, errMsg))
+      {
+        _p->handler->message(QtWarningMsg, errMsg);
+        return -1;
+      }
+      names.append(_p->prefix + i->filename());
+      _p->held.insert(names.last(), data);
+
+      if (server.addScript(i, data, errMsg) < 0)   // a warning, as in applySql()
+      {
+        _p->unverified.insert(i);
+        messages.append(tr("<font color='%1'>%2</font><br>")
+                          .arg("orange").arg(errMsg));
+      }
+      else
+        messages.append(tr("Import of %1 was successful.").arg(i->filename()));
+
+      CreateDBObj *obj = dynamic_cast<CreateDBObj*>(i);
+      if (obj)
+      {
+        dbobjs.append(obj);
+        snapshot.add(obj->name());
+      }
+      count++;
+    }
+  }
+
+  foreach (QList<Loadable*> list, loadables)
+  {
+    if (list.isEmpty())
+      continue;
+
+    LoadableBatch batch(list.first()->nodename());
+    batch.setIncremental(! _p->rewrite);
+    foreach (Loadable *i, list)
+    {
+      QByteArray data;
+      if (! readMember(i, data, errMsg))
+      {
+        _p->handler->message(QtWarningMsg, errMsg);
+        return -1;
+      }
+      if (i->hasFile())
+      {
+        names.append(_p->prefix + i->filename());
+        _p->held.insert(names.last(), data);
+      }
+
+      if (i->onError() == Script::Default)
+        i->setOnError(Script::Stop);
+
+      i->setBatch(&batch);
+      int result = i->writeToDB(data, _package->name(), errMsg);
+      i->setBatch(0);
+      if (result < 0)
+      {
+        _p->handler->message(QtDebugMsg,
+                             tr("%1 cannot be applied on the server<br/>")
+                             .arg(i->filename()));
+        return 0;
+      }
+      messages.append(tr("Import of %1 was successful.").arg(i->filename()));
+      count++;
+
+      if (batch.size() >= 500 || batch.bytes() >= 32 * 1024 * 1024)
+      {
+        if (server.addBatch(batch, errMsg) < 0)
+          return 0;
+        batch.clear();
+      }
+    }
+    if (server.addBatch(batch, errMsg) < 0)
+      return 0;
+  }
+
+  if (server.size() == 0)
+    return 0;
+
+  _p->handler->message(QtWarningMsg,
+                       tr("<h3>Applying %1 items on the server...</h3>")
+                       .arg(count));
+
+  XSqlQuery qry;
+  qint64    start = _p->timings.elapsed();
+  int       mark  = _p->timings.mark();
+  qry.exec("SAVEPOINT updaterServer;");
+  int result = server.run(errMsg);
+  _p->timings.addItem(tr("%1 items applied on the server").arg(count),
+                      "server", start, server.bytes(), 4);
+  if (result < 0)
+  {
+    qry.exec("ROLLBACK TO updaterServer;");
+    qry.exec("RELEASE SAVEPOINT updaterServer;");
+    _p->timings.discardItems(mark);
+    _p->handler->message(QtDebugMsg, errMsg);
+    _p->handler->message(QtWarningMsg,
+                         tr("<p>Could not apply the items on the server; "
+                            "applying them one group at a time</p>"));
+    _p->unverified.clear();
+    return 0;
+  }
+  qry.exec("RELEASE SAVEPOINT updaterServer;");
+  applied = true;
+  foreach (QString name, names)
+    _p->held.remove(name);
+
+  foreach (QString message, messages)
+    _p->handler->message(QtWarningMsg, message);
+  setProgress(_progress + count);
+
+  int tmpReturn = verifyObjects(dbobjs, snapshot);
+  if (tmpReturn >= 0)
+    _p->handler->message(QtWarningMsg,
+                         tr("<p>Finished applying items on the server</p>"));
+
+  return tmpReturn;
+}
+
+/* Apply a list of Scripts in groups; see applyGroup().
+   Database objects that stop the update if they are missing are checked
+   against one CatalogSnapshot taken after the whole list rather than
+   queried for one at a time; the rest check for themselves, see
+   verifiedLater().
+   Returns the number of errors ignored or a negative value on failure.
+ */
+int UpdateEngine::applyScripts(const QList<Script*> &list)
+{
+  int     ignored   = 0;
+  int     tmpReturn = 0;
+  QString errMsg;
+
+  // without a snapshot an object checks for itself after its script
+  QList<CreateDBObj*> dbobjs;
+  CatalogSnapshot     snapshot;
+  foreach (Script *i, list)
+  {
+    if (verifiedLater(i))
+    {
+      CreateDBObj *obj = dynamic_cast<CreateDBObj*>(i);
+      obj->setSnapshot(&snapshot);
+      dbobjs.append(obj);
+      snapshot.add(obj->name());
+    }
+  }
+  _p->unverified.clear();
+
+  QList<LoaderItem> group;
+  qint64            bytes = 0;
+  foreach (Script *i, list)
+  {
+    _p->handler->message(QtDebugMsg, tr("applying %1<br/>").arg(i->filename()));
+
+    QByteArray data;
+    if (! readMember(_p->prefix + i->filename(), data, errMsg))
+    {
+      _p->handler->message(QtWarningMsg, errMsg);
+      tmpReturn = -1;
+      break;
+    }
+    group.append(LoaderItem(i, data));
+    bytes += data.size();
+
+    if (group.size() >= _p->groupSize || bytes >= MAXGROUPBYTES)
+    {
+      tmpReturn = applyGroup(group);
+      if (tmpReturn < 0)
+        break;
+      ignored += tmpReturn;
+      group.clear();
+      bytes = 0;
+    }
+  }
+
+  if (tmpReturn >= 0)
+  {
+    tmpReturn = applyGroup(group);
+    if (tmpReturn >= 0)
+    {
+      ignored  += tmpReturn;
+      tmpReturn = verifyObjects(dbobjs, snapshot);
+    }
+  }
+
+  foreach (CreateDBObj *obj, dbobjs)
+    obj->setSnapshot(0);
+
+  if (tmpReturn < 0)
+    return tmpReturn;
+
+  return ignored + tmpReturn;
+}
+
+/* Check that each database object in the list was created, using one
+   query for all of them. A missing object is handled according to its
+   OnError like any other failure. The callers only pass objects for which
+   that means stopping the update, since the rest of the stage has already
+   run and the script can be neither retried nor rolled back on its own.
+   Returns the number of errors ignored or a negative value on failure.
+ */
+int UpdateEngine::verifyObjects(const QList<CreateDBObj*> &list,
+                                CatalogSnapshot &snapshot)
+{
+  if (list.isEmpty())
+    return 0;
+
+  QString   errMsg;
+  qint64    start = _p->timings.elapsed();
+  bool      refreshed = snapshot.refresh(errMsg);
+  _p->timings.addItem(tr("catalog check of %1 objects").arg(list.size()),
+                      "catalog", start, 0, 1);
+  if (! refreshed)
+  {
+    _p->handler->message(QtWarningMsg,
+                         tr("<p><font color='red'>%1</font><br>").arg(errMsg));
+    _p->rollback();
+    _p->handler->message(QtWarningMsg, _rollbackMsg);
+    return -7;
+  }
+
+  int ignored = 0;
+  foreach (CreateDBObj *obj, list)
+  {
+    if (_p->unverified.contains(obj))
+      continue;
+
+    QString message;
+    int     result = obj->verify(snapshot, _package->name(), message);
+    if (result >= 0)
+      continue;
+
+    bool fatal = ! (obj->onError() == Script::Ignore);
+    _p->handler->message(QtWarningMsg,
+        tr("<p><font color='%1'>%2</font><br>")
+                  .arg(fatal ? "red" : "orange")
+                  .arg(message));
+
+    switch (obj->onError())
+    {
+      case Script::Ignore:
+        _p->handler->message(QtWarningMsg,
+            tr("<font color='orange'><b>IGNORING</b> the above "
+                         "errors and skipping script %1.</font><br>")
+                        .arg(obj->filename()));
+        ignored++;
+        break;
+
+      case Script::Prompt:
+        if (_p->handler->question(
+              tr("<pre>%1.</pre><p>Please select the action "
+                 "that you would like to take.").arg(message),
+              QMessageBox::Ignore|QMessageBox::Abort,
+              QMessageBox::Abort) == QMessageBox::Ignore)
+        {
+          _p->handler->message(QtWarningMsg,
+              tr("<font color='orange'><b>IGNORING</b> the "
+                           "above errors at user request and "
+                           "skipping script %1.</font><br>")
+                          .arg(obj->filename()) );
+          ignored++;
+          break;
+        }
+        // fall through
+      case Script::Stop:
+      default:
+        _p->rollback();
+        _p->handler->message(QtWarningMsg, _rollbackMsg);
+        return result;
+    }
+  }
+
+  return ignored;
+}
+
+/* Apply several items under a single savepoint instead of one each.
+   Nothing is reported until the whole group has been applied.
+
+   If an item fails the group is rolled back. The items before it are
+   applied again as a group, the failing item on its own through applySql()
+   or applyLoadable() so its OnError policy is honoured, and then the items
+   after it. If the failure cannot be pinned on one item the group is
+   bisected instead. Groups grow while they succeed and shrink when they
+   fail, down to one item at a time for packages with many failures.
+ */
+int UpdateEngine::applyGroup(QList<LoaderItem> &group)
+{
+  if (group.isEmpty())
+    return 0;
+  if (group.size() == 1)
+    return applyItem(group.first());
+
+  XSqlQuery   qry;
+  QStringList messages;
+  int         failed = -1;
+
+  qint64 groupStart = _p->timings.elapsed();
+  int    mark       = _p->timings.mark();
+  qry.exec("SAVEPOINT updaterGroup;");
+  _p->timings.addRoundTrips(2);
+  for (int i = 0; i < group.size() && failed < 0; i++)
+  {
+    const LoaderItem &item = group.at(i);
+    QString    message;
+    QByteArray sql(item.data);
+    int        result;
+    qint64     start = _p->timings.elapsed();
+    if (item.script)
+    {
+      ParameterList params;
+      result = item.script->writeToDB(sql, _package->name(), params, message);
+      _p->timings.addItem(item.filename(), "script", start, item.data.size(), 1);
+      if (result == -1)         // a warning for scripts, as in applySql()
+      {
+        _p->unverified.insert(item.script);
+        messages.append(tr("<font color='%1'>%2</font><br>")
+                          .arg("orange").arg(message));
+        continue;
+      }
+    }
+    else
+    {
+      result = item.loadable->writeToDB(sql, _package->name(), message);
+      _p->timings.addItem(item.filename(), item.loadable->nodename(), start,
+                          item.data.size(), 1);
+    }
+
+    if (result < 0)
+      failed = i;
+    else
+      messages.append(tr("Import of %1 was successful.").arg(item.filename()));
+  }
+
+  bool released = failed < 0 && qry.exec("RELEASE SAVEPOINT updaterGroup;");
+  _p->timings.addSpan(tr("savepoint for %1 items").arg(group.size()),
+                      "savepoint", groupStart);
+  if (released)
+  {
+    foreach (QString message, messages)
+      _p->handler->message(QtWarningMsg, message);
+    setProgress(_progress + group.size());
+    if (group.size() >= _p->groupSize)
+      _p->groupSize = qMin(_p->groupSize * 2, MAXGROUP);
+    return 0;
+  }
+
+  if (DEBUG)
+    qDebug("UpdateEngine::applyGroup() group of %d failed at %d",
+           group.size(), failed);
+  qry.exec("ROLLBACK TO updaterGroup;");
+  qry.exec("RELEASE SAVEPOINT updaterGroup;");
+  _p->timings.addRoundTrips(2);
+  _p->timings.discardItems(mark);   // the replay below records them again
+  _p->groupSize = qMax(_p->groupSize / 2, 1);
+
+  foreach (LoaderItem item, group)
+    if (item.loadable)
+      item.loadable->setGrade(item.grade);
+
+  int split = (failed >= 0) ? failed : group.size() / 2;
+  QList<LoaderItem> before = group.mid(0, split);
+  QList<LoaderItem> after  = group.mid(failed >= 0 ? split + 1 : split);
+
+  int ignored   = 0;
+  int tmpReturn = applyGroup(before);
+  if (tmpReturn < 0)
+    return tmpReturn;
+  ignored += tmpReturn;
+
+  if (failed >= 0)
+  {
+    tmpReturn = applyItem(group.at(failed));
+    if (tmpReturn < 0)
+      return tmpReturn;
+    ignored += tmpReturn;
+  }
+
+  tmpReturn = applyGroup(after);
+  if (tmpReturn < 0)
+    return tmpReturn;
+
+  return ignored + tmpReturn;
+}
+
+int UpdateEngine::applyItem(const LoaderItem &item)
+{
+  if (item.script)
+    return applySql(item.script, item.data);
+  return applyLoadable(item.loadable, item.data);
+}
+
+/* Commit the stages just applied, recording them in the journal in the
+   same transaction, and start a new transaction for the rest. The package
+   triggers are enabled across the commit so a failure later on cannot
+   leave them disabled. Does nothing unless the update is journaled.
+ */
+int UpdateEnginePrivate::checkpoint(const QStringList &stages, bool triggersOff)
+{
+  if (! journal || stages.isEmpty())
+    return 0;
+
+  QString errMsg;
+  if (triggersOff && toggleTriggers(true) < 0)
+    return -1;
+
+  foreach (QString stage, stages)
+  {
+    if (journal->complete(stage, errMsg) < 0)
+    {
+      handler->message(QtWarningMsg, errMsg);
+      return -2;
+    }
+  }
+
+  XSqlQuery qry;
+  qint64    start = timings.elapsed();
+  qry.exec("COMMIT;");
+  timings.addItem(_p->tr("commit %1").arg(stages.join(", ")), "commit",
+                  start, 0, stages.size() + 1);
+  if (qry.lastError().type() != QSqlError::NoError)
+  {
+    handler->message(QtWarningMsg,
+                     _p->tr("<p>Could not commit the %1 stage:</p>"
+                            "<pre>%2<br>%3</pre>")
+                     .arg(stages.join(", "))
+                     .arg(qry.lastError().databaseText())
+                     .arg(qry.lastError().driverText()));
+    return -3;
+  }
+  qry.exec("BEGIN;");
+
+  if (triggersOff && toggleTriggers(false) < 0)
+    return -4;
+
+  handler->message(QtDebugMsg, _p->tr("<p>Committed the %1 stage</p>")
+                                 .arg(stages.join(", ")));
+  return 0;
+}
+
+// forget the journaled stages in the transaction that commits the rest
+void UpdateEnginePrivate::finishJournal()
+{
+  QString errMsg;
+  if (journal && journal->finish(errMsg) < 0)
+    handler->message(QtWarningMsg, errMsg);
+}
+
+// advance past a stage that an earlier journaled run committed
+bool UpdateEnginePrivate::skip(const QString &stage, int size)
+{
+  if (! done(stage))
+    return false;
+
+  _p->setProgress(_p->_progress + size);
+  handler->message(QtWarningMsg,
+                   _p->tr("<p>Skipping the %1 stage, which an earlier run "
+                          "completed</p>").arg(stage));
+  return true;
+}
+
+int UpdateEnginePrivate::disableTriggers()
+{
+  QString schema;
+
+  QMap<QString, QList<Loadable *> > loadables;
+  loadables.insert("priv",      _p->_package->_privs);
+  loadables.insert("metasql",   _p->_package->_metasqls);
+  loadables.insert("report",    _p->_package->_reports);
+  loadables.insert("uiform",    _p->_package->_appuis);
+  loadables.insert("script",    _p->_package->_appscripts);
+  loadables.insert("image",     _p->_package->_images);
+
+  if (_p->_package->_metasqls.size() > 0)
+    triggers.append("public.metasql");
+
+  foreach (QString key, loadables.keys())
+  {
+    foreach (Loadable *i, loadables.value(key))
+    {
+      schema = i->schema();
+      if (schema.isEmpty() && ! _p->_package->system() && ! triggers.contains("pkg" + key))
+        triggers.append("pkg" + key);
+      else if (! schema.isEmpty() && "public" != schema && ! triggers.contains(schema + ".pkg" + key))
+        triggers.append(schema + ".pkg" + key);
+    }
+  }
+
+  // custom commands of non-system packages always touch public.pkgcmd
+  if (_p->_package->_cmds.size() > 0 && ! _p->_package->system() &&
+      ! triggers.contains("pkgcmd"))
+  {
+    triggers.append("pkgcmd");
+    triggers.append("pkgcmdarg");
+  }
+
+  foreach (Loadable *i, _p->_package->_cmds)
+  {
+    schema = i->schema();
+    if (! schema.isEmpty() && "public" != schema &&
+        ! triggers.contains(schema + ".pkgcmd"))
+    {
+      triggers.append(schema + ".pkgcmd");
+      triggers.append(schema + ".pkgcmdarg");
+    }
+  }
+
+  if (toggleTriggers(false) < 0)
+    return -1;
+
+  return triggers.size();
+}
+
+int UpdateEnginePrivate::enableTriggers()
+{
+  if (toggleTriggers(true) < 0)
+    return -1;
+
+  return triggers.size();
+}
+
+/* Enable or disable the altertrigger of every table in triggers with one
+   server round trip. The tables are locked first, in schema and table name
+   order so concurrent updaters cannot deadlock, and the time spent waiting
+   for those locks is added to lockWait and reported.
+ */
+int UpdateEnginePrivate::toggleTriggers(bool enable)
+{
+  if (triggers.isEmpty())
+    return 0;
+
+  QStringList tables;
+  foreach (QString table, triggers)
+    tables.append("'" + QString(table).replace("'", "''") + "'");
+
+  XSqlQuery toggleq;
+  qint64    start = timings.elapsed();
+  toggleq.exec(QString("DO $updatertriggers$"
+                       " DECLARE"
+                       "   _r     RECORD;"
+                       "   _start TIMESTAMP WITH TIME ZONE;"
+                       "   _wait  INTERVAL := '0';"
+                       " BEGIN"
+                       "   FOR _r IN SELECT DISTINCT c.oid::REGCLASS AS rel,"
+                       "                    n.nspname, c.relname"
+                       "               FROM unnest(ARRAY[%1]::TEXT[]) AS t(name)"
+                       "               JOIN pg_class c ON c.oid=t.name::REGCLASS"
+                       "               JOIN pg_namespace n ON c.relnamespace=n.oid"
+                       "              ORDER BY n.nspname, c.relname LOOP"
+                       "     _start := clock_timestamp();"
+                       "     EXECUTE format('LOCK TABLE %s IN SHARE ROW EXCLUSIVE MODE',"
+                       "                    _r.rel);"
+                       "     _wait := _wait + (clock_timestamp() - _start);"
+                       "     EXECUTE format('ALTER TABLE %s %2 TRIGGER %I', _r.rel,"
+                       "                    _r.relname || 'altertrigger');"
+                       "   END LOOP;"
+                       "   PERFORM set_config('updater.lockwait',"
+                       "             (EXTRACT(EPOCH FROM _wait) * 1000)::INTEGER::TEXT,"
+                       "             true);"
+                       " END $updatertriggers$;")
+               .arg(tables.join(", "), enable ? "ENABLE" : "DISABLE"));
+  if (toggleq.lastError().type() != QSqlError::NoError)
+  {
+    handler->message(QtWarningMsg,
+        (enable ? _p->tr("<br><font color='red'>Could not enable the "
+                         "triggers on %1:<pre>%2</pre></font><br>")
+                : _p->tr("<br><font color='red'>Could not disable the "
+                         "triggers on %1:<pre>%2</pre></font><br>"))
+                  .arg(triggers.join(", "))
+                  .arg(toggleq.lastError().text()));
+    return -1;
+  }
+
+  int wait = 0;
+  toggleq.exec("SELECT current_setting('updater.lockwait') AS lockwait;");
+  if (toggleq.first())
+    wait = toggleq.value("lockwait").toInt();
+  lockWait += wait;
+  timings.addItem(enable ? _p->tr("enable triggers") : _p->tr("disable triggers"),
+                  "triggers", start, 0, 2);
+  timings.addLockWait(wait);
+
+  handler->message(wait >= 1000 ? QtWarningMsg : QtDebugMsg,
+                   _p->tr("Waited %1 ms for locks to %2 %3 triggers<br/>")
+                     .arg(wait).arg(enable ? _p->tr("enable") : _p->tr("disable"))
+                     .arg(triggers.size()));
+
+  return triggers.size();
+}
+
+void UpdateEngine::logUpdate(QDateTime startTime, QDateTime endTime)
+{
+  XSqlQuery _q;
+  _q.exec("SELECT EXISTS(SELECT relname FROM pg_class JOIN pg_namespace ON relnamespace=pg_namespace.oid WHERE relname='updaterhist' AND pg_namespace.nspname='public');" );
+  if (_q.first())
+    if(_q.value(0).toBool())
+    {
+      QString osUser = NULL;
+
+      #if not defined(Q_OS_WIN)
+        osUser = getpwuid(getuid())->pw_name;
+      #endif
+      #if defined(Q_OS_WIN)
+        TCHAR osUsertmp[UNLEN + 1];
+        DWORD size = UNLEN + 1;
+        GetUserName((TCHAR*)osUsertmp, &size);
+        osUser = QString::fromLatin1((char*)osUsertmp);
+      #endif
+
+      QString os = NULL;
+      #if QT_VERSION < 0x050000
+        #if defined(Q_OS_WIN)
+          os = QString::fromStdString("Windows");
+        #endif
+        #if defined(Q_OS_MAC)
+          os = QString::fromStdString("Mac");
+        #endif
+        #if defined(Q_OS_LINUX)
+          os = QString::fromStdString("Linux");
+        #endif
+      #endif
+      #if QT_VERSION >= 0x050000
+        QGuiApplication *app = qobject_cast<QGuiApplication *>(QCoreApplication::instance());
+        os = app ? app->platformName() : QString("console");
+      #endif
+
+      QString postPkgVer = NULL;
+      QString postDbVer = NULL;
+      if (_package->name().isNull())
+      {
+        postDbVer = _package->version().toString();
+      }
+      else
+      {
+        postPkgVer = _package->version().toString();
+        postDbVer = preDbVer;
+      }
+
+      _q.prepare( "INSERT INTO updaterhist "
+          "( updaterhist_user, updaterhist_start, updaterhist_end,"
+          " updaterhist_file, updaterhist_pkgname, updaterhist_osuser, updaterhist_hostname,"
+          " updaterhist_os, updaterhist_updaterver, updaterhist_prepkgver, updaterhist_postpkgver,"
+          " updaterhist_predbver, updaterhist_postdbver) "
+          " VALUES (geteffectivextuser(), :start, :end,"
+          "      :file, :pkgname, :osuser, :hostname,"
+          "      :os, :updater, :prepkgver, :postpkgver,"
+          "      :predbver, :postdbver);" );
+      _q.bindValue(":start", startTime);
+      _q.bindValue(":end", endTime);
+      _q.bindValue(":file", _filename);
+      _q.bindValue(":pkgname", _package->name());
+      _q.bindValue(":osuser", osUser);
+      _q.bindValue(":hostname", QSqlDatabase::database().hostName());
+      _q.bindValue(":os", os);
+      _q.bindValue(":updater", XVersion(Updater::version).toString());
+      _q.bindValue(":prepkgver", prePkgVer);
+      _q.bindValue(":postpkgver", postPkgVer);
+      _q.bindValue(":predbver", preDbVer);
+      _q.bindValue(":postdbver", postDbVer);
+      _q.exec();
+    }
+}
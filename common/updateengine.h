@@ -0,0 +1,121 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __UPDATEENGINE_H__
+#define __UPDATEENGINE_H__
+
+#include <QDateTime>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class CatalogSnapshot;
+class CreateDBObj;
+class Loadable;
+class LoadableBatch;
+class Package;
+class PkgArchive;
+class Script;
+class UpdateTimings;
+class XAbstractMessageHandler;
+
+class UpdateEnginePrivate;
+struct LoaderItem;
+
+/* UpdateEngine opens an update package, checks its prerequisites and
+   applies it to the database on the default connection. It needs a
+   QCoreApplication but no widgets, so the updater window and the
+   command line updater drive the same code.
+
+   Everything it has to say goes to handler(), including the questions
+   asked when an item with OnError="Prompt" fails. Progress is reported
+   with progressChanged() as items are applied.
+ */
+class UpdateEngine : public QObject
+{
+    Q_OBJECT
+
+  public:
+    UpdateEngine(XAbstractMessageHandler *handler, QObject *parent = 0);
+    virtual ~UpdateEngine();
+
+    PkgArchive              *files()           const { return _files; }
+    QString                  filename()        const { return _filename; }
+    XAbstractMessageHandler *handler()         const;
+    bool                     alwaysRollback()  const;
+    Package                 *package()         const { return _package; }
+    int                      progress()        const { return _progress; }
+    int                      progressMaximum() const { return _maximum; }
+    const UpdateTimings     &timings()         const;
+
+  public slots:
+    virtual void close();
+    virtual bool open(const QString &filename);
+    virtual bool start();
+
+    virtual void setAlwaysRollback(bool);
+    virtual void setHandler(XAbstractMessageHandler *handler);
+    virtual void setInTransaction(bool);
+    virtual void setJournal(bool);
+    virtual void setRewrite(bool);
+    virtual void setSchedule(bool);
+    virtual void setServerApply(bool);
+    virtual void setTimingsFile(const QString &filename);
+    virtual void setTraceFile(const QString &filename);
+    virtual void setUseCache(bool);
+
+  signals:
+    void progressChanged(int value, int maximum);
+
+  protected:
+    Package    *_package;
+    PkgArchive *_files;
+
+    QString _filename;
+    QString prePkgVer;
+    QString preDbVer;
+    int     _progress;
+    int     _maximum;
+
+    virtual bool applyPackage();
+    virtual int  applySql(Script *);
+    virtual int  applySql(Script *, const QByteArray &data);
+    virtual int  applyScripts(const QList<Script*> &list);
+    virtual int  applyLoadable(Loadable *);
+    virtual int  applyLoadable(Loadable *, const QByteArray &data);
+    virtual int  applyLoadables(const QList<Loadable*> &list);
+    virtual int  applyBatch(LoadableBatch &batch, QList<QByteArray> &data);
+    virtual int  applyGroup(QList<LoaderItem> &group);
+    virtual int  applyItem(const LoaderItem &item);
+    virtual int  applyOnServer(const QList<QList<Script*> > &scripts,
+                               const QList<QList<Loadable*> > &loadables,
+                               bool &applied);
+    virtual int  verifyObjects(const QList<CreateDBObj*> &list, CatalogSnapshot &snapshot);
+    virtual bool readMember(const QString &name, QByteArray &data, QString &errMsg);
+    virtual bool readMember(Loadable *item, QByteArray &data, QString &errMsg);
+    virtual bool scheduleScripts();
+    virtual QStringList packageMembers() const;
+    virtual void stageItems(const QString &stage, QList<Script*> &scripts,
+                            QList<Loadable*> &loadables) const;
+    virtual QStringList stageMembers(const QString &stage) const;
+    virtual QStringList stageNames() const;
+    virtual void logUpdate(QDateTime startTime, QDateTime endTime);
+    virtual void setProgress(int value);
+
+    static QString _rollbackMsg;
+
+  private:
+    UpdateEnginePrivate *_p;
+
+    friend class UpdateEnginePrivate;
+};
+
+#endif
@@ -0,0 +1,501 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "updatefanout.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHashIterator>
+#include <QProcessEnvironment>
+#include <QRegExp>
+#include <QXmlStreamReader>
+
+#include <dbtools.h>
+#include <xabstractmessagehandler.h>
+
+#include "package.h"
+#include "pkgarchive.h"
+#include "pkgcache.h"
+#include "updatetimings.h"
+
+#define DEBUG false
+#define TR(a) QObject::tr(a)
+
+static QString status(const UpdateFanout::Result &result)
+{
+  if (! result.ran)
+    return TR("not run");
+  else if (result.exitCode == 0)
+    return TR("succeeded");
+  else if (result.exitCode < 0)
+    return TR("crashed");
+  return TR("failed (%1)").arg(result.exitCode);
+}
+
+UpdateFanout::UpdateFanout(XAbstractMessageHandler *handler, QObject *parent)
+  : QObject(parent),
+    _handler(handler),
+    _hostJobs(0),
+    _jobs(4)
+{
+  _program = QCoreApplication::applicationFilePath();
+}
+
+UpdateFanout::~UpdateFanout()
+{
+}
+
+void UpdateFanout::setArguments(const QStringList &args)
+{
+  _arguments = args;
+}
+
+// at most this many workers per host:port, 0 for as many as jobs()
+void UpdateFanout::setHostJobs(int jobs)
+{
+  _hostJobs = qMax(0, jobs);
+}
+
+void UpdateFanout::setJobs(int jobs)
+{
+  _jobs = qMax(1, jobs);
+}
+
+void UpdateFanout::setPassword(const QString &password)
+{
+  _password = password;
+}
+
+void UpdateFanout::setProgram(const QString &program)
+{
+  _program = program;
+}
+
+/* a comma-separated list of databases or the name of a file with one per
+   line, in either case hostname:port/database or a full database URL
+ */
+QStringList UpdateFanout::databaseList(const QString &list, QString &errMsg)
+{
+  QStringList entries;
+  QFile file(list);
+  if (file.exists())
+  {
+    if (! file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+      errMsg = TR("Could not read the database list %1: %2")
+                 .arg(list, file.errorString());
+      return QStringList();
+    }
+    while (! file.atEnd())
+      entries.append(QString::fromLocal8Bit(file.readLine())
+                       .section('#', 0, 0).trimmed());
+  }
+  else
+    entries = list.split(',');
+
+  QStringList result;
+  foreach (QString entry, entries)
+  {
+    entry = entry.trimmed();
+    if (entry.isEmpty())
+      continue;
+    result.append(entry.contains("://") ? entry : "psql://" + entry);
+  }
+
+  if (result.isEmpty())
+    errMsg = TR("No databases were found in %1").arg(list);
+  return result;
+}
+
+// the host:port a database URL points at, the key for per-host limits
+QString UpdateFanout::hostOf(const QString &databaseURL)
+{
+  QString protocol;
+  QString hostName;
+  QString dbName;
+  QString port;
+  parseDatabaseURL(databaseURL, protocol, hostName, dbName, port);
+
+  return QString("%1:%2").arg(hostName.isEmpty() ? "localhost" : hostName,
+                              port.isEmpty()     ? "5432"      : port);
+}
+
+/* open each package once, which leaves it unpacked in the PkgCache for the
+   workers, and read its contents to catch a broken package up front
+ */
+bool UpdateFanout::prepare(const QStringList &packages, QString &errMsg)
+{
+  _packages.clear();
+
+  QStringList contentsnames;
+  contentsnames << "package.xml" << "contents.xml";
+
+  foreach (QString name, packages)
+  {
+    QFileInfo fi(name);
+    if (! fi.isFile())
+    {
+      errMsg = TR("Package %1 does not exist.").arg(name);
+      return false;
+    }
+
+    PkgArchive archive(fi.absoluteFilePath());
+    PkgCache   cache;
+    if (! cache.open(&archive, errMsg))
+      return false;
+
+    QString contentFile = QString::null;
+    for (int i = 0; i < contentsnames.size() && contentFile.isNull(); i++)
+      contentFile = archive.findFile(contentsnames.at(i));
+    if (! archive.isValid())
+    {
+      errMsg = archive.errorString();
+      return false;
+    }
+    else if (contentFile.isNull())
+    {
+      errMsg = TR("No %1 file was found in package %2.")
+                 .arg(contentsnames.join(" or "), name);
+      return false;
+    }
+
+    QXmlStreamReader reader(archive.data(contentFile));
+    QStringList      msgList;
+    QList<bool>      fatalList;
+    Package          package(reader, msgList, fatalList, _handler);
+    if (reader.hasError())
+    {
+      errMsg = TR("There was a problem reading the %1 file in package %2: "
+                  "%3 at line %4, column %5")
+                 .arg(contentFile, name, reader.errorString())
+                 .arg(reader.lineNumber()).arg(reader.columnNumber());
+      return false;
+    }
+    for (int i = 0; i < msgList.size(); i++)
+    {
+      if (fatalList.at(i))
+      {
+        errMsg = TR("Package %1 cannot be applied: %2")
+                   .arg(name, msgList.at(i));
+        return false;
+      }
+    }
+
+    if (DEBUG)
+      qDebug("UpdateFanout::prepare() %s is ready", qPrintable(name));
+    _packages.append(fi.absoluteFilePath());
+  }
+
+  return true;
+}
+
+// apply the prepared packages to every database, returning true if all succeeded
+bool UpdateFanout::run(const QStringList &databaseURLs)
+{
+  _hosts.clear();
+  _queue.clear();
+  _results.clear();
+  foreach (QString url, databaseURLs)
+  {
+    Result result;
+    result.databaseURL = url;
+    result.host        = hostOf(url);
+    result.exitCode    = -1;
+    result.itemMsec    = -1;
+    result.ran         = false;
+    result.start       = 0;
+    result.elapsed     = 0;
+    _queue.append(_results.size());
+    _results.append(result);
+
+    if (! _hosts.contains(result.host))
+    {
+      Host host;
+      host.cap     = 1;
+      host.fastest = -1;
+      host.peak    = 1;
+      host.running = 0;
+      _hosts.insert(result.host, host);
+    }
+  }
+
+  _timer.start();
+  startWorkers();
+  if (! _running.isEmpty())
+    _loop.exec();
+
+  return failed() == 0;
+}
+
+// start the first waiting databases whose hosts have room, up to jobs() in all
+void UpdateFanout::startWorkers()
+{
+  int q = 0;
+  while (_running.size() < _jobs && q < _queue.size())
+  {
+    int   i    = _queue.at(q);
+    Host &host = _hosts[_results.at(i).host];
+    if (host.running >= host.cap)
+    {
+      q++;
+      continue;
+    }
+    _queue.removeAt(q);
+    host.running++;
+
+    QStringList args = _arguments;
+    args << "-databaseURL=" + _results.at(i).databaseURL << "-cache" << "-D"
+         << "-timings=" + timingsFile(i);
+    foreach (QString package, _packages)
+      args << "-file=" + package;
+
+    QProcess *worker = new QProcess(this);
+    worker->setProcessChannelMode(QProcess::MergedChannels);
+    if (! _password.isEmpty())
+    {
+      QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+      env.insert("PGPASSWORD", _password);
+      worker->setProcessEnvironment(env);
+    }
+    connect(worker, SIGNAL(error(QProcess::ProcessError)),
+            this,   SLOT(sError(QProcess::ProcessError)));
+    connect(worker, SIGNAL(finished(int, QProcess::ExitStatus)),
+            this,   SLOT(sFinished(int, QProcess::ExitStatus)));
+
+    _results[i].ran   = true;
+    _results[i].start = _timer.elapsed();
+    _running.insert(worker, i);
+    if (DEBUG)
+      qDebug("UpdateFanout::startWorkers() %s %s", qPrintable(_program),
+             qPrintable(args.join(" ")));
+    worker->start(_program, args);
+  }
+}
+
+void UpdateFanout::sError(QProcess::ProcessError error)
+{
+  // anything else is followed by finished()
+  QProcess *worker = qobject_cast<QProcess*>(sender());
+  if (error != QProcess::FailedToStart || ! _running.contains(worker))
+    return;
+
+  _results[_running.value(worker)].ran = false;
+  finish(worker, -1, true);
+}
+
+void UpdateFanout::sFinished(int exitCode, QProcess::ExitStatus status)
+{
+  QProcess *worker = qobject_cast<QProcess*>(sender());
+  if (status == QProcess::CrashExit)
+    finish(worker, -1, true);
+  else
+    finish(worker, exitCode, false);
+}
+
+void UpdateFanout::finish(QProcess *worker, int exitCode, bool crashed)
+{
+  if (! _running.contains(worker))
+    return;
+
+  int     i      = _running.take(worker);
+  Result &result = _results[i];
+  result.exitCode = exitCode;
+  result.elapsed  = _timer.elapsed() - result.start;
+  result.output   = QString::fromLocal8Bit(worker->readAll());
+  if (crashed)
+    result.output += worker->errorString();
+  worker->deleteLater();
+
+  result.itemMsec = itemMsec(timingsFile(i));
+  QFile::remove(timingsFile(i));
+
+  Host &host = _hosts[result.host];
+  if (result.itemMsec >= 0)
+    adjust(host, result.itemMsec);
+  host.running--;
+
+  int done = _results.size() - _queue.size() - _running.size();
+  _handler->message(result.exitCode == 0 ? QtDebugMsg : QtWarningMsg,
+                    TR("%1 of %2: %3 %4 in %5 s")
+                      .arg(done).arg(_results.size())
+                      .arg(result.databaseURL, status(result))
+                      .arg(result.elapsed / 1000.0, 0, 'f', 1));
+
+  startWorkers();
+  if (_running.isEmpty() && _queue.isEmpty())
+    _loop.quit();
+}
+
+/* additive increase, multiplicative decrease. a worker that just finished
+   on host, while host still counts it as running, took itemMsec per item.
+   the cap only grows if the host was using all of it.
+ */
+void UpdateFanout::adjust(Host &host, double itemMsec)
+{
+  int most = _hostJobs > 0 ? qMin(_hostJobs, _jobs) : _jobs;
+  if (host.fastest < 0 || itemMsec < host.fastest)
+    host.fastest = itemMsec;
+
+  int was = host.cap;
+  if (itemMsec > 2 * host.fastest)
+    host.cap = qMax(1, host.cap / 2);
+  else if (itemMsec <= 1.5 * host.fastest && host.running >= host.cap &&
+           host.cap < most)
+    host.cap++;
+  host.peak = qMax(host.peak, host.cap);
+
+  if (DEBUG && host.cap != was)
+    qDebug("UpdateFanout::adjust() %.3f ms per item (fastest %.3f): "
+           "cap %d -> %d", itemMsec, host.fastest, was, host.cap);
+}
+
+// mean msec per item applied in a worker's -timings file, -1 if unknown
+double UpdateFanout::itemMsec(const QString &timingsFile) const
+{
+  QFile file(timingsFile);
+  if (! file.open(QIODevice::ReadOnly | QIODevice::Text))
+    return -1;
+
+  // one phase per line, as written by UpdateTimings::json()
+  QRegExp phaseRE("\"applied_ms\": ([0-9.]+).*\"items\": ([0-9]+)");
+  double  applied = 0;
+  int     items   = 0;
+  while (! file.atEnd())
+  {
+    QString line = QString::fromUtf8(file.readLine());
+    if (phaseRE.indexIn(line) >= 0)
+    {
+      applied += phaseRE.cap(1).toDouble();
+      items   += phaseRE.cap(2).toInt();
+    }
+  }
+
+  return items > 0 ? applied / items : -1;
+}
+
+QString UpdateFanout::timingsFile(int index) const
+{
+  return QDir(QDir::tempPath()).filePath(QString("updater-fanout-%1-%2.json")
+                                           .arg(QCoreApplication::applicationPid())
+                                           .arg(index));
+}
+
+int UpdateFanout::failed() const
+{
+  int count = 0;
+  foreach (Result result, _results)
+    if (result.exitCode != 0)
+      count++;
+  return count;
+}
+
+// one line per database: its URL, how the update went and how long it took
+QString UpdateFanout::matrix() const
+{
+  int    width   = TR("Database").length();
+  qint64 elapsed = 0;
+  foreach (Result result, _results)
+  {
+    width   = qMax(width, result.databaseURL.length());
+    elapsed = qMax(elapsed, result.start + result.elapsed);
+  }
+
+  QStringList lines;
+  lines.append(QString("%1  %2  %3").arg(TR("Database").leftJustified(width),
+                                         TR("Result").leftJustified(12),
+                                         TR("Seconds").rightJustified(8)));
+  foreach (Result result, _results)
+    lines.append(QString("%1  %2  %3")
+                   .arg(result.databaseURL.leftJustified(width),
+                        status(result).leftJustified(12),
+                        QString::number(result.elapsed / 1000.0, 'f', 1)
+                          .rightJustified(8)));
+  lines.append(TR("%1 of %2 databases updated in %3 s with %4 workers")
+                 .arg(_results.size() - failed()).arg(_results.size())
+                 .arg(elapsed / 1000.0, 0, 'f', 1).arg(_jobs));
+
+  QStringList hosts = _hosts.keys();
+  hosts.sort();
+  foreach (QString name, hosts)
+  {
+    Host host = _hosts.value(name);
+    lines.append(TR("%1: up to %2 at once, fastest %3 ms per item")
+                   .arg(name).arg(host.peak)
+                   .arg(host.fastest < 0 ? TR("unknown")
+                                         : QString::number(host.fastest, 'f', 3)));
+  }
+
+  return lines.join("\n");
+}
+
+QByteArray UpdateFanout::json() const
+{
+  QStringList packages;
+  foreach (QString package, _packages)
+    packages.append(UpdateTimings::quoted(package));
+
+  qint64      elapsed = 0;
+  QStringList databases;
+  foreach (Result result, _results)
+  {
+    elapsed = qMax(elapsed, result.start + result.elapsed);
+    databases.append(QString("    { \"databaseURL\": %1, \"host\": %2, "
+                             "\"status\": %3, \"exit_code\": %4, "
+                             "\"start_ms\": %5, \"elapsed_ms\": %6, "
+                             "\"item_ms\": %7 }")
+                       .arg(UpdateTimings::quoted(result.databaseURL),
+                            UpdateTimings::quoted(result.host),
+                            UpdateTimings::quoted(status(result)))
+                       .arg(result.exitCode).arg(result.start)
+                       .arg(result.elapsed)
+                       .arg(result.itemMsec < 0 ? QString("null")
+                                                : QString::number(result.itemMsec, 'f', 3)));
+  }
+
+  QStringList hosts;
+  QHashIterator<QString, Host> h(_hosts);
+  while (h.hasNext())
+  {
+    h.next();
+    hosts.append(QString("    { \"host\": %1, \"cap\": %2, \"peak\": %3, "
+                         "\"fastest_item_ms\": %4 }")
+                   .arg(UpdateTimings::quoted(h.key())).arg(h.value().cap)
+                   .arg(h.value().peak)
+                   .arg(h.value().fastest < 0 ? QString("null")
+                                              : QString::number(h.value().fastest, 'f', 3)));
+  }
+
+  return QString("{\n"
+                 "  \"packages\": [ %1 ],\n"
+                 "  \"jobs\": %2,\n"
+                 "  \"failed\": %3,\n"
+                 "  \"host_jobs\": %4,\n"
+                 "  \"elapsed_ms\": %5,\n"
+                 "  \"hosts\": [\n%6\n  ],\n"
+                 "  \"databases\": [\n%7\n  ]\n"
+                 "}\n")
+           .arg(packages.join(", ")).arg(_jobs).arg(failed()).arg(_hostJobs)
+           .arg(elapsed).arg(hosts.join(",\n"), databases.join(",\n")).toUtf8();
+}
+
+bool UpdateFanout::save(const QString &filename, QString &errMsg) const
+{
+  QFile file(filename);
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+      file.write(json()) < 0)
+  {
+    errMsg = TR("Could not write the results to %1: %2")
+               .arg(filename, file.errorString());
+    return false;
+  }
+  return true;
+}
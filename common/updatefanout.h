@@ -0,0 +1,130 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __UPDATEFANOUT_H__
+#define __UPDATEFANOUT_H__
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+
+class XAbstractMessageHandler;
+
+/* UpdateFanout applies the same packages to many databases at once.
+
+   Everything an UpdateEngine touches goes through the default database
+   connection of its thread, so the databases are not updated by threads
+   but by worker processes, up to jobs() of them at a time. Each worker is
+   program() - normally updater-cli - applying every package, in order, to
+   one database over one connection.
+
+   prepare() opens and parses each package once, before any database is
+   touched, so a broken package fails once instead of once per database.
+   Opening leaves the unpacked package and its member index in the
+   PkgCache and the workers run with -cache, so none of them decompresses
+   or scans the package again; they share the cached copy read-only.
+
+   Workers cannot be asked questions, so they are always run with -D. The
+   password is passed in the PGPASSWORD environment variable rather than
+   on the worker's command line.
+
+   Databases that share a server share its I/O and WAL, so workers are
+   also limited per host:port. Each host starts with one worker and its
+   cap moves with the mean time per item reported in the workers' -timings
+   files: up by one while items stay near the fastest seen on that host,
+   halved when they take more than twice as long, never above hostJobs().
+   Databases on hosts with room go first, so idle servers are not kept
+   waiting behind a busy one.
+ */
+class UpdateFanout : public QObject
+{
+    Q_OBJECT
+
+  public:
+    UpdateFanout(XAbstractMessageHandler *handler, QObject *parent = 0);
+    virtual ~UpdateFanout();
+
+    struct Result
+    {
+      QString databaseURL;
+      QString host;       // host:port
+      int     exitCode;   // the worker's, -1 if it crashed or never ran
+      double  itemMsec;   // mean per item applied, -1 if unknown
+      bool    ran;
+      qint64  start;      // msec since run() started
+      qint64  elapsed;    // msec
+      QString output;     // what the worker printed
+    };
+
+    struct Host
+    {
+      int    cap;        // workers allowed at once
+      double fastest;    // lowest itemMsec seen, -1 if none yet
+      int    peak;       // highest cap reached
+      int    running;
+    };
+
+    QStringList   arguments() const { return _arguments; }
+    int           hostJobs()  const { return _hostJobs; }
+    int           jobs()      const { return _jobs; }
+    QStringList   packages()  const { return _packages; }
+    QString       program()   const { return _program; }
+    QList<Result> results()   const { return _results; }
+
+    virtual void setArguments(const QStringList &args);
+    virtual void setHostJobs(int jobs);
+    virtual void setJobs(int jobs);
+    virtual void setPassword(const QString &password);
+    virtual void setProgram(const QString &program);
+
+    virtual bool prepare(const QStringList &packages, QString &errMsg);
+    virtual bool run(const QStringList &databaseURLs);
+
+    int        failed()  const;
+    QByteArray json()    const;
+    QString    matrix()  const;
+    bool       save(const QString &filename, QString &errMsg) const;
+
+    static QStringList databaseList(const QString &list, QString &errMsg);
+    static QString     hostOf(const QString &databaseURL);
+
+  protected slots:
+    virtual void sError(QProcess::ProcessError error);
+    virtual void sFinished(int exitCode, QProcess::ExitStatus status);
+
+  protected:
+    QStringList              _arguments;
+    XAbstractMessageHandler *_handler;
+    QHash<QString, Host>     _hosts;
+    int                      _hostJobs;
+    int                      _jobs;
+    QEventLoop               _loop;
+    QStringList              _packages;
+    QString                  _password;
+    QString                  _program;
+    QList<Result>            _results;
+    QList<int>               _queue;     // indexes into _results not started
+    QHash<QProcess*, int>    _running;   // worker to index into _results
+    QElapsedTimer            _timer;
+
+    virtual void   adjust(Host &host, double itemMsec);
+    virtual void   finish(QProcess *worker, int exitCode, bool crashed);
+    virtual double itemMsec(const QString &timingsFile) const;
+    QString        timingsFile(int index) const;
+    virtual void   startWorkers();
+};
+
+#endif
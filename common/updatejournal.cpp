@@ -0,0 +1,191 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "updatejournal.h"
+
+#include <QCryptographicHash>
+#include <QObject>
+#include <QSqlError>
+#include <QVariant>
+
+#include "pkgarchive.h"
+#include "xsqlquery.h"
+
+#define DEBUG false
+#define TR(a) QObject::tr(a)
+
+static QString _journalerrtxt = TR("The following error was encountered "
+                                   "while using the update journal:"
+                                   "<br><pre>%1<br>%2</pre>");
+
+UpdateJournal::UpdateJournal(const QString &pkgname)
+  : _pkgname(pkgname)
+{
+}
+
+UpdateJournal::~UpdateJournal()
+{
+}
+
+// members are package paths; missing ones hash differently from present ones
+void UpdateJournal::addStage(const QString &stage, const QStringList &members,
+                             PkgArchive *archive)
+{
+  QCryptographicHash hash(QCryptographicHash::Md5);
+  foreach (QString name, members)
+  {
+    const PkgMember *m = archive ? archive->member(name) : 0;
+    hash.addData(name.toUtf8());
+    if (m)
+      hash.addData(QString(" %1 %2\n").arg(m->size).arg(m->crc).toUtf8());
+    else
+      hash.addData(" missing\n");
+  }
+
+  if (! _stages.contains(stage))
+    _stages.append(stage);
+  _hashes.insert(stage, hash.result().toHex());
+}
+
+// the package as a whole, as far as the stages describe it
+QString UpdateJournal::pkghash() const
+{
+  QCryptographicHash hash(QCryptographicHash::Md5);
+  foreach (QString stage, _stages)
+    hash.addData((stage + " " + _hashes.value(stage) + "\n").toUtf8());
+  return hash.result().toHex();
+}
+
+/* Create the journal table if this database does not have one yet and read
+   what an earlier run of this package left there. Call outside of any
+   transaction that might be rolled back.
+ */
+int UpdateJournal::open(QString &errMsg)
+{
+  _completed.clear();
+
+  XSqlQuery journalq;
+  journalq.exec("CREATE TABLE IF NOT EXISTS public.updaterjournal ("
+                "  updaterjournal_id        SERIAL PRIMARY KEY,"
+                "  updaterjournal_pkgname   TEXT NOT NULL,"
+                "  updaterjournal_pkghash   TEXT NOT NULL,"
+                "  updaterjournal_stage     TEXT NOT NULL,"
+                "  updaterjournal_stagehash TEXT NOT NULL,"
+                "  updaterjournal_done      TIMESTAMP WITH TIME ZONE"
+                "                           NOT NULL DEFAULT now());");
+  if (journalq.lastError().type() != QSqlError::NoError)
+  {
+    errMsg = _journalerrtxt.arg(journalq.lastError().databaseText())
+                           .arg(journalq.lastError().driverText());
+    return -1;
+  }
+
+  journalq.prepare("SELECT updaterjournal_stage, updaterjournal_stagehash"
+                   "  FROM public.updaterjournal"
+                   " WHERE updaterjournal_pkgname=:pkgname"
+                   "   AND updaterjournal_pkghash=:pkghash"
+                   " ORDER BY updaterjournal_id;");
+  journalq.bindValue(":pkgname", _pkgname);
+  journalq.bindValue(":pkghash", pkghash());
+  journalq.exec();
+  while (journalq.next())
+    _completed.insert(journalq.value("updaterjournal_stage").toString(),
+                      journalq.value("updaterjournal_stagehash").toString());
+  if (journalq.lastError().type() != QSqlError::NoError)
+  {
+    errMsg = _journalerrtxt.arg(journalq.lastError().databaseText())
+                           .arg(journalq.lastError().driverText());
+    return -2;
+  }
+
+  if (DEBUG)
+    qDebug("UpdateJournal::open() %d stages recorded, %d resumable",
+           _completed.size(), resumable().size());
+
+  return resumable().size();
+}
+
+QStringList UpdateJournal::resumable() const
+{
+  QStringList result;
+  foreach (QString stage, _stages)
+  {
+    if (! _completed.contains(stage) ||
+        _completed.value(stage) != _hashes.value(stage))
+      break;
+    result.append(stage);
+  }
+  return result;
+}
+
+bool UpdateJournal::done(const QString &stage) const
+{
+  return resumable().contains(stage);
+}
+
+/* Replace what an earlier run recorded for the stage, and anything a
+   different build of the package left behind, with this run's hash. These
+   are two statements since a prepared query may only hold one.
+ */
+int UpdateJournal::complete(const QString &stage, QString &errMsg)
+{
+  XSqlQuery journalq;
+  journalq.prepare("DELETE FROM public.updaterjournal"
+                   " WHERE updaterjournal_pkgname=:pkgname"
+                   "   AND (updaterjournal_stage=:stage"
+                   "        OR updaterjournal_pkghash!=:pkghash);");
+  journalq.bindValue(":pkgname", _pkgname);
+  journalq.bindValue(":pkghash", pkghash());
+  journalq.bindValue(":stage",   stage);
+  journalq.exec();
+  if (journalq.lastError().type() != QSqlError::NoError)
+  {
+    errMsg = _journalerrtxt.arg(journalq.lastError().databaseText())
+                           .arg(journalq.lastError().driverText());
+    return -1;
+  }
+
+  journalq.prepare("INSERT INTO public.updaterjournal ("
+                   "  updaterjournal_pkgname, updaterjournal_pkghash,"
+                   "  updaterjournal_stage,   updaterjournal_stagehash"
+                   ") VALUES (:pkgname, :pkghash, :stage, :stagehash);");
+  journalq.bindValue(":pkgname",   _pkgname);
+  journalq.bindValue(":pkghash",   pkghash());
+  journalq.bindValue(":stage",     stage);
+  journalq.bindValue(":stagehash", _hashes.value(stage));
+  journalq.exec();
+  if (journalq.lastError().type() != QSqlError::NoError)
+  {
+    errMsg = _journalerrtxt.arg(journalq.lastError().databaseText())
+                           .arg(journalq.lastError().driverText());
+    return -2;
+  }
+
+  _completed.insert(stage, _hashes.value(stage));
+  return 0;
+}
+
+int UpdateJournal::finish(QString &errMsg)
+{
+  XSqlQuery journalq;
+  journalq.prepare("DELETE FROM public.updaterjournal"
+                   " WHERE updaterjournal_pkgname=:pkgname;");
+  journalq.bindValue(":pkgname", _pkgname);
+  journalq.exec();
+  if (journalq.lastError().type() != QSqlError::NoError)
+  {
+    errMsg = _journalerrtxt.arg(journalq.lastError().databaseText())
+                           .arg(journalq.lastError().driverText());
+    return -1;
+  }
+
+  _completed.clear();
+  return 0;
+}
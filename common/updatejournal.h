@@ -0,0 +1,59 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __UPDATEJOURNAL_H__
+#define __UPDATEJOURNAL_H__
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+class PkgArchive;
+
+/* UpdateJournal lets a long update commit as it goes and pick up where it
+   left off if it fails.
+
+   Each stage of an update is identified by a name and a hash of the
+   package members it applies, taken from the sizes and CRCs already in the
+   package index so nothing has to be decompressed. complete() records a
+   stage in the updaterjournal table, in the same transaction as the stage's
+   work, just before the caller commits it.
+
+   open() reads what an earlier, unfinished run of the same build of the
+   package recorded, matching both its name and its pkghash(). done() is true for the leading stages that run completed with
+   identical contents; the first stage that is new or different, and every
+   stage after it, must be applied again. finish() forgets the run once the
+   whole update has been committed.
+ */
+class UpdateJournal
+{
+  public:
+    UpdateJournal(const QString &pkgname);
+    virtual ~UpdateJournal();
+
+    virtual void addStage(const QString &stage, const QStringList &members,
+                          PkgArchive *archive);
+    virtual int  complete(const QString &stage, QString &errMsg);
+    virtual bool done(const QString &stage) const;
+    virtual int  finish(QString &errMsg);
+    virtual int  open(QString &errMsg);
+
+    QString     pkghash()   const;
+    QStringList resumable() const;  // the stages done() skips
+    QStringList stages()    const { return _stages; }
+
+  protected:
+    QHash<QString, QString> _completed;  // stage to hash from an earlier run
+    QHash<QString, QString> _hashes;     // stage to hash in this package
+    QString     _pkgname;
+    QStringList _stages;
+};
+
+#endif
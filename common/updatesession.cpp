@@ -0,0 +1,253 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "updatesession.h"
+
+#include <QObject>
+#include <QSqlError>
+#include <QXmlStreamReader>
+
+#include <xabstractmessagehandler.h>
+#include <xsqlquery.h>
+
+#include "package.h"
+#include "pkgarchive.h"
+#include "prerequisite.h"
+#include "updateengine.h"
+
+#define DEBUG false
+#define TR(a) QObject::tr(a)
+
+UpdateSession::UpdateSession(UpdateEngine *engine)
+  : _engine(engine),
+    _singleTransaction(false)
+{
+}
+
+UpdateSession::~UpdateSession()
+{
+}
+
+QStringList UpdateSession::filenames() const
+{
+  QStringList result;
+  foreach (Entry entry, _order)
+    result.append(entry.filename);
+  return result;
+}
+
+void UpdateSession::setSingleTransaction(bool p)
+{
+  _singleTransaction = p;
+}
+
+// true if the package described by entry meets need
+bool UpdateSession::provides(const Entry &entry, const Need &need)
+{
+  return entry.name == need.name &&
+         (need.version.isEmpty()   || entry.version   == need.version) &&
+         (need.developer.isEmpty() || entry.developer == need.developer);
+}
+
+// the header and dependencies of a package, without unpacking the rest of it
+bool UpdateSession::read(const QString &filename, Entry &entry, QString &errMsg)
+{
+  PkgArchive archive(filename);
+  if (! archive.open(errMsg))
+    return false;
+
+  QStringList contentsnames;
+  contentsnames << "package.xml" << "contents.xml";
+  QString contentFile = QString::null;
+  for (int i = 0; i < contentsnames.size() && contentFile.isNull(); i++)
+    contentFile = archive.findFile(contentsnames.at(i));
+  if (! archive.isValid())
+  {
+    errMsg = archive.errorString();
+    return false;
+  }
+  else if (contentFile.isNull())
+  {
+    errMsg = TR("No %1 file was found in package %2.")
+               .arg(contentsnames.join(" or "), filename);
+    return false;
+  }
+
+  QXmlStreamReader reader(archive.data(contentFile));
+  QStringList      msgList;
+  QList<bool>      fatalList;
+  Package          package(reader, msgList, fatalList, _engine->handler());
+  if (reader.hasError())
+  {
+    errMsg = TR("There was a problem reading the %1 file in package %2: "
+                "%3 at line %4, column %5")
+               .arg(contentFile, filename, reader.errorString())
+               .arg(reader.lineNumber()).arg(reader.columnNumber());
+    return false;
+  }
+
+  entry.filename  = filename;
+  entry.name      = package.name();
+  entry.version   = package.version().toString();
+  entry.developer = package.developer();
+  entry.needs.clear();
+  foreach (Prerequisite *prereq, package._prerequisites)
+  {
+    if (prereq->type() != Prerequisite::Dependency || ! prereq->dependency())
+      continue;
+
+    Need need;
+    need.name      = prereq->dependency()->name();
+    need.version   = prereq->dependency()->version();
+    need.developer = prereq->dependency()->developer();
+    entry.needs.append(need);
+  }
+
+  return true;
+}
+
+bool UpdateSession::prepare(const QStringList &filenames, QString &errMsg)
+{
+  _order.clear();
+
+  QList<Entry> entries;
+  foreach (QString filename, filenames)
+  {
+    Entry entry;
+    if (! read(filename, entry, errMsg))
+      return false;
+    entries.append(entry);
+  }
+
+  if (! sort(entries, errMsg))
+    return false;
+
+  _order = entries;
+  if (DEBUG)
+    qDebug("UpdateSession::prepare() order %s",
+           qPrintable(UpdateSession::filenames().join(", ")));
+  return true;
+}
+
+/* dependencies on pkghead must already be met. those on packages in the
+   session put the dependent package after them; otherwise the order given
+   is kept.
+ */
+bool UpdateSession::sort(QList<Entry> &entries, QString &errMsg)
+{
+  QList<Entry> installed;
+  XSqlQuery    pkghead("SELECT pkghead_name, pkghead_version,"
+                       "       pkghead_developer"
+                       "  FROM pkghead;");
+  bool checkInstalled = pkghead.lastError().type() == QSqlError::NoError;
+  while (pkghead.next())
+  {
+    Entry entry;
+    entry.name      = pkghead.value("pkghead_name").toString();
+    entry.version   = pkghead.value("pkghead_version").toString();
+    entry.developer = pkghead.value("pkghead_developer").toString();
+    installed.append(entry);
+  }
+
+  for (int i = 0; i < entries.size(); i++)
+  {
+    foreach (Need need, entries.at(i).needs)
+    {
+      bool met = ! checkInstalled;
+      for (int j = 0; j < entries.size() && ! met; j++)
+        met = j != i && provides(entries.at(j), need);
+      for (int j = 0; j < installed.size() && ! met; j++)
+        met = provides(installed.at(j), need);
+      if (! met)
+      {
+        errMsg = TR("Package %1 requires the package %2 (version %3, "
+                    "developer %4), which is neither installed nor one of "
+                    "the packages being applied.")
+                   .arg(entries.at(i).filename, need.name,
+                        need.version.isEmpty()   ? TR("Unspecified") : need.version,
+                        need.developer.isEmpty() ? TR("Unspecified") : need.developer);
+        return false;
+      }
+    }
+  }
+
+  QList<Entry> sorted;
+  while (! entries.isEmpty())
+  {
+    int next = -1;
+    for (int i = 0; i < entries.size() && next < 0; i++)
+    {
+      bool ready = true;
+      foreach (Need need, entries.at(i).needs)
+        for (int j = 0; j < entries.size() && ready; j++)
+          ready = j == i || ! provides(entries.at(j), need);
+      if (ready)
+        next = i;
+    }
+
+    if (next < 0)
+    {
+      QStringList names;
+      foreach (Entry entry, entries)
+        names.append(entry.name);
+      errMsg = TR("These packages depend on each other, so there is no "
+                  "order to apply them in: %1").arg(names.join(", "));
+      return false;
+    }
+    sorted.append(entries.takeAt(next));
+  }
+
+  entries = sorted;
+  return true;
+}
+
+// apply the packages in order, returning true if all of them were applied
+bool UpdateSession::run()
+{
+  XAbstractMessageHandler *handler = _engine->handler();
+
+  bool rollback = _engine->alwaysRollback();
+  bool outer    = _singleTransaction || (rollback && _order.size() > 1);
+  if (outer)
+  {
+    XSqlQuery begin("BEGIN;");
+    _engine->setInTransaction(true);
+    _engine->setAlwaysRollback(false);
+  }
+
+  bool result = true;
+  for (int i = 0; i < _order.size() && result; i++)
+  {
+    if (_order.size() > 1)
+      handler->message(QtWarningMsg,
+                       TR("<h3>Package %1 of %2: %3</h3>")
+                         .arg(i + 1).arg(_order.size())
+                         .arg(_order.at(i).filename));
+    result = _engine->open(_order.at(i).filename) && _engine->start();
+  }
+
+  if (outer)
+  {
+    XSqlQuery end(result && ! rollback ? "COMMIT;" : "ROLLBACK;");
+    _engine->setInTransaction(false);
+    _engine->setAlwaysRollback(rollback);
+
+    if (! result)
+      handler->message(QtWarningMsg,
+                       TR("<p><font color='red'>None of the packages were "
+                          "applied; the whole session was rolled back.</font></p>"));
+    else if (rollback)
+      handler->message(QtWarningMsg,
+                       TR("<h2>All of the packages have been rolled back as "
+                          "requested.</h2>"));
+  }
+
+  return result;
+}
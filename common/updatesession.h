@@ -0,0 +1,80 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __UPDATESESSION_H__
+#define __UPDATESESSION_H__
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class UpdateEngine;
+
+/* UpdateSession applies several packages with one UpdateEngine, over one
+   connection and one login, in an order that satisfies their Dependency
+   prerequisites.
+
+   prepare() reads the header and prerequisites of each package and the
+   pkghead table. A package that depends on another package in the session
+   is applied after it; a dependency met by neither the session nor pkghead
+   fails prepare() before anything is applied. Otherwise the packages keep
+   the order they were given in.
+
+   run() opens and applies each package in turn and stops at the first one
+   that fails. With setSingleTransaction() the whole session is one
+   transaction, each package in a savepoint, so either every package is
+   applied or none is; without it each package commits on its own. An
+   engine set to always roll back runs the session as one transaction and
+   rolls it all back, so later packages can see the earlier ones.
+ */
+class UpdateSession
+{
+  public:
+    UpdateSession(UpdateEngine *engine);
+    virtual ~UpdateSession();
+
+    struct Need
+    {
+      QString name;
+      QString version;      // empty for any
+      QString developer;    // empty for any
+    };
+
+    struct Entry
+    {
+      QString     filename;
+      QString     name;
+      QString     version;
+      QString     developer;
+      QList<Need> needs;
+    };
+
+    UpdateEngine *engine()            const { return _engine; }
+    QList<Entry>  order()             const { return _order; }
+    QStringList   filenames()         const;
+    bool          singleTransaction() const { return _singleTransaction; }
+
+    virtual void setSingleTransaction(bool);
+
+    virtual bool prepare(const QStringList &filenames, QString &errMsg);
+    virtual bool run();
+
+  protected:
+    UpdateEngine *_engine;
+    QList<Entry>  _order;
+    bool          _singleTransaction;
+
+    virtual bool read(const QString &filename, Entry &entry, QString &errMsg);
+    virtual bool sort(QList<Entry> &entries, QString &errMsg);
+
+    static bool provides(const Entry &entry, const Need &need);
+};
+
+#endif
@@ -0,0 +1,364 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "updatetimings.h"
+
+#include <QFile>
+#include <QObject>
+#include <QStringList>
+#include <QtAlgorithms>
+
+#if defined(Q_OS_MAC)
+#include <mach/mach.h>
+#elif defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
+
+#define DEBUG false
+#define TR(a) QObject::tr(a)
+
+// milliseconds with microsecond precision, as JSON numbers
+static QString msec(qint64 nsec)
+{
+  return QString::number(nsec / 1000000.0, 'f', 3);
+}
+
+// microseconds, the unit of trace event timestamps
+static QString usec(qint64 nsec)
+{
+  return QString::number(nsec / 1000.0, 'f', 3);
+}
+
+static bool slower(const UpdateTimings::Item &a, const UpdateTimings::Item &b)
+{
+  return a.elapsed > b.elapsed;
+}
+
+UpdateTimings::UpdateTimings()
+{
+  clear();
+}
+
+UpdateTimings::~UpdateTimings()
+{
+}
+
+void UpdateTimings::clear()
+{
+  _current = -1;
+  _items.clear();
+  _phases.clear();
+  _spans.clear();
+  _started = QDateTime::currentDateTime();
+  _timer.start();
+}
+
+qint64 UpdateTimings::elapsed() const
+{
+  return _timer.nsecsElapsed();
+}
+
+void UpdateTimings::startPhase(const QString &name)
+{
+  endPhase();
+
+  Phase phase;
+  phase.name       = name;
+  phase.start      = elapsed();
+  phase.elapsed    = 0;
+  phase.applied    = 0;
+  phase.read       = 0;
+  phase.bytes      = 0;
+  phase.items      = 0;
+  phase.roundTrips = 0;
+  phase.lockWait   = 0;
+  _phases.append(phase);
+  _current = _phases.size() - 1;
+}
+
+void UpdateTimings::endPhase()
+{
+  if (_current < 0)
+    return;
+
+  _phases[_current].elapsed = elapsed() - _phases.at(_current).start;
+  if (DEBUG)
+    qDebug("UpdateTimings::endPhase() %s took %s ms",
+           qPrintable(_phases.at(_current).name),
+           qPrintable(msec(_phases.at(_current).elapsed)));
+  _current = -1;
+}
+
+// something sent to the database, started at start
+void UpdateTimings::addItem(const QString &name, const QString &kind,
+                            qint64 start, qint64 bytes, int roundTrips)
+{
+  Item item;
+  item.name       = name;
+  item.kind       = kind;
+  item.start      = start;
+  item.elapsed    = elapsed() - start;
+  item.bytes      = bytes;
+  item.memory     = memoryInUse();
+  item.roundTrips = roundTrips;
+  if (_current >= 0)
+  {
+    Phase &phase = _phases[_current];
+    item.phase        = phase.name;
+    phase.applied    += item.elapsed;
+    phase.bytes      += bytes;
+    phase.items++;
+    phase.roundTrips += roundTrips;
+  }
+  _items.append(item);
+}
+
+/* Forget the items added since mark() returned mark, for work that was
+   rolled back and will be done again. Their round trips still count, and
+   the time they took shows in trace() as a rollback span.
+ */
+void UpdateTimings::discardItems(int mark)
+{
+  if (mark < 0 || mark >= _items.size())
+    return;
+
+  addSpan(TR("rolled back %1 items").arg(_items.size() - mark),
+          "rollback", _items.at(mark).start);
+  while (_items.size() > mark)
+  {
+    Item item = _items.takeLast();
+    for (int p = _phases.size() - 1; p >= 0; p--)
+    {
+      if (_phases.at(p).name == item.phase)
+      {
+        _phases[p].applied -= item.elapsed;
+        _phases[p].bytes   -= item.bytes;
+        _phases[p].items--;
+        break;
+      }
+    }
+  }
+}
+
+void UpdateTimings::addLockWait(int msec)
+{
+  if (_current >= 0)
+    _phases[_current].lockWait += msec;
+}
+
+// waiting since start for a package member of bytes to be read
+void UpdateTimings::addRead(qint64 start, qint64 bytes)
+{
+  Q_UNUSED(bytes);
+  if (_current >= 0)
+    _phases[_current].read += elapsed() - start;
+}
+
+void UpdateTimings::addRoundTrips(int count)
+{
+  if (_current >= 0)
+    _phases[_current].roundTrips += count;
+}
+
+// something worth seeing in trace() that is not an item, started at start
+void UpdateTimings::addSpan(const QString &name, const QString &category,
+                            qint64 start)
+{
+  Span span;
+  span.name     = name;
+  span.category = category;
+  span.start    = start;
+  span.elapsed  = elapsed() - start;
+  _spans.append(span);
+}
+
+qint64 UpdateTimings::memoryInUse()
+{
+#if defined(Q_OS_LINUX)
+  QFile statm("/proc/self/statm");
+  if (statm.open(QIODevice::ReadOnly))
+  {
+    QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() > 1)
+      return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+  }
+#elif defined(Q_OS_MAC)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t      count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                (task_info_t)&info, &count) == KERN_SUCCESS)
+    return info.resident_size;
+#endif
+  return -1;
+}
+
+// value as a JSON string literal
+QString UpdateTimings::quoted(const QString &value)
+{
+  QString result("\"");
+  foreach (QChar c, value)
+  {
+    if (c == '"' || c == '\\')
+      result += QString("\\") + c;
+    else if (c == '\n')
+      result += "\\n";
+    else if (c == '\t')
+      result += "\\t";
+    else if (c.unicode() < 0x20)
+      result += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+    else
+      result += c;
+  }
+  return result + "\"";
+}
+
+QByteArray UpdateTimings::json() const
+{
+  QStringList phases;
+  foreach (Phase phase, _phases)
+    phases.append(QString("    { \"name\": %1, \"start_ms\": %2, "
+                          "\"elapsed_ms\": %3, \"applied_ms\": %4, "
+                          "\"read_ms\": %5, \"lockwait_ms\": %6, "
+                          "\"items\": %7, \"bytes\": %8, \"roundtrips\": %9 }")
+                  .arg(quoted(phase.name), msec(phase.start),
+                       msec(phase.elapsed), msec(phase.applied),
+                       msec(phase.read))
+                  .arg(phase.lockWait).arg(phase.items).arg(phase.bytes)
+                  .arg(phase.roundTrips));
+
+  QStringList items;
+  foreach (Item item, _items)
+    items.append(QString("    { \"name\": %1, \"kind\": %2, \"phase\": %3, "
+                         "\"start_ms\": %4, \"elapsed_ms\": %5, "
+                         "\"bytes\": %6, \"roundtrips\": %7 }")
+                 .arg(quoted(item.name), quoted(item.kind), quoted(item.phase),
+                      msec(item.start), msec(item.elapsed))
+                 .arg(item.bytes).arg(item.roundTrips));
+
+  QString result = QString("{\n"
+                           "  \"package\": %1,\n"
+                           "  \"started\": %2,\n"
+                           "  \"elapsed_ms\": %3,\n"
+                           "  \"phases\": [\n%4\n  ],\n"
+                           "  \"items\": [\n%5\n  ]\n"
+                           "}\n")
+                   .arg(quoted(_package),
+                        quoted(_started.toString(Qt::ISODate)),
+                        msec(elapsed()),
+                        phases.join(",\n"), items.join(",\n"));
+  return result.toUtf8();
+}
+
+/* Chrome trace event format, everything on one thread since the update
+   runs on one. Spans nest by time, so items show inside their phase.
+ */
+QByteArray UpdateTimings::trace() const
+{
+  QString     span("    { \"name\": %1, \"cat\": %2, \"ph\": \"X\", "
+                   "\"ts\": %3, \"dur\": %4, \"pid\": 1, \"tid\": 1%5 }");
+  QString     counter("    { \"name\": %1, \"ph\": \"C\", \"ts\": %2, "
+                      "\"pid\": 1, \"args\": { %3: %4 } }");
+  QStringList events;
+
+  events.append(QString("    { \"name\": \"process_name\", \"ph\": \"M\", "
+                        "\"pid\": 1, \"args\": { \"name\": %1 } }")
+                .arg(quoted(TR("updater %1").arg(_package))));
+
+  foreach (Phase phase, _phases)
+    events.append(span.arg(quoted(phase.name), quoted("phase"),
+                           usec(phase.start), usec(phase.elapsed),
+                           QString(", \"args\": { \"read_ms\": %1, "
+                                   "\"lockwait_ms\": %2, \"items\": %3 }")
+                           .arg(msec(phase.read)).arg(phase.lockWait)
+                           .arg(phase.items)));
+
+  foreach (Span s, _spans)
+    events.append(span.arg(quoted(s.name), quoted(s.category),
+                           usec(s.start), usec(s.elapsed), QString()));
+
+  qint64 applied = 0;
+  foreach (Item item, _items)
+  {
+    events.append(span.arg(quoted(item.name), quoted(item.kind),
+                           usec(item.start), usec(item.elapsed),
+                           QString(", \"args\": { \"bytes\": %1, "
+                                   "\"roundtrips\": %2 }")
+                           .arg(item.bytes).arg(item.roundTrips)));
+
+    QString end = usec(item.start + item.elapsed);
+    applied += item.bytes;
+    events.append(counter.arg(quoted("bytes applied"), end, quoted("bytes"))
+                         .arg(applied));
+    if (item.memory >= 0)
+      events.append(counter.arg(quoted("memory in use"), end, quoted("bytes"))
+                           .arg(item.memory));
+  }
+
+  return QString("{\n  \"displayTimeUnit\": \"ms\",\n"
+                 "  \"traceEvents\": [\n%1\n  ]\n}\n")
+           .arg(events.join(",\n")).toUtf8();
+}
+
+bool UpdateTimings::write(const QString &filename, const QByteArray &data,
+                          QString &errMsg)
+{
+  QFile file(filename);
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+      file.write(data) < 0)
+  {
+    errMsg = TR("Could not write the timings to %1: %2")
+               .arg(filename, file.errorString());
+    return false;
+  }
+  return true;
+}
+
+bool UpdateTimings::save(const QString &filename, QString &errMsg) const
+{
+  return write(filename, json(), errMsg);
+}
+
+bool UpdateTimings::saveTrace(const QString &filename, QString &errMsg) const
+{
+  return write(filename, trace(), errMsg);
+}
+
+/* The count slowest items and, for the whole run, how long was spent
+   applying items, waiting for the package and waiting for locks.
+ */
+QString UpdateTimings::summary(int count) const
+{
+  qint64 applied  = 0;
+  qint64 read     = 0;
+  int    lockWait = 0;
+  foreach (Phase phase, _phases)
+  {
+    applied  += phase.applied;
+    read     += phase.read;
+    lockWait += phase.lockWait;
+  }
+
+  QList<Item> slowest = _items;
+  qStableSort(slowest.begin(), slowest.end(), slower);
+
+  QString rows;
+  for (int i = 0; i < count && i < slowest.size(); i++)
+    rows += TR("<tr><td align='right'>%1 ms</td><td>%2</td><td>%3</td>"
+               "<td align='right'>%4 bytes</td></tr>")
+              .arg(msec(slowest.at(i).elapsed), slowest.at(i).name,
+                   slowest.at(i).phase)
+              .arg(slowest.at(i).bytes);
+
+  return TR("<p>%1 ms applying %2 items, %3 ms reading the package, "
+            "%4 ms waiting for table locks</p>"
+            "<p>Slowest items:</p><table>%5</table>")
+           .arg(msec(applied)).arg(_items.size()).arg(msec(read))
+           .arg(lockWait).arg(rows);
+}
@@ -0,0 +1,123 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __UPDATETIMINGS_H__
+#define __UPDATETIMINGS_H__
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+/* UpdateTimings records where the time goes in an update.
+
+   An update is a sequence of phases - opening the package, checking
+   prerequisites, each stage of sStart() - and within them the items that
+   were applied. Take elapsed() before starting something and pass it to
+   addItem() or addRead() when it is done; the item is charged to the
+   current phase.
+
+   Item times are measured around the calls that send an item to the
+   database, so they are mostly server and network time. Time spent
+   waiting for package members to be read and decompressed is kept
+   separately by addRead(). Round trips are the statements the caller
+   knows it sent, including savepoints, so they are a lower bound. Items
+   that were rolled back to be applied again are dropped with
+   discardItems(), so each item counts once; the attempt stays in trace()
+   as a span.
+
+   json() writes the phases and items with times in milliseconds from the
+   start of the run; summary() is a short report of the slowest items.
+   trace() writes the same run as Chrome trace events, for chrome://tracing
+   or Perfetto: a span for each phase, item and addSpan(), and counters of
+   the bytes applied and the memory in use as each item finished.
+ */
+class UpdateTimings
+{
+  public:
+    UpdateTimings();
+    virtual ~UpdateTimings();
+
+    virtual void addItem(const QString &name, const QString &kind,
+                         qint64 start, qint64 bytes, int roundTrips);
+    virtual void addLockWait(int msec);
+    virtual void addRead(qint64 start, qint64 bytes);
+    virtual void addRoundTrips(int count);
+    virtual void addSpan(const QString &name, const QString &category,
+                         qint64 start);
+    virtual void clear();
+    virtual void discardItems(int mark);
+    virtual void endPhase();
+    virtual void startPhase(const QString &name);
+
+    qint64     elapsed() const;    // nsec since clear()
+    QByteArray json()    const;
+    int        mark()    const { return _items.size(); }  // for discardItems()
+    bool       save(const QString &filename, QString &errMsg) const;
+    bool       saveTrace(const QString &filename, QString &errMsg) const;
+    void       setPackage(const QString &name) { _package = name; }
+    QString    summary(int count) const;
+    QByteArray trace()   const;
+
+    static qint64  memoryInUse();  // resident bytes, -1 if unknown
+    static QString quoted(const QString &value);  // as a JSON string
+
+    struct Item
+    {
+      QString name;
+      QString kind;
+      QString phase;
+      qint64  start;       // nsec since clear()
+      qint64  elapsed;     // nsec
+      qint64  bytes;
+      qint64  memory;      // memoryInUse() when it finished
+      int     roundTrips;
+    };
+
+    struct Phase
+    {
+      QString name;
+      qint64  start;       // nsec since clear()
+      qint64  elapsed;     // nsec
+      qint64  applied;     // nsec in items
+      qint64  read;        // nsec waiting for package members
+      qint64  bytes;
+      int     items;
+      int     roundTrips;
+      int     lockWait;    // msec
+    };
+
+    struct Span
+    {
+      QString name;
+      QString category;
+      qint64  start;       // nsec since clear()
+      qint64  elapsed;     // nsec
+    };
+
+    QList<Item>  items()  const { return _items; }
+    QList<Phase> phases() const { return _phases; }
+    QList<Span>  spans()  const { return _spans; }
+
+  protected:
+    int           _current;   // index into _phases or -1
+    QList<Item>   _items;
+    QString       _package;
+    QList<Phase>  _phases;
+    QList<Span>   _spans;
+    QDateTime     _started;
+    QElapsedTimer _timer;
+
+    static bool write(const QString &filename, const QByteArray &data,
+                      QString &errMsg);
+};
+
+#endif
@@ -57,6 +57,21 @@ exists(../updater-desktop-build) {
   UPDATER_LIBDIR=../updater-desktop-build/lib
 }
 
+# libpq lets the updater pipeline statements; set PG_INCLUDEDIR and
+# PG_LIBDIR or put pg_config on the PATH. Without it statements are sent
+# one at a time through the Qt driver.
+PG_INCLUDEDIR = $$(PG_INCLUDEDIR)
+PG_LIBDIR     = $$(PG_LIBDIR)
+isEmpty( PG_INCLUDEDIR ) { PG_INCLUDEDIR = $$system(pg_config --includedir) }
+isEmpty( PG_LIBDIR )     { PG_LIBDIR     = $$system(pg_config --libdir) }
+! isEmpty( PG_INCLUDEDIR ) : exists( $${PG_INCLUDEDIR}/libpq-fe.h ) {
+  INCLUDEPATH += $${PG_INCLUDEDIR}
+  DEFINES     += HAVE_LIBPQ
+  ! isEmpty( PG_LIBDIR ) { QMAKE_LIBDIR += $${PG_LIBDIR} }
+  LIBS        += -lpq
+  message("Using libpq from $${PG_INCLUDEDIR}.")
+}
+
 INCLUDEPATH += ../common \
                $${OPENRPT_HEADERS}/common \
                $${OPENRPT_HEADERS}/MetaSQL \
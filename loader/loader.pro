@@ -14,7 +14,7 @@ TEMPLATE = app
 CONFIG += qt warn_on c++11
 QT     += script xml sql xmlpatterns
 isEqual(QT_MAJOR_VERSION, 5) {
-  QT += widgets
+  QT += widgets concurrent
 }
 
 DEPENDPATH  += ../$${XTUPLE_BLD}/common
@@ -26,7 +26,7 @@ UI_DIR      = tmp
 
 QMAKE_LIBDIR += $${UPDATER_LIBDIR} $${OPENRPT_LIBDIR} $${XTUPLE_LIBDIR}
 LIBS += -lxtuplecommon -lupdatercommon -lopenrptcommon -lrenderer -lMetaSQL -lqzint
-LIBS += -lz
+LIBS += -lz -lzstd
 
 win32-msvc* {
   PRE_TARGETDEPS += $${UPDATER_LIBDIR}/updatercommon.lib               \
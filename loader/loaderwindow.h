@@ -11,16 +11,12 @@
 #ifndef LOADERWINDOW_H
 #define LOADERWINDOW_H
 
-class Loadable;
-class Package;
-class Script;
-class TarFile;
-
 #include <QMainWindow>
 
 #include "ui_loaderwindow.h"
 
 class LoaderWindowPrivate;
+class UpdateEngine;
 class XAbstractMessageHandler;
 
 class LoaderWindow : public QMainWindow, public Ui::LoaderWindow
@@ -31,6 +27,7 @@ public:
     LoaderWindow(QWidget* parent = 0, const char* name = 0, Qt::WindowFlags fl = Qt::Window);
     ~LoaderWindow();
 
+    virtual UpdateEngine            *engine()  const;
     virtual XAbstractMessageHandler *handler() const;
 
 public slots:
@@ -42,28 +39,24 @@ public slots:
 
     virtual void setCmdline(bool);
     virtual void setDebugPkg(bool);
+    virtual void setJournal(bool);
+    virtual void setRewrite(bool);
+    virtual void setSchedule(bool);
+    virtual void setServerApply(bool);
+    virtual void setTimingsFile(const QString &filename);
+    virtual void setTraceFile(const QString &filename);
+    virtual void setUseCache(bool);
     virtual bool openFile(QString filename);
     virtual void setWindowTitle();
     virtual bool sStart();
 
 protected:
-    Package * _package;
-    TarFile * _files;
-
-    QString _filename;
-    QString prePkgVer;
-    QString preDbVer;
-
-    virtual int  applySql(Script *, const QByteArray);
-    virtual int  applyLoadable(Loadable *, const QByteArray);
     virtual void launchBrowser(QWidget *w, const QString &url);
     virtual void timerEvent( QTimerEvent * e );
-    virtual void logUpdate(QDateTime startTime, QDateTime endTime);
-
-    static QString _rollbackMsg;
 
 protected slots:
     virtual void languageChange();
+    virtual void sProgress(int value, int maximum);
 
 private:
     LoaderWindowPrivate *_p;
@@ -22,6 +22,7 @@
 
 #include "updaterdata.h"
 #include "loaderwindow.h"
+#include "updatesession.h"
 #include "xabstractmessagehandler.h"
 
 QString _databaseURL = "";
@@ -32,15 +33,23 @@ int main(int argc, char* argv[])
   QString dbName;
   QString hostName;
   QString passwd;
-  QString pkgfile;
+  QStringList pkgfiles;
   QString port;
   QString username;
+  QString timingsFile;
+  QString traceFile;
   XAbstractMessageHandler *handler;
-  bool    autoRunArg      = false;
-  bool    autoRunCheck    = false;
-  bool    debugpkg        = false;
-  bool    haveDatabaseURL = false;
-  bool    acceptDefaults  = false;
+  bool    autoRunArg        = false;
+  bool    autoRunCheck      = false;
+  bool    debugpkg          = false;
+  bool    haveDatabaseURL   = false;
+  bool    acceptDefaults    = false;
+  bool    journal           = false;
+  bool    rewrite           = false;
+  bool    schedule          = false;
+  bool    serverApply       = false;
+  bool    singleTransaction = false;
+  bool    useCache          = false;
 
   QApplication app(argc, argv);
   app.addLibraryPath(".");
@@ -63,7 +72,15 @@ int main(int argc, char* argv[])
                  " [ -U username | -username=username ]"
                  " [ -passwd=databasePassword ]"
                  " [ -debug ]"
-                 " [ -file=updaterFile.gz | -f updaterFile.gz ]"
+                 " [ -cache ]"
+                 " [ -serverapply ]"
+                 " [ -journal ]"
+                 " [ -rewrite ]"
+                 " [ -schedule ]"
+                 " [ -singletransaction ]"
+                 " [ -timings=timings.json ]"
+                 " [ -trace=trace.json ]"
+                 " [ -file=updaterFile.gz | -f updaterFile.gz ... ]"
                  " [ -autorun [ -D ] ]",
                  argv[0]);
         return 0;
@@ -103,13 +120,45 @@ int main(int argc, char* argv[])
       {
         debugpkg = true;
       }
+      else if (argument.toLower() == "-cache")
+      {
+        useCache = true;
+      }
+      else if (argument.toLower() == "-serverapply")
+      {
+        serverApply = true;
+      }
+      else if (argument.toLower() == "-journal")
+      {
+        journal = true;
+      }
+      else if (argument.toLower() == "-rewrite")
+      {
+        rewrite = true;
+      }
+      else if (argument.toLower() == "-schedule")
+      {
+        schedule = true;
+      }
+      else if (argument.toLower() == "-singletransaction")
+      {
+        singleTransaction = true;
+      }
+      else if (argument.startsWith("-timings=", Qt::CaseInsensitive))
+      {
+        timingsFile = argument.right(argument.size() - argument.indexOf("=") - 1);
+      }
+      else if (argument.startsWith("-trace=", Qt::CaseInsensitive))
+      {
+        traceFile = argument.right(argument.size() - argument.indexOf("=") - 1);
+      }
       else if (argument == "-f")
       {
-        pkgfile = argv[++intCounter];
+        pkgfiles.append(argv[++intCounter]);
       }
       else if (argument.startsWith("-file=", Qt::CaseInsensitive))
       {
-        pkgfile = argument.right(argument.size() - argument.indexOf("=") - 1);
+        pkgfiles.append(argument.right(argument.size() - argument.indexOf("=") - 1));
       }
       else if (argument.toLower() == "-autorun")
       {
@@ -124,6 +173,20 @@ int main(int argc, char* argv[])
 
   LoaderWindow * mainwin = new LoaderWindow();
   mainwin->setDebugPkg(debugpkg);
+  if (useCache)
+    mainwin->setUseCache(true);
+  if (serverApply)
+    mainwin->setServerApply(true);
+  if (rewrite)
+    mainwin->setRewrite(true);
+  if (schedule)
+    mainwin->setSchedule(true);
+  if (journal)
+    mainwin->setJournal(true);
+  if (! timingsFile.isEmpty())
+    mainwin->setTimingsFile(timingsFile);
+  if (! traceFile.isEmpty())
+    mainwin->setTraceFile(traceFile);
   mainwin->setCmdline(autoRunArg);
   handler = mainwin->handler();
   handler->setAcceptDefaults(autoRunArg && acceptDefaults);
@@ -207,17 +270,39 @@ int main(int argc, char* argv[])
                           QMessageBox::No) == QMessageBox::No)
     return 4;
 
-  if (! pkgfile.isEmpty())
+  // several packages are applied together by an UpdateSession, which
+  // opens each one itself when its turn comes
+  if (pkgfiles.size() == 1 || (pkgfiles.size() > 1 && ! autoRunArg))
   {
-    autoRunCheck = mainwin->openFile(pkgfile);
+    autoRunCheck = mainwin->openFile(pkgfiles.first());
   }
+  if (pkgfiles.size() > 1 && ! autoRunArg)
+    handler->message(QtWarningMsg,
+                     QObject::tr("<p>Several packages can only be applied "
+                                 "together with -autorun. Only %1 was "
+                                 "opened.</p>").arg(pkgfiles.first()));
 
   if (autoRunArg)
   {
-    bool successful = autoRunCheck && ! pkgfile.isEmpty();
-    if (successful)
+    bool successful = false;
+    if (pkgfiles.size() > 1)
     {
-      successful = mainwin->sStart();
+      UpdateSession session(mainwin->engine());
+      session.setSingleTransaction(singleTransaction);
+      QString errMsg;
+      successful = session.prepare(pkgfiles, errMsg);
+      if (successful)
+        successful = session.run();
+      else
+        handler->message(QtFatalMsg, errMsg);
+    }
+    else
+    {
+      successful = autoRunCheck && ! pkgfiles.isEmpty();
+      if (successful)
+      {
+        successful = mainwin->sStart();
+      }
     }
     if (successful)     // not else if
       return 0;
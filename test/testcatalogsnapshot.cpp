@@ -0,0 +1,130 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "testcatalogsnapshot.h"
+
+#include <QSqlError>
+#include <QStringList>
+#include <QtTest>
+
+#include "catalogsnapshot.h"
+#include "testdatabase.h"
+#include "xsqlquery.h"
+
+static const QString schema("testcatalogsnapshot");
+
+static bool run(const QString &sql)
+{
+  XSqlQuery qry;
+  qry.exec(sql);
+  if (qry.lastError().type() != QSqlError::NoError)
+  {
+    qWarning("%s: %s", qPrintable(sql), qPrintable(qry.lastError().text()));
+    return false;
+  }
+  return true;
+}
+
+static void addNames(CatalogSnapshot &snapshot)
+{
+  snapshot.add("snaptable");
+  snapshot.add("SnapView");
+  snapshot.add("snaptrigger");
+  snapshot.add("snapfunc");
+  snapshot.add("snapmissing");
+}
+
+void TestCatalogSnapshot::initTestCase()
+{
+  QString errMsg;
+  if (! TestDatabase::open(errMsg))
+    QSKIP(qPrintable(errMsg), SkipAll);
+}
+
+void TestCatalogSnapshot::init()
+{
+  QVERIFY(TestDatabase::begin());
+  QVERIFY(run("CREATE SCHEMA " + schema + ";"));
+  QVERIFY(run("CREATE TABLE " + schema + ".snaptable (a INTEGER);"));
+  QVERIFY(run("CREATE VIEW " + schema + ".snapview AS"
+              " SELECT a FROM " + schema + ".snaptable;"));
+  QVERIFY(run("CREATE FUNCTION " + schema + ".snapfunc() RETURNS TRIGGER AS"
+              " $$ BEGIN RETURN NEW; END; $$ LANGUAGE plpgsql;"));
+  QVERIFY(run("CREATE TRIGGER snaptrigger BEFORE INSERT ON " + schema +
+              ".snaptable FOR EACH ROW EXECUTE PROCEDURE " + schema +
+              ".snapfunc();"));
+}
+
+void TestCatalogSnapshot::cleanup()
+{
+  TestDatabase::rollback();
+}
+
+void TestCatalogSnapshot::contains_data()
+{
+  QTest::addColumn<QString>("kind");
+  QTest::addColumn<QString>("name");
+  QTest::addColumn<bool>("found");
+
+  QTest::newRow("table")          << "r" << "snaptable"   << true;
+  QTest::newRow("table as view")  << "v" << "snaptable"   << false;
+  QTest::newRow("view")           << "v" << "snapview"    << true;
+  QTest::newRow("trigger")        << "t" << "snaptrigger" << true;
+  QTest::newRow("function")       << "f" << "snapfunc"    << true;
+  QTest::newRow("upper case")     << "r" << "SNAPTABLE"   << true;
+  QTest::newRow("missing")        << "r" << "snapmissing" << false;
+}
+
+void TestCatalogSnapshot::contains()
+{
+  QFETCH(QString, kind);
+  QFETCH(QString, name);
+  QFETCH(bool,    found);
+
+  CatalogSnapshot snapshot;
+  addNames(snapshot);
+  QString errMsg;
+  QVERIFY2(snapshot.refresh(errMsg), qPrintable(errMsg));
+
+  QCOMPARE(snapshot.contains(kind, schema, name), found);
+  QVERIFY(! snapshot.contains(kind, "public", name));
+  QCOMPARE(snapshot.contains(QStringList() << "r" << "v" << "f" << "t",
+                             QStringList() << "public" << schema, name),
+           name != "snapmissing");
+}
+
+// objects are only looked for under the names that were added
+void TestCatalogSnapshot::onlyAddedNames()
+{
+  CatalogSnapshot snapshot;
+  snapshot.add("snapview");
+  QCOMPARE(snapshot.names(), QStringList() << "snapview");
+
+  QString errMsg;
+  QVERIFY2(snapshot.refresh(errMsg), qPrintable(errMsg));
+  QVERIFY(snapshot.contains("v", schema, "snapview"));
+  QVERIFY(! snapshot.contains("r", schema, "snaptable"));
+  QCOMPARE(snapshot.found(), 1);
+}
+
+// a refresh forgets objects that have gone since the one before
+void TestCatalogSnapshot::refreshReplaces()
+{
+  CatalogSnapshot snapshot;
+  addNames(snapshot);
+  QString errMsg;
+  QVERIFY2(snapshot.refresh(errMsg), qPrintable(errMsg));
+  QVERIFY(snapshot.contains("v", schema, "snapview"));
+
+  QVERIFY(run("DROP VIEW " + schema + ".snapview;"));
+  QVERIFY2(snapshot.refresh(errMsg), qPrintable(errMsg));
+  QVERIFY(! snapshot.contains("v", schema, "snapview"));
+  QVERIFY(snapshot.contains("r", schema, "snaptable"));
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "testdatabase.h"
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlError>
+
+#include "xsqlquery.h"
+
+#define TR(a) QObject::tr(a)
+
+// the default connection, opened the first time a test class asks for it
+bool TestDatabase::open(QString &errMsg)
+{
+  QSqlDatabase db = QSqlDatabase::database(QSqlDatabase::defaultConnection,
+                                           false);
+  if (db.isOpen())
+    return true;
+
+  QByteArray name = qgetenv("PGDATABASE");
+  if (name.isEmpty())
+  {
+    errMsg = TR("Set PGDATABASE to run the tests that need a database");
+    return false;
+  }
+
+  if (! db.isValid())
+    db = QSqlDatabase::addDatabase("QPSQL");
+  db.setDatabaseName(QString::fromLocal8Bit(name));
+  if (! db.open())
+  {
+    errMsg = TR("Could not connect to %1: %2")
+               .arg(QString::fromLocal8Bit(name), db.lastError().text());
+    return false;
+  }
+  return true;
+}
+
+bool TestDatabase::begin()
+{
+  XSqlQuery begin("BEGIN;");
+  return begin.lastError().type() == QSqlError::NoError;
+}
+
+void TestDatabase::rollback()
+{
+  XSqlQuery rollback("ROLLBACK;");
+}
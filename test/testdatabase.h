@@ -0,0 +1,30 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __TESTDATABASE_H__
+#define __TESTDATABASE_H__
+
+#include <QString>
+
+/* The database for the test classes that need one. It is named by
+   PGDATABASE and reached through the other libpq PG* variables, so a
+   test class calls open() in initTestCase() and skips when it fails.
+   Those classes run each case inside begin() and rollback() so they leave
+   the database as they found it.
+ */
+class TestDatabase
+{
+  public:
+    static bool open(QString &errMsg);
+    static bool begin();
+    static void rollback();
+};
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "testdbobjscheduler.h"
+
+#include <QStringList>
+#include <QtTest>
+
+#include "dbobjscheduler.h"
+#include "script.h"
+
+void TestDbObjScheduler::definitions_data()
+{
+  QTest::addColumn<QString>("sql");
+  QTest::addColumn<QStringList>("expected");
+
+  QTest::newRow("table")
+    << "CREATE TABLE IF NOT EXISTS public.foo (id INTEGER);"
+    << (QStringList() << "foo");
+  QTest::newRow("view")
+    << "DROP VIEW IF EXISTS api.bar; CREATE OR REPLACE VIEW api.bar AS SELECT 1;"
+    << (QStringList() << "bar");
+  QTest::newRow("quoted name")
+    << "CREATE TEMPORARY TABLE \"Baz\" (id INTEGER);"
+    << (QStringList() << "baz");
+  QTest::newRow("in a string")
+    << "SELECT 'CREATE TABLE foo (id INTEGER)';"
+    << QStringList();
+  QTest::newRow("in a comment")
+    << "-- CREATE TABLE foo (id INTEGER);\nSELECT 1;"
+    << QStringList();
+}
+
+void TestDbObjScheduler::definitions()
+{
+  QFETCH(QString,     sql);
+  QFETCH(QStringList, expected);
+
+  QCOMPARE(DbObjScheduler::definitions(sql), expected);
+}
+
+void TestDbObjScheduler::keepsOrder()
+{
+  Script a("a.sql"), b("b.sql"), c("c.sql");
+
+  DbObjScheduler scheduler;
+  scheduler.add(&a, "CREATE TABLE ta (id INTEGER);");
+  scheduler.add(&b, "SELECT 1;");
+  scheduler.add(&c, "CREATE TABLE tc (id INTEGER);");
+
+  QString errMsg;
+  QVERIFY2(scheduler.schedule(errMsg), qPrintable(errMsg));
+  QCOMPARE(scheduler.order(), QList<Script*>() << &a << &b << &c);
+  QVERIFY(! scheduler.reordered());
+}
+
+// only the script that needs the table moves, and only past its definer
+void TestDbObjScheduler::definerFirst()
+{
+  Script view("view.sql"), other("other.sql"), table("table.sql");
+
+  DbObjScheduler scheduler;
+  scheduler.add(&view,  "CREATE VIEW v AS SELECT * FROM public.t;");
+  scheduler.add(&other, "SELECT 1;");
+  scheduler.add(&table, "CREATE TABLE t (id INTEGER);");
+
+  QString errMsg;
+  QVERIFY2(scheduler.schedule(errMsg), qPrintable(errMsg));
+  QCOMPARE(scheduler.order(), QList<Script*>() << &other << &table << &view);
+  QVERIFY(scheduler.reordered());
+  QVERIFY(scheduler.cycle().isEmpty());
+}
+
+void TestDbObjScheduler::ignoresBodiesAndDrops()
+{
+  Script func("func.sql"), table("table.sql");
+
+  DbObjScheduler scheduler;
+  scheduler.add(&func, "DROP TABLE IF EXISTS t;\n"
+                       "CREATE FUNCTION f() RETURNS INTEGER AS $$\n"
+                       "  SELECT count(*)::INTEGER FROM t;\n"
+                       "$$ LANGUAGE sql;");
+  scheduler.add(&table, "CREATE TABLE t (id INTEGER);");
+
+  QString errMsg;
+  QVERIFY2(scheduler.schedule(errMsg), qPrintable(errMsg));
+  QCOMPARE(scheduler.order(), QList<Script*>() << &func << &table);
+  QVERIFY(! scheduler.reordered());
+}
+
+void TestDbObjScheduler::reportsCycle()
+{
+  Script a("a.sql"), b("b.sql"), c("c.sql");
+
+  DbObjScheduler scheduler;
+  scheduler.add(&a, "CREATE VIEW va AS SELECT * FROM vb;");
+  scheduler.add(&b, "CREATE VIEW vb AS SELECT * FROM va;");
+  scheduler.add(&c, "SELECT 1;");
+
+  QString errMsg;
+  QVERIFY(! scheduler.schedule(errMsg));
+  QVERIFY(! errMsg.isEmpty());
+  QCOMPARE(scheduler.cycle(), QStringList() << "a.sql" << "b.sql" << "a.sql");
+  QCOMPARE(scheduler.order(), QList<Script*>() << &a << &b << &c);
+  QVERIFY(! scheduler.reordered());
+}
@@ -0,0 +1,33 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __TESTDBOBJSCHEDULER_H__
+#define __TESTDBOBJSCHEDULER_H__
+
+#include <QObject>
+
+/* DbObjScheduler finding what scripts create, putting them before the
+   scripts that use it without moving anything else, and naming the
+   scripts in a dependency cycle.
+ */
+class TestDbObjScheduler : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void definitions_data();
+    void definitions();
+    void keepsOrder();
+    void definerFirst();
+    void ignoresBodiesAndDrops();
+    void reportsCycle();
+};
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "testloadablebatch.h"
+
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QtTest>
+
+#include <parameter.h>
+
+#include "loadablebatch.h"
+#include "loadimage.h"
+#include "loadmetasql.h"
+#include "pgpipeline.h"
+
+// the parameters Loadable::writeToDB() hands to the batch
+static ParameterList params(const QString &tablename, const QString &name,
+                            const QString &group = QString())
+{
+  ParameterList result;
+  result.append("tablename", tablename);
+  result.append("name",      name);
+  if (! group.isEmpty())
+    result.append("group",   group);
+  result.append("source",    QString("-- %1").arg(name));
+  result.append("notes",     QString("notes for %1").arg(name));
+  return result;
+}
+
+static int countContaining(const QStringList &statements, const QString &text)
+{
+  int result = 0;
+  foreach (QString stmt, statements)
+    if (stmt.contains(text))
+      result++;
+  return result;
+}
+
+void TestLoadableBatch::supports_data()
+{
+  QTest::addColumn<QString>("nodename");
+  QTest::addColumn<bool>("supported");
+
+  QTest::newRow("metasql")    << "loadmetasql"   << true;
+  QTest::newRow("report")     << "loadreport"    << true;
+  QTest::newRow("uiform")     << "loadappui"     << true;
+  QTest::newRow("script")     << "loadappscript" << true;
+  QTest::newRow("image")      << "loadimage"     << true;
+  QTest::newRow("privilege")  << "loadpriv"      << false;
+  QTest::newRow("command")    << "loadcmd"       << false;
+  QTest::newRow("sql script") << "script"        << false;
+}
+
+void TestLoadableBatch::supports()
+{
+  QFETCH(QString, nodename);
+  QFETCH(bool,    supported);
+
+  QCOMPARE(LoadableBatch::supports(nodename), supported);
+  QCOMPARE(LoadableBatch(nodename).isValid(), supported);
+}
+
+// an unsupported batch queues nothing and says why
+void TestLoadableBatch::unsupported()
+{
+  LoadableBatch batch("loadpriv");
+  LoadImage     item("logo");
+  QVERIFY(! batch.add(&item, params("image", "logo")));
+
+  PgPipeline pipeline((QSqlDatabase()));
+  QString    errMsg;
+  QCOMPARE(batch.queue(pipeline, errMsg), -1);
+  QVERIFY(errMsg.contains("loadpriv"));
+  QCOMPARE(pipeline.size(), 0);
+}
+
+// items only join a batch of their own kind
+void TestLoadableBatch::wrongNodename()
+{
+  LoadableBatch batch("loadmetasql");
+  LoadImage     item("logo");
+  QVERIFY(! batch.add(&item, params("image", "logo")));
+  QCOMPARE(batch.size(), 0);
+}
+
+void TestLoadableBatch::empty()
+{
+  LoadableBatch batch("loadmetasql");
+  PgPipeline    pipeline((QSqlDatabase()));
+  QString       errMsg;
+  QCOMPARE(batch.queue(pipeline, errMsg), 0);
+  QCOMPARE(pipeline.size(), 0);
+}
+
+/* items that share a name and group go in successive rounds; each round
+   resolves grades, looks for existing rows, updates and inserts
+ */
+void TestLoadableBatch::rounds()
+{
+  LoadableBatch batch("loadmetasql");
+  LoadMetasql   first("detail", "items");
+  LoadMetasql   second("detail", "items");
+  LoadMetasql   other("detail", "orders");
+  QVERIFY(batch.add(&first,  params("metasql", "detail", "items")));
+  QVERIFY(batch.add(&second, params("metasql", "detail", "items")));
+  QVERIFY(batch.add(&other,  params("metasql", "detail", "orders")));
+  QCOMPARE(batch.size(), 3);
+  QCOMPARE(batch.items(), QList<Loadable*>() << &first << &second << &other);
+
+  PgPipeline pipeline((QSqlDatabase()));
+  QString    errMsg;
+  QCOMPARE(batch.queue(pipeline, errMsg), 3);
+
+  // create, truncate and fill the staging table, then per round the MIN
+  // and MAX grades, the sequence, the id, unchanged, update and insert
+  QStringList statements = pipeline.statements();
+  QCOMPARE(statements.size(), 3 + 2 * 7);
+  QVERIFY(statements.at(0).startsWith("CREATE TEMPORARY TABLE"));
+  QVERIFY(statements.at(1).startsWith("TRUNCATE"));
+  QVERIFY(statements.at(2).startsWith("INSERT INTO pg_temp.updaterbatch"));
+  QCOMPARE(countContaining(statements, "s.round=0"), 7);
+  QCOMPARE(countContaining(statements, "s.round=1"), 7);
+  QCOMPARE(countContaining(statements, "INSERT INTO metasql"), 2);
+  QVERIFY(statements.last().startsWith("INSERT INTO metasql"));
+  QVERIFY(statements.last().contains("s.round=1"));
+}
+
+void TestLoadableBatch::incremental_data()
+{
+  QTest::addColumn<bool>("incremental");
+  QTest::addColumn<int>("count");
+
+  QTest::newRow("incremental") << true  << 4;
+  QTest::newRow("rewrite")     << false << 3;
+}
+
+/* an incremental batch marks rows whose content has not changed so the
+   update leaves them alone; otherwise every existing row is rewritten
+ */
+void TestLoadableBatch::incremental()
+{
+  QFETCH(bool, incremental);
+  QFETCH(int,  count);
+
+  LoadableBatch batch("loadimage");
+  LoadImage     item("logo");
+  QVERIFY(batch.incremental());
+  batch.setIncremental(incremental);
+  QVERIFY(batch.add(&item, params("image", "logo")));
+
+  PgPipeline pipeline((QSqlDatabase()));
+  QString    errMsg;
+  QCOMPARE(batch.queue(pipeline, errMsg), 1);
+
+  // images have no grade: per round the id, unchanged, update and insert
+  QStringList statements = pipeline.statements();
+  QCOMPARE(statements.size(), 3 + count);
+  QCOMPARE(countContaining(statements, "SET unchanged=TRUE"),
+           incremental ? 1 : 0);
+  QCOMPARE(countContaining(statements, "NOT s.unchanged"), 1);
+}
+
+// large batches are staged a few hundred rows to a statement
+void TestLoadableBatch::stageChunks()
+{
+  LoadableBatch     batch("loadimage");
+  QList<LoadImage*> items;
+  for (int i = 0; i < 501; i++)
+  {
+    QString name = QString("image%1").arg(i);
+    items.append(new LoadImage(name));
+    QVERIFY(batch.add(items.last(), params("image", name)));
+  }
+
+  PgPipeline pipeline((QSqlDatabase()));
+  QString    errMsg;
+  QCOMPARE(batch.queue(pipeline, errMsg), 501);
+  QCOMPARE(countContaining(pipeline.statements(),
+                           "INSERT INTO pg_temp.updaterbatch"), 2);
+  qDeleteAll(items);
+}
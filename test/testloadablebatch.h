@@ -0,0 +1,36 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __TESTLOADABLEBATCH_H__
+#define __TESTLOADABLEBATCH_H__
+
+#include <QObject>
+
+/* The statements LoadableBatch queues for a batch, read back from a
+   PgPipeline without a database: staging, one set of statements per round
+   and the kinds of items it refuses.
+ */
+class TestLoadableBatch : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void supports_data();
+    void supports();
+    void unsupported();
+    void wrongNodename();
+    void empty();
+    void rounds();
+    void incremental_data();
+    void incremental();
+    void stageChunks();
+};
+
+#endif
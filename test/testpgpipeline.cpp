@@ -0,0 +1,94 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "testpgpipeline.h"
+
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QVariant>
+#include <QtTest>
+
+#include "pgpipeline.h"
+
+void TestPgPipeline::numbered_data()
+{
+  QTest::addColumn<QString>("sql");
+  QTest::addColumn<QString>("expected");
+
+  QTest::newRow("plain")
+    << "SELECT ?, ?"
+    << "SELECT $1, $2";
+  QTest::newRow("string")
+    << "SELECT '?', ?"
+    << "SELECT '?', $1";
+  QTest::newRow("doubled quote")
+    << "SELECT 'it''s ?', ?"
+    << "SELECT 'it''s ?', $1";
+  QTest::newRow("escape string")
+    << "SELECT E'\\'?', ?"
+    << "SELECT E'\\'?', $1";
+  QTest::newRow("quoted identifier")
+    << "SELECT \"why?\" FROM t WHERE a = ?"
+    << "SELECT \"why?\" FROM t WHERE a = $1";
+  QTest::newRow("line comment")
+    << "SELECT ? -- why?\n  , ?"
+    << "SELECT $1 -- why?\n  , $2";
+  QTest::newRow("nested block comment")
+    << "SELECT /* ? /* ? */ ? */ ?"
+    << "SELECT /* ? /* ? */ ? */ $1";
+  QTest::newRow("dollar quotes")
+    << "SELECT $$?$$, $body$ ? $body$, ?"
+    << "SELECT $$?$$, $body$ ? $body$, $1";
+}
+
+void TestPgPipeline::numbered()
+{
+  QFETCH(QString, sql);
+  QFETCH(QString, expected);
+
+  QCOMPARE(QString::fromUtf8(PgPipeline::numbered(sql)), expected);
+}
+
+void TestPgPipeline::isSingleStatement_data()
+{
+  QTest::addColumn<QString>("sql");
+  QTest::addColumn<bool>("single");
+
+  QTest::newRow("one")                  << "SELECT 1"                        << true;
+  QTest::newRow("trailing semicolon")   << "SELECT 1;"                       << true;
+  QTest::newRow("trailing comment")     << "SELECT 1; -- done\n"             << true;
+  QTest::newRow("two")                  << "SELECT 1; SELECT 2;"             << false;
+  QTest::newRow("semicolon in string")  << "SELECT ';' AS a;"                << true;
+  QTest::newRow("semicolon in body")    << "DO $$ BEGIN PERFORM 1; END $$;"  << true;
+  QTest::newRow("comment between")      << "SELECT 1; /* then */ SELECT 2"   << false;
+}
+
+void TestPgPipeline::isSingleStatement()
+{
+  QFETCH(QString, sql);
+  QFETCH(bool,    single);
+
+  QCOMPARE(PgPipeline::isSingleStatement(sql), single);
+}
+
+// parameters are written out in place of the placeholders they belong to
+void TestPgPipeline::statements()
+{
+  PgPipeline pipeline((QSqlDatabase()));
+  pipeline.append("SELECT ? FROM t WHERE a = '?' AND b = ?;",
+                  QList<QVariant>() << 1 << 2);
+  pipeline.append("SELECT 1 FROM t WHERE c = $$?$$;");
+
+  QStringList expected;
+  expected << "SELECT 1 FROM t WHERE a = '?' AND b = 2;"
+           << "SELECT 1 FROM t WHERE c = $$?$$;";
+  QCOMPARE(pipeline.statements(), expected);
+  QCOMPARE(pipeline.size(), 2);
+}
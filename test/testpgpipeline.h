@@ -0,0 +1,31 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __TESTPGPIPELINE_H__
+#define __TESTPGPIPELINE_H__
+
+#include <QObject>
+
+/* How PgPipeline reads SQL: placeholders and statement boundaries outside
+   strings, quoted identifiers, comments and dollar-quoted bodies.
+ */
+class TestPgPipeline : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void numbered_data();
+    void numbered();
+    void isSingleStatement_data();
+    void isSingleStatement();
+    void statements();
+};
+
+#endif
@@ -0,0 +1,359 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "testpkgarchive.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QtTest>
+
+#include <zstd.h>
+
+#include "pkgarchive.h"
+#include "pkgarchivewriter.h"
+
+void TestPkgArchive::cleanup()
+{
+  foreach (QString name, _files)
+    QFile::remove(name);
+  _files.clear();
+}
+
+QString TestPkgArchive::tempName(const QString &suffix)
+{
+  QString name = QString("%1/testpkgarchive-%2-%3%4")
+                   .arg(QDir::tempPath())
+                   .arg(QCoreApplication::applicationPid())
+                   .arg(_files.size())
+                   .arg(suffix);
+  _files.append(name);
+  return name;
+}
+
+/* compress the tar file with the streaming API, as the stock zstd tool
+   does, so the frame is one piece that does not record its size
+ */
+bool TestPkgArchive::writeStreamedZstd(const QString &tarName,
+                                       const QString &zstName,
+                                       QByteArray &compressed)
+{
+  QFile tar(tarName);
+  if (! tar.open(QIODevice::ReadOnly))
+    return false;
+  QByteArray data = tar.readAll();
+
+  ZSTD_CStream  *zcs = ZSTD_createCStream();
+  ZSTD_initCStream(zcs, 3);
+  ZSTD_inBuffer  in  = { data.constData(), (size_t)data.size(), 0 };
+  QByteArray     buf((int)ZSTD_CStreamOutSize(), '\0');
+  size_t         result = 0;
+  compressed.clear();
+  while (in.pos < in.size && ! ZSTD_isError(result))
+  {
+    ZSTD_outBuffer out = { buf.data(), (size_t)buf.size(), 0 };
+    result = ZSTD_compressStream(zcs, &out, &in);
+    compressed.append(buf.constData(), (int)out.pos);
+  }
+  do
+  {
+    ZSTD_outBuffer out = { buf.data(), (size_t)buf.size(), 0 };
+    result = ZSTD_endStream(zcs, &out);
+    compressed.append(buf.constData(), (int)out.pos);
+  } while (result > 0 && ! ZSTD_isError(result));
+  ZSTD_freeCStream(zcs);
+  if (ZSTD_isError(result))
+    return false;
+
+  QFile zst(zstName);
+  return zst.open(QIODevice::WriteOnly) &&
+         zst.write(compressed) == compressed.size();
+}
+
+void TestPkgArchive::indexRoundTrip()
+{
+  QList<PkgMember> members;
+
+  PkgMember script;
+  script.name   = QString::fromUtf8("pkg/caf\xc3\xa9.sql");
+  script.offset = 512;
+  script.size   = 1234;
+  script.crc    = 0xdeadbeef;
+  script.frame  = -1;
+  script.fsize  = 0;
+  script.type   = PkgArchive::itemType("script");
+  members.append(script);
+
+  PkgMember image;
+  image.name   = "pkg/images/big.png";
+  image.offset = 0;
+  image.size   = Q_INT64_C(5000000000);
+  image.crc    = 1;
+  image.frame  = 4096;
+  image.fsize  = 77777;
+  image.type   = PkgArchive::itemType("loadimage");
+  members.append(image);
+
+  QList<PkgMember> result;
+  QVERIFY(PkgArchive::unpackIndex(PkgArchive::packIndex(members), result));
+  QCOMPARE(result.size(), members.size());
+  for (int i = 0; i < members.size(); i++)
+  {
+    QCOMPARE(result.at(i).name,   members.at(i).name);
+    QCOMPARE(result.at(i).offset, members.at(i).offset);
+    QCOMPARE(result.at(i).size,   members.at(i).size);
+    QCOMPARE(result.at(i).crc,    members.at(i).crc);
+    QCOMPARE(result.at(i).frame,  members.at(i).frame);
+    QCOMPARE(result.at(i).fsize,  members.at(i).fsize);
+    QCOMPARE(result.at(i).type,   members.at(i).type);
+  }
+
+  result.clear();
+  QVERIFY(PkgArchive::unpackIndex(PkgArchive::packIndex(QList<PkgMember>()),
+                                  result));
+  QVERIFY(result.isEmpty());
+}
+
+void TestPkgArchive::indexRejectsGarbage()
+{
+  QList<PkgMember> result;
+  QVERIFY(! PkgArchive::unpackIndex(QByteArray("not a package index"), result));
+
+  PkgMember member;
+  member.name   = "pkg/package.xml";
+  member.offset = 0;
+  member.size   = 10;
+  member.crc    = 0;
+  member.frame  = 0;
+  member.fsize  = 10;
+  member.type   = PkgArchive::itemType("package");
+
+  QByteArray index = PkgArchive::packIndex(QList<PkgMember>() << member);
+  index.chop(3);
+  result.clear();
+  QVERIFY(! PkgArchive::unpackIndex(index, result));
+}
+
+void TestPkgArchive::readMembers_data()
+{
+  QTest::addColumn<int>("format");
+  QTest::addColumn<bool>("indexed");
+  QTest::addColumn<QString>("suffix");
+
+  QTest::newRow("tar")     << (int)PkgArchive::Tar  << false << ".tar";
+  QTest::newRow("gzip")    << (int)PkgArchive::Gzip << false << ".tar.gz";
+  QTest::newRow("zstd")    << (int)PkgArchive::Zstd << false << ".tar.zst";
+  QTest::newRow("gzip v2") << (int)PkgArchive::Gzip << true  << ".gz";
+  QTest::newRow("zstd v2") << (int)PkgArchive::Zstd << true  << ".zst";
+}
+
+void TestPkgArchive::readMembers()
+{
+  QFETCH(int,     format);
+  QFETCH(bool,    indexed);
+  QFETCH(QString, suffix);
+
+  QString dirname = QString(TESTDIR) + "/allknownelemspkg";
+  QString name    = tempName(suffix);
+  QString errMsg;
+
+  PkgArchiveWriter writer(name, (PkgArchive::Format)format);
+  writer.setIndexed(indexed);
+  writer.setFrameSize(16384);     // several zstd frames even for the sample
+  QVERIFY2(writer.open(errMsg), qPrintable(errMsg));
+  QVERIFY2(writer.addDirectory(dirname, "allknownelemspkg", errMsg),
+           qPrintable(errMsg));
+  QVERIFY2(writer.close(errMsg), qPrintable(errMsg));
+
+  PkgArchive archive(name);
+  QVERIFY2(archive.open(errMsg), qPrintable(errMsg));
+  QCOMPARE((int)archive.format(), format);
+  QCOMPARE(archive.hasIndex(), indexed);
+  QCOMPARE(archive.findFile("package.xml"),
+           QString("allknownelemspkg/package.xml"));
+
+  QDir dir(dirname);
+  foreach (QString file, dir.entryList(QDir::Files, QDir::Name))
+  {
+    QFile expected(dir.filePath(file));
+    QVERIFY(expected.open(QIODevice::ReadOnly));
+
+    QString member = "allknownelemspkg/" + file;
+    QVERIFY2(archive.contains(member), qPrintable(member));
+    QCOMPARE(archive.data(member), expected.readAll());
+    QVERIFY2(archive.isValid(), qPrintable(archive.errorString()));
+  }
+
+  // lookups do not depend on how package.xml spells the path
+  QVERIFY(archive.contains("./allknownelemspkg//pkgtest.sql"));
+  QVERIFY(! archive.contains("allknownelemspkg/nosuchfile.sql"));
+
+  if (indexed)
+    QCOMPARE(archive.member("allknownelemspkg/pkgtestview.sql")->type,
+             PkgArchive::itemType("createview"));
+}
+
+void TestPkgArchive::readBatch_data()
+{
+  QTest::addColumn<int>("format");
+  QTest::addColumn<bool>("indexed");
+  QTest::addColumn<QString>("suffix");
+
+  QTest::newRow("tar")     << (int)PkgArchive::Tar  << false << ".tar";
+  QTest::newRow("gzip v2") << (int)PkgArchive::Gzip << true  << ".gz";
+  QTest::newRow("zstd v2") << (int)PkgArchive::Zstd << true  << ".zst";
+}
+
+// several members at once, as PkgPrefetcher reads them, match single reads
+void TestPkgArchive::readBatch()
+{
+  QFETCH(int,     format);
+  QFETCH(bool,    indexed);
+  QFETCH(QString, suffix);
+
+  QString dirname = QString(TESTDIR) + "/allknownelemspkg";
+  QString name    = tempName(suffix);
+  QString errMsg;
+
+  PkgArchiveWriter writer(name, (PkgArchive::Format)format);
+  writer.setIndexed(indexed);
+  QVERIFY2(writer.open(errMsg), qPrintable(errMsg));
+  QVERIFY2(writer.addDirectory(dirname, "allknownelemspkg", errMsg),
+           qPrintable(errMsg));
+  QVERIFY2(writer.close(errMsg), qPrintable(errMsg));
+
+  PkgArchive archive(name);
+  QVERIFY2(archive.open(errMsg), qPrintable(errMsg));
+
+  // a missing member reads as empty, the same file twice as two copies
+  QStringList names;
+  foreach (QString file, QDir(dirname).entryList(QDir::Files, QDir::Name))
+    names.append("allknownelemspkg/" + file);
+  names.insert(1, "allknownelemspkg/nosuchfile.sql");
+  names.append(names.first());
+
+  QList<QByteArray> batch = archive.data(names);
+  QVERIFY2(archive.isValid(), qPrintable(archive.errorString()));
+  QCOMPARE(batch.size(), names.size());
+  QVERIFY(batch.at(1).isEmpty());
+  for (int i = 0; i < names.size(); i++)
+    QCOMPARE(batch.at(i), archive.data(names.at(i)));
+}
+
+void TestPkgArchive::uniqueName_data()
+{
+  QTest::addColumn<bool>("indexed");
+
+  QTest::newRow("v1") << false;
+  QTest::newRow("v2") << true;
+}
+
+/* a v2 package knows all of its members, so a second package.xml is
+   refused at once; a v1 package fails as soon as the scan reaches it
+ */
+void TestPkgArchive::uniqueName()
+{
+  QFETCH(bool, indexed);
+
+  QString name = tempName(indexed ? ".gz" : ".tar.gz");
+  QString errMsg;
+
+  PkgArchiveWriter writer(name, PkgArchive::Gzip);
+  writer.setIndexed(indexed);
+  QVERIFY2(writer.open(errMsg), qPrintable(errMsg));
+  QVERIFY2(writer.addFile("a/package.xml", "<package/>", errMsg), qPrintable(errMsg));
+  QVERIFY2(writer.addFile("a/first.sql",   "SELECT 1;",  errMsg), qPrintable(errMsg));
+  QVERIFY2(writer.addFile("b/package.xml", "<package/>", errMsg), qPrintable(errMsg));
+  QVERIFY2(writer.addFile("b/last.sql",    "SELECT 2;",  errMsg), qPrintable(errMsg));
+  QVERIFY2(writer.close(errMsg), qPrintable(errMsg));
+
+  PkgArchive archive(name);
+  QVERIFY2(archive.open(errMsg), qPrintable(errMsg));
+  QCOMPARE(archive.findFile("package.xml"), QString("a/package.xml"));
+
+  if (indexed)
+  {
+    QVERIFY(! archive.setUniqueName("package.xml"));
+    QVERIFY(! archive.isValid());
+    return;
+  }
+
+  QVERIFY(archive.setUniqueName("package.xml"));
+  QCOMPARE(archive.data("a/first.sql"), QByteArray("SELECT 1;"));
+  QVERIFY(archive.isValid());
+  QVERIFY(archive.data("b/last.sql").isEmpty());
+  QVERIFY(! archive.isValid());
+  QVERIFY(archive.errorString().contains("Multiple package.xml"));
+}
+
+/* a member much larger than the compressed frame, so zstd still has output
+   to return after it has consumed all of its input
+ */
+void TestPkgArchive::streamedZstd()
+{
+  QByteArray big;
+  for (int i = 0; i < 262144; i++)
+    big.append("0123456789abcdef");
+
+  QString tarName = tempName(".tar");
+  QString zstName = tempName(".tar.zst");
+  QString errMsg;
+
+  PkgArchiveWriter writer(tarName, PkgArchive::Tar);
+  QVERIFY2(writer.open(errMsg), qPrintable(errMsg));
+  QVERIFY2(writer.addFile("big/data.txt",  big,         errMsg), qPrintable(errMsg));
+  QVERIFY2(writer.addFile("big/after.txt", "the end\n", errMsg), qPrintable(errMsg));
+  QVERIFY2(writer.close(errMsg), qPrintable(errMsg));
+
+  QByteArray compressed;
+  QVERIFY(writeStreamedZstd(tarName, zstName, compressed));
+  QVERIFY2(ZSTD_getFrameContentSize(compressed.constData(), compressed.size())
+             == ZSTD_CONTENTSIZE_UNKNOWN,
+           "the frame should not record its size");
+
+  PkgArchive archive(zstName);
+  QVERIFY2(archive.open(errMsg), qPrintable(errMsg));
+  QCOMPARE((int)archive.format(), (int)PkgArchive::Zstd);
+  QCOMPARE(archive.data("big/data.txt"), big);
+  QVERIFY2(archive.isValid(), qPrintable(archive.errorString()));
+  QCOMPARE(archive.data("big/after.txt"), QByteArray("the end\n"));
+  QVERIFY2(archive.isValid(), qPrintable(archive.errorString()));
+}
+
+void TestPkgArchive::truncatedZstd()
+{
+  QString tarName = tempName(".tar");
+  QString zstName = tempName(".tar.zst");
+  QString errMsg;
+
+  PkgArchiveWriter writer(tarName, PkgArchive::Tar);
+  QVERIFY2(writer.open(errMsg), qPrintable(errMsg));
+  QVERIFY2(writer.addFile("pkg/package.xml", QByteArray(100000, 'x'), errMsg),
+           qPrintable(errMsg));
+  QVERIFY2(writer.close(errMsg), qPrintable(errMsg));
+
+  QByteArray compressed;
+  QVERIFY(writeStreamedZstd(tarName, zstName, compressed));
+
+  QFile zst(zstName);
+  QVERIFY(zst.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  zst.write(compressed.left(compressed.size() - 8));
+  zst.close();
+
+  PkgArchive archive(zstName);
+  bool opened = archive.open(errMsg);
+  if (opened)
+  {
+    QVERIFY(archive.data("pkg/package.xml").isEmpty());
+    QVERIFY(! archive.isValid());
+    errMsg = archive.errorString();
+  }
+  QVERIFY(! errMsg.isEmpty());
+}
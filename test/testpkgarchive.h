@@ -0,0 +1,50 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __TESTPKGARCHIVE_H__
+#define __TESTPKGARCHIVE_H__
+
+#include <QByteArray>
+#include <QObject>
+#include <QStringList>
+
+/* PkgArchive reading the sample packages written as .tar, .tar.gz and
+   .tar.zst, v1 and v2, one member at a time and several at once, a
+   single-frame .tar.zst as the stock zstd tool writes it, and the v2
+   member index on its own. Packages with two package.xml files are
+   refused.
+ */
+class TestPkgArchive : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void cleanup();
+
+    void indexRoundTrip();
+    void indexRejectsGarbage();
+    void readMembers_data();
+    void readMembers();
+    void readBatch_data();
+    void readBatch();
+    void uniqueName_data();
+    void uniqueName();
+    void streamedZstd();
+    void truncatedZstd();
+
+  private:
+    QStringList _files;     // written by the current test, removed after it
+
+    QString tempName(const QString &suffix);
+    bool    writeStreamedZstd(const QString &tarName, const QString &zstName,
+                              QByteArray &compressed);
+};
+
+#endif
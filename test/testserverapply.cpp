@@ -0,0 +1,144 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "testserverapply.h"
+
+#include <QSqlError>
+#include <QStringList>
+#include <QtTest>
+
+#include <parameter.h>
+
+#include "loadablebatch.h"
+#include "loadimage.h"
+#include "script.h"
+#include "serverapply.h"
+#include "testdatabase.h"
+#include "xsqlquery.h"
+
+// queue one script with the given contents
+static int addScript(ServerApply &apply, const QString &name,
+                     const QByteArray &contents, QString &errMsg)
+{
+  Script     script(name);
+  QByteArray data(contents);
+  return apply.addScript(&script, data, errMsg);
+}
+
+// the values of the first column of query, in order
+static QStringList column(const QString &query)
+{
+  QStringList result;
+  XSqlQuery qry;
+  qry.exec(query);
+  while (qry.next())
+    result.append(qry.value(0).toString());
+  return result;
+}
+
+void TestServerApply::initTestCase()
+{
+  QString errMsg;
+  if (! TestDatabase::open(errMsg))
+    QSKIP(qPrintable(errMsg), SkipAll);
+}
+
+void TestServerApply::init()
+{
+  QVERIFY(TestDatabase::begin());
+}
+
+void TestServerApply::cleanup()
+{
+  TestDatabase::rollback();
+}
+
+// an empty file is refused before anything reaches the server
+void TestServerApply::emptyScript()
+{
+  ServerApply apply;
+  QString     errMsg;
+  QCOMPARE(addScript(apply, "empty.sql", QByteArray(), errMsg), -1);
+  QVERIFY(errMsg.contains("empty.sql"));
+  QCOMPARE(apply.size(), 0);
+  QCOMPARE(apply.run(errMsg), 0);
+}
+
+// each script sees what the ones before it did
+void TestServerApply::appliesInOrder()
+{
+  ServerApply apply;
+  QString     errMsg;
+  QCOMPARE(addScript(apply, "create.sql",
+                     "CREATE TEMPORARY TABLE serverapply (seq INTEGER,"
+                     " name TEXT) ON COMMIT DROP;", errMsg), 0);
+  QCOMPARE(addScript(apply, "first.sql",
+                     "INSERT INTO serverapply VALUES (1, 'it''s\\there\n');",
+                     errMsg), 0);
+  QCOMPARE(addScript(apply, "second.sql",
+                     "INSERT INTO serverapply"
+                     " SELECT MAX(seq) + 1, 'second' FROM serverapply;",
+                     errMsg), 0);
+  QCOMPARE(apply.size(), 3);
+  QVERIFY(apply.bytes() > 0);
+
+  QCOMPARE(apply.run(errMsg), 3);
+  QCOMPARE(column("SELECT name FROM serverapply ORDER BY seq;"),
+           QStringList() << "it's\\there\n" << "second");
+}
+
+// a batch arrives as its statements and writes its rows
+void TestServerApply::appliesBatch()
+{
+  XSqlQuery create;
+  create.exec("CREATE TEMPORARY TABLE image (image_id SERIAL,"
+              " image_name TEXT, image_data TEXT, image_descrip TEXT)"
+              " ON COMMIT DROP;");
+  QVERIFY2(create.lastError().type() == QSqlError::NoError,
+           qPrintable(create.lastError().text()));
+
+  LoadableBatch batch("loadimage");
+  LoadImage     item("logo");
+  ParameterList params;
+  params.append("tablename", QString("pg_temp.image"));
+  params.append("name",      QString("logo"));
+  params.append("source",    QString("data"));
+  params.append("notes",     QString("the logo"));
+  QVERIFY(batch.add(&item, params));
+
+  ServerApply apply;
+  QString     errMsg;
+  QCOMPARE(apply.addBatch(batch, errMsg), 1);
+  QCOMPARE(batch.size(), 1);
+  QVERIFY(apply.size() > 1);
+
+  QCOMPARE(apply.run(errMsg), apply.size());
+  QCOMPARE(column("SELECT image_name || ':' || image_data FROM pg_temp.image;"),
+           QStringList() << "logo:data");
+}
+
+// the error names the item that broke and nothing after it runs
+void TestServerApply::namesFailure()
+{
+  ServerApply apply;
+  QString     errMsg;
+  QCOMPARE(addScript(apply, "create.sql",
+                     "CREATE TEMPORARY TABLE serverapply (a INTEGER)"
+                     " ON COMMIT DROP;", errMsg), 0);
+  QCOMPARE(addScript(apply, "broken.sql",
+                     "INSERT INTO serverapply VALUES ('not a number');",
+                     errMsg), 0);
+  QCOMPARE(addScript(apply, "after.sql",
+                     "INSERT INTO serverapply VALUES (1);", errMsg), 0);
+
+  QVERIFY(apply.run(errMsg) < 0);
+  QVERIFY2(errMsg.contains("broken.sql"), qPrintable(errMsg));
+  QVERIFY(! errMsg.contains("after.sql"));
+}
@@ -0,0 +1,35 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __TESTSERVERAPPLY_H__
+#define __TESTSERVERAPPLY_H__
+
+#include <QObject>
+
+/* ServerApply staging scripts and batches on the server, applying them in
+   order and naming the item that fails. Needs the database described in
+   testdatabase.h.
+ */
+class TestServerApply : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void emptyScript();
+    void appliesInOrder();
+    void appliesBatch();
+    void namesFailure();
+};
+
+#endif
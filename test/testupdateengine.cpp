@@ -0,0 +1,222 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "testupdateengine.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QtTest>
+
+#include <cmdlinemessagehandler.h>
+
+#include "pkgarchivewriter.h"
+#include "pkgprefetcher.h"
+#include "script.h"
+#include "testdatabase.h"
+#include "updateengine.h"
+#include "updatetimings.h"
+#include "xsqlquery.h"
+
+// UpdateEngine with its stages opened up
+class StagedEngine : public UpdateEngine
+{
+  public:
+    StagedEngine(XAbstractMessageHandler *handler) : UpdateEngine(handler) {}
+    using UpdateEngine::applyScripts;
+    using UpdateEngine::packageMembers;
+    using UpdateEngine::stageNames;
+};
+
+// the package.xml of testpkg around the given items
+static QString contents(const QString &items)
+{
+  return QString("<!DOCTYPE packageManagerDef>\n"
+                 "<package id=\"testpkg\" name=\"testpkg\" version=\"1.0\""
+                 " developer=\"test\" descrip=\"test package\""
+                 " updater=\"2.0.0\">\n%1</package>\n").arg(items);
+}
+
+void TestUpdateEngine::initTestCase()
+{
+  _handler = new CmdLineMessageHandler(this);
+  _handler->setAcceptDefaults(true);
+
+  QString errMsg;
+  _database = TestDatabase::open(errMsg);
+  if (! _database)
+    qWarning("%s", qPrintable(errMsg));
+}
+
+void TestUpdateEngine::cleanup()
+{
+  if (_database)
+    TestDatabase::rollback();
+
+  foreach (QString name, _files)
+    QFile::remove(name);
+  _files.clear();
+}
+
+// package.xml from contents, then members, all in directory testpkg
+QString TestUpdateEngine::writePackage(const QString &contents,
+                                       const QMap<QString, QByteArray> &members,
+                                       bool indexed)
+{
+  QString name = QString("%1/testupdateengine-%2-%3.gz")
+                   .arg(QDir::tempPath())
+                   .arg(QCoreApplication::applicationPid())
+                   .arg(_files.size());
+  _files.append(name);
+
+  QString          errMsg;
+  PkgArchiveWriter writer(name, PkgArchive::Gzip);
+  writer.setIndexed(indexed);
+  if (! writer.open(errMsg) ||
+      ! writer.addFile("testpkg/package.xml", contents.toUtf8(), errMsg,
+                       PkgArchive::itemType("package")))
+    return QString::null;
+
+  QMap<QString, QByteArray>::const_iterator it;
+  for (it = members.constBegin(); it != members.constEnd(); ++it)
+    if (! writer.addFile("testpkg/" + it.key(), it.value(), errMsg))
+      return QString::null;
+
+  return writer.close(errMsg) ? name : QString::null;
+}
+
+// privileges and custom commands have no file for the member check to find
+void TestUpdateEngine::openV2WithPrivs()
+{
+  QMap<QString, QByteArray> members;
+  members.insert("init.sql", "SELECT 1;");
+  QString name = writePackage(contents(
+      " <script   file=\"init.sql\" />\n"
+      " <loadpriv name=\"TestPriv\" module=\"Custom\">a privilege</loadpriv>\n"
+      " <loadcmd  name=\"TestCmd\" title=\"Test\" privname=\"TestPriv\""
+      "           module=\"Custom\" executable=\"!customuiform\">a command"
+      "  <arg value=\"uiform=Test\"/>\n"
+      " </loadcmd>\n"), members);
+  QVERIFY(! name.isEmpty());
+
+  UpdateEngine engine(_handler);
+  engine.setUseCache(false);
+  QVERIFY(engine.open(name));
+}
+
+void TestUpdateEngine::openV2MissingFile()
+{
+  QString name = writePackage(contents(
+      " <script   file=\"init.sql\" />\n"
+      " <loadpriv name=\"TestPriv\" module=\"Custom\">a privilege</loadpriv>\n"),
+      QMap<QString, QByteArray>());
+  QVERIFY(! name.isEmpty());
+
+  UpdateEngine engine(_handler);
+  engine.setUseCache(false);
+  QVERIFY(! engine.open(name));
+}
+
+/* two functions defined in one file, and a script using a table created
+   after it, so the objects are reordered and the shared file is read twice
+ */
+void TestUpdateEngine::scheduleSharedFile()
+{
+  QMap<QString, QByteArray> members;
+  members.insert("early.sql", "CREATE VIEW early AS SELECT * FROM testtbl;");
+  members.insert("funcs.sql", "CREATE FUNCTION f1() RETURNS INTEGER AS 'SELECT 1' LANGUAGE sql;\n"
+                              "CREATE FUNCTION f2() RETURNS INTEGER AS 'SELECT 2' LANGUAGE sql;");
+  members.insert("testtbl.sql", "CREATE TABLE testtbl (id INTEGER);");
+  QString name = writePackage(contents(
+      " <script         file=\"early.sql\" />\n"
+      " <createfunction file=\"funcs.sql\" name=\"f1\" />\n"
+      " <createfunction file=\"funcs.sql\" name=\"f2\" />\n"
+      " <createtable    file=\"testtbl.sql\" name=\"testtbl\" />\n"), members);
+  QVERIFY(! name.isEmpty());
+
+  StagedEngine engine(_handler);
+  engine.setUseCache(false);
+  engine.setSchedule(true);
+  QVERIFY(engine.open(name));
+  QVERIFY(engine.stageNames().contains("objects"));
+
+  QStringList pending = engine.packageMembers();
+  QCOMPARE(pending.count("testpkg/funcs.sql"), 2);
+
+  // as applyPackage() reads them
+  PkgPrefetcher prefetcher(engine.files(), pending);
+  prefetcher.start();
+  QString errMsg;
+  foreach (QString member, pending)
+  {
+    QByteArray data;
+    QVERIFY2(prefetcher.take(member, data, errMsg), qPrintable(errMsg));
+    QCOMPARE(data, members.value(member.mid(QString("testpkg/").size())));
+  }
+  QVERIFY2(prefetcher.finish(errMsg), qPrintable(errMsg));
+}
+
+// a cycle is reported when the package opens and the usual order kept
+void TestUpdateEngine::scheduleCycle()
+{
+  QMap<QString, QByteArray> members;
+  members.insert("a.sql", "CREATE TABLE ta (id INTEGER REFERENCES tb);");
+  members.insert("b.sql", "CREATE TABLE tb (id INTEGER REFERENCES ta);");
+  QString name = writePackage(contents(
+      " <createtable file=\"a.sql\" name=\"ta\" />\n"
+      " <createtable file=\"b.sql\" name=\"tb\" />\n"), members);
+  QVERIFY(! name.isEmpty());
+
+  StagedEngine engine(_handler);
+  engine.setUseCache(false);
+  engine.setSchedule(true);
+  QVERIFY(engine.open(name));
+  QVERIFY(engine.stageNames().contains("tables"));
+  QVERIFY(! engine.stageNames().contains("objects"));
+}
+
+/* a group with a failing script is rolled back and applied again in
+   smaller pieces; only the items that stayed applied are timed
+ */
+void TestUpdateEngine::groupBisection()
+{
+  if (! _database)
+    QSKIP("needs the database described in testdatabase.h", SkipSingle);
+  QVERIFY(TestDatabase::begin());
+
+  QMap<QString, QByteArray> members;
+  members.insert("s1.sql", "CREATE TEMPORARY TABLE testgroup1 (id INTEGER);");
+  members.insert("s2.sql", "CREATE TEMPORARY TABLE testgroup2 (id INTEGER);");
+  members.insert("s3.sql", "SELECT no_such_column FROM testgroup_missing;");
+  members.insert("s4.sql", "CREATE TEMPORARY TABLE testgroup4 (id INTEGER);");
+  QString name = writePackage(contents(
+      " <script file=\"s1.sql\" />\n <script file=\"s2.sql\" />\n"
+      " <script file=\"s3.sql\" onerror=\"Ignore\" />\n"
+      " <script file=\"s4.sql\" />\n"), members);
+  QVERIFY(! name.isEmpty());
+
+  StagedEngine engine(_handler);
+  engine.setUseCache(false);
+  QVERIFY(engine.open(name));
+
+  Script s1("s1.sql"), s2("s2.sql"), s3("s3.sql", Script::Ignore), s4("s4.sql");
+  QCOMPARE(engine.applyScripts(QList<Script*>() << &s1 << &s2 << &s3 << &s4), 1);
+
+  XSqlQuery tables("SELECT COUNT(*) AS result FROM pg_class"
+                   " WHERE relname IN ('testgroup1', 'testgroup2', 'testgroup4');");
+  QVERIFY(tables.first());
+  QCOMPARE(tables.value("result").toInt(), 3);
+
+  QStringList timed;
+  foreach (UpdateTimings::Item item, engine.timings().items())
+    if (item.kind == "script")
+      timed.append(item.name);
+  QCOMPARE(timed, QStringList() << "s1.sql" << "s2.sql" << "s4.sql");
+}
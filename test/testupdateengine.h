@@ -0,0 +1,49 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __TESTUPDATEENGINE_H__
+#define __TESTUPDATEENGINE_H__
+
+#include <QByteArray>
+#include <QMap>
+#include <QObject>
+#include <QStringList>
+
+class CmdLineMessageHandler;
+
+/* UpdateEngine opening small packages written by the test and, when asked
+   to, ordering their SQL objects. Packages without prerequisites open
+   without a database; applying them needs the one in testdatabase.h.
+ */
+class TestUpdateEngine : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanup();
+
+    void openV2WithPrivs();
+    void openV2MissingFile();
+    void scheduleSharedFile();
+    void scheduleCycle();
+    void groupBisection();
+
+  private:
+    QStringList            _files;  // written by the current test, removed after it
+    bool                   _database;  // the one in testdatabase.h is open
+    CmdLineMessageHandler *_handler;
+
+    QString writePackage(const QString &contents,
+                         const QMap<QString, QByteArray> &members,
+                         bool indexed = true);
+};
+
+#endif
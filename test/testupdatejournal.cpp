@@ -0,0 +1,130 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "testupdatejournal.h"
+
+#include <QStringList>
+#include <QtTest>
+
+#include "testdatabase.h"
+#include "updatejournal.h"
+#include "xsqlquery.h"
+
+static const QString pkgname("testupdatejournal");
+
+/* a journal for stages a and b. Without an archive every member hashes as
+   missing, so the member names alone tell builds apart.
+ */
+static void addStages(UpdateJournal &journal, const QString &bMember = "b.sql")
+{
+  journal.addStage("a", QStringList() << "a.sql", 0);
+  journal.addStage("b", QStringList() << bMember, 0);
+}
+
+static int rows()
+{
+  XSqlQuery countq;
+  countq.prepare("SELECT COUNT(*) AS result FROM public.updaterjournal"
+                 " WHERE updaterjournal_pkgname=:pkgname;");
+  countq.bindValue(":pkgname", pkgname);
+  countq.exec();
+  return countq.first() ? countq.value("result").toInt() : -1;
+}
+
+void TestUpdateJournal::initTestCase()
+{
+  QString errMsg;
+  if (! TestDatabase::open(errMsg))
+    QSKIP(qPrintable(errMsg), SkipAll);
+}
+
+void TestUpdateJournal::init()
+{
+  QVERIFY(TestDatabase::begin());
+}
+
+void TestUpdateJournal::cleanup()
+{
+  TestDatabase::rollback();
+}
+
+void TestUpdateJournal::completeTwice()
+{
+  UpdateJournal journal(pkgname);
+  addStages(journal);
+
+  QString errMsg;
+  QVERIFY2(journal.open(errMsg) == 0, qPrintable(errMsg));
+  QVERIFY2(journal.complete("a", errMsg) == 0, qPrintable(errMsg));
+  QVERIFY2(journal.complete("a", errMsg) == 0, qPrintable(errMsg));
+  QCOMPARE(rows(), 1);
+  QVERIFY2(journal.complete("b", errMsg) == 0, qPrintable(errMsg));
+  QCOMPARE(rows(), 2);
+}
+
+void TestUpdateJournal::resumesSameBuild()
+{
+  QString errMsg;
+  {
+    UpdateJournal first(pkgname);
+    addStages(first);
+    QVERIFY2(first.open(errMsg) == 0, qPrintable(errMsg));
+    QVERIFY2(first.complete("a", errMsg) == 0, qPrintable(errMsg));
+  }
+
+  UpdateJournal second(pkgname);
+  addStages(second);
+  QCOMPARE(second.open(errMsg), 1);
+  QCOMPARE(second.resumable(), QStringList() << "a");
+  QVERIFY(second.done("a"));
+  QVERIFY(! second.done("b"));
+}
+
+void TestUpdateJournal::ignoresOtherBuild()
+{
+  QString errMsg;
+  {
+    UpdateJournal first(pkgname);
+    addStages(first);
+    QVERIFY2(first.open(errMsg) == 0, qPrintable(errMsg));
+    QVERIFY2(first.complete("a", errMsg) == 0, qPrintable(errMsg));
+  }
+
+  // stage a is identical but the package is not
+  UpdateJournal same(pkgname);
+  addStages(same);
+  UpdateJournal second(pkgname);
+  addStages(second, "b2.sql");
+  QVERIFY(second.pkghash() != same.pkghash());
+  QCOMPARE(second.open(errMsg), 0);
+  QVERIFY(! second.done("a"));
+
+  // and completing a stage of it drops what the other build left
+  QVERIFY2(second.complete("b", errMsg) == 0, qPrintable(errMsg));
+  QCOMPARE(rows(), 1);
+}
+
+void TestUpdateJournal::finishForgets()
+{
+  QString errMsg;
+  {
+    UpdateJournal first(pkgname);
+    addStages(first);
+    QVERIFY2(first.open(errMsg) == 0, qPrintable(errMsg));
+    QVERIFY2(first.complete("a", errMsg) == 0, qPrintable(errMsg));
+    QVERIFY2(first.complete("b", errMsg) == 0, qPrintable(errMsg));
+    QVERIFY2(first.finish(errMsg) == 0, qPrintable(errMsg));
+  }
+  QCOMPARE(rows(), 0);
+
+  UpdateJournal second(pkgname);
+  addStages(second);
+  QCOMPARE(second.open(errMsg), 0);
+}
@@ -0,0 +1,34 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __TESTUPDATEJOURNAL_H__
+#define __TESTUPDATEJOURNAL_H__
+
+#include <QObject>
+
+/* UpdateJournal recording stages in a database and resuming only the same
+   build of a package. Needs the database described in testdatabase.h.
+ */
+class TestUpdateJournal : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void completeTwice();
+    void resumesSameBuild();
+    void ignoresOtherBuild();
+    void finishForgets();
+};
+
+#endif
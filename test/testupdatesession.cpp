@@ -0,0 +1,102 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "testupdatesession.h"
+
+#include <QStringList>
+#include <QtTest>
+
+#include "updatesession.h"
+
+// UpdateSession with sort() opened up; it never touches the engine
+class SortableSession : public UpdateSession
+{
+  public:
+    SortableSession() : UpdateSession(0) {}
+    using UpdateSession::sort;
+};
+
+static UpdateSession::Entry entry(const QString &name,
+                                  const QString &version = "1.0",
+                                  const QString &needs   = QString::null,
+                                  const QString &needsVersion = QString::null)
+{
+  UpdateSession::Entry result;
+  result.filename  = name + ".gz";
+  result.name      = name;
+  result.version   = version;
+  result.developer = "xTuple";
+  if (! needs.isEmpty())
+  {
+    UpdateSession::Need need;
+    need.name    = needs;
+    need.version = needsVersion;
+    result.needs.append(need);
+  }
+  return result;
+}
+
+static QStringList names(const QList<UpdateSession::Entry> &entries)
+{
+  QStringList result;
+  foreach (UpdateSession::Entry item, entries)
+    result.append(item.name);
+  return result;
+}
+
+void TestUpdateSession::keepsOrder()
+{
+  QList<UpdateSession::Entry> entries;
+  entries << entry("c") << entry("a") << entry("b");
+
+  SortableSession session;
+  QString         errMsg;
+  QVERIFY2(session.sort(entries, errMsg), qPrintable(errMsg));
+  QCOMPARE(names(entries), QStringList() << "c" << "a" << "b");
+}
+
+// only the dependent package moves, and only past what it needs
+void TestUpdateSession::dependencyFirst()
+{
+  QList<UpdateSession::Entry> entries;
+  entries << entry("app", "1.0", "base") << entry("other") << entry("base");
+
+  SortableSession session;
+  QString         errMsg;
+  QVERIFY2(session.sort(entries, errMsg), qPrintable(errMsg));
+  QCOMPARE(names(entries), QStringList() << "other" << "base" << "app");
+}
+
+void TestUpdateSession::versionMustMatch()
+{
+  QList<UpdateSession::Entry> entries;
+  entries << entry("app", "1.0", "base", "2.0") << entry("base", "1.0");
+
+  SortableSession session;
+  QString         errMsg;
+  QVERIFY2(session.sort(entries, errMsg), qPrintable(errMsg));
+  QCOMPARE(names(entries), QStringList() << "app" << "base");
+
+  entries.clear();
+  entries << entry("app", "1.0", "base", "2.0") << entry("base", "2.0");
+  QVERIFY2(session.sort(entries, errMsg), qPrintable(errMsg));
+  QCOMPARE(names(entries), QStringList() << "base" << "app");
+}
+
+void TestUpdateSession::reportsCycle()
+{
+  QList<UpdateSession::Entry> entries;
+  entries << entry("first") << entry("a", "1.0", "b") << entry("b", "1.0", "a");
+
+  SortableSession session;
+  QString         errMsg;
+  QVERIFY(! session.sort(entries, errMsg));
+  QVERIFY(errMsg.contains("a, b"));
+}
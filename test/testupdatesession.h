@@ -0,0 +1,31 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __TESTUPDATESESSION_H__
+#define __TESTUPDATESESSION_H__
+
+#include <QObject>
+
+/* UpdateSession putting packages after the packages they depend on and
+   refusing packages that depend on each other. There is no database, so
+   the pkghead check is skipped and only the ordering is tested.
+ */
+class TestUpdateSession : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void keepsOrder();
+    void dependencyFirst();
+    void versionMustMatch();
+    void reportsCycle();
+};
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "testcatalogsnapshot.h"
+#include "testdbobjscheduler.h"
+#include "testloadablebatch.h"
+#include "testpgpipeline.h"
+#include "testpkgarchive.h"
+#include "testserverapply.h"
+#include "testupdateengine.h"
+#include "testupdatejournal.h"
+#include "testupdatesession.h"
+
+// runs every test class and returns the number that failed
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  int failed = 0;
+
+  TestCatalogSnapshot catalogsnapshot;
+  failed += QTest::qExec(&catalogsnapshot, argc, argv) ? 1 : 0;
+
+  TestDbObjScheduler dbobjscheduler;
+  failed += QTest::qExec(&dbobjscheduler, argc, argv) ? 1 : 0;
+
+  TestLoadableBatch loadablebatch;
+  failed += QTest::qExec(&loadablebatch, argc, argv) ? 1 : 0;
+
+  TestPgPipeline pgpipeline;
+  failed += QTest::qExec(&pgpipeline, argc, argv) ? 1 : 0;
+
+  TestPkgArchive pkgarchive;
+  failed += QTest::qExec(&pkgarchive, argc, argv) ? 1 : 0;
+
+  TestServerApply serverapply;
+  failed += QTest::qExec(&serverapply, argc, argv) ? 1 : 0;
+
+  TestUpdateEngine updateengine;
+  failed += QTest::qExec(&updateengine, argc, argv) ? 1 : 0;
+
+  TestUpdateJournal updatejournal;
+  failed += QTest::qExec(&updatejournal, argc, argv) ? 1 : 0;
+
+  TestUpdateSession updatesession;
+  failed += QTest::qExec(&updatesession, argc, argv) ? 1 : 0;
+
+  return failed;
+}
@@ -0,0 +1,64 @@
+#
+# This file is part of the xTuple ERP: PostBooks Edition, a free and
+# open source Enterprise Resource Planning software suite,
+# Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+# It is licensed to you under the Common Public Attribution License
+# version 1.0, the full text of which (including xTuple-specific Exhibits)
+# is available at www.xtuple.com/CPAL.  By using this software, you agree
+# to be bound by its terms.
+#
+
+# QTest cases for updatercommon. Build after the rest of the updater with
+#   qmake unittests.pro && make -f Makefile.unittests
+# and run ./unittests from this directory. The classes that need a database
+# use the one named by PGDATABASE and skip without it, see testdatabase.h.
+
+include( ../global.pri )
+
+TEMPLATE = app
+CONFIG += qt warn_on console testcase
+CONFIG -= app_bundle
+QT     += script xml sql xmlpatterns testlib
+isEqual(QT_MAJOR_VERSION, 5) {
+  QT += widgets concurrent
+}
+
+TARGET   = unittests
+MAKEFILE = Makefile.unittests
+OBJECTS_DIR = tmp/unittests
+MOC_DIR     = tmp/unittests
+
+# the sample packages next to this file
+DEFINES += TESTDIR=\\\"$$PWD\\\"
+
+QMAKE_LIBDIR += $${UPDATER_LIBDIR} $${OPENRPT_LIBDIR} $${XTUPLE_LIBDIR}
+LIBS += -lxtuplecommon -lupdatercommon -lopenrptcommon -lrenderer -lMetaSQL -lqzint
+LIBS += -lz -lzstd
+win32-msvc* {
+  PRE_TARGETDEPS += $${UPDATER_LIBDIR}/updatercommon.lib
+} else {
+  PRE_TARGETDEPS += $${UPDATER_LIBDIR}/libupdatercommon.a
+}
+
+HEADERS += testcatalogsnapshot.h \
+           testdatabase.h \
+           testdbobjscheduler.h \
+           testloadablebatch.h \
+           testpgpipeline.h \
+           testpkgarchive.h \
+           testserverapply.h \
+           testupdateengine.h \
+           testupdatejournal.h \
+           testupdatesession.h
+
+SOURCES += unittests.cpp \
+           testcatalogsnapshot.cpp \
+           testdatabase.cpp \
+           testdbobjscheduler.cpp \
+           testloadablebatch.cpp \
+           testpgpipeline.cpp \
+           testpkgarchive.cpp \
+           testserverapply.cpp \
+           testupdateengine.cpp \
+           testupdatejournal.cpp \
+           testupdatesession.cpp
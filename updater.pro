@@ -11,7 +11,8 @@
 TEMPLATE = subdirs
 SUBDIRS = common \
           builder \
-          loader
+          loader \
+          cli
 
 CONFIG += ordered
 